@@ -154,9 +154,7 @@ SOURCES += main.cpp\
     geostats/ndvestimation.cpp \
     geostats/spatiallocation.cpp \
     geostats/ndvestimationrunner.cpp \
-    geostats/ijkdelta.cpp \
     geostats/ijkindex.cpp \
-    geostats/ijkdeltascache.cpp \
     dialogs/realizationselectiondialog.cpp \
     dialogs/gridresampledialog.cpp \
     dialogs/multivariogramdialog.cpp \
@@ -182,7 +180,24 @@ SOURCES += main.cpp\
     algorithms/CART/cartnode.cpp \
     algorithms/CART/cartsplitcriterion.cpp \
     algorithms/randomforest.cpp \
-    algorithms/decisiontree.cpp
+    algorithms/decisiontree.cpp \
+    geostats/normalscoretransform.cpp \
+    geostats/ensemblepostprocessor.cpp \
+    geostats/histogram.cpp \
+    widgets/histogramplot.cpp \
+    dialogs/histogramdialog.cpp \
+    geostats/gammabar.cpp \
+    geostats/variogramfitter.cpp \
+    gslib/gslibjobscheduler.cpp \
+    widgets/gslibjobspanel.cpp \
+    gslib/gslibresultcache.cpp \
+    workflow/workflow.cpp \
+    geostats/krigingsolver.cpp \
+    geostats/covariancetable.cpp \
+    geostats/covariancekernel.cpp \
+    geostats/crossvalidation.cpp \
+    spatialindex/searchellipsoid.cpp \
+    geostats/gridsearchtemplate.cpp
 
 HEADERS  += mainwindow.h \
     domain/project.h \
@@ -316,9 +331,7 @@ HEADERS  += mainwindow.h \
     geostats/ndvestimation.h \
     geostats/spatiallocation.h \
     geostats/ndvestimationrunner.h \
-    geostats/ijkdelta.h \
     geostats/ijkindex.h \
-    geostats/ijkdeltascache.h \
     dialogs/realizationselectiondialog.h \
     dialogs/gridresampledialog.h \
     dialogs/multivariogramdialog.h \
@@ -344,7 +357,26 @@ HEADERS  += mainwindow.h \
     algorithms/CART/cartnode.h \
     algorithms/CART/cartsplitcriterion.h \
     algorithms/randomforest.h \
-    algorithms/decisiontree.h
+    algorithms/decisiontree.h \
+    geostats/normalscoretransform.h \
+    geostats/ensemblepostprocessor.h \
+    geostats/histogram.h \
+    widgets/histogramplot.h \
+    dialogs/histogramdialog.h \
+    geostats/gammabar.h \
+    geostats/variogramfitter.h \
+    gslib/gslibjobscheduler.h \
+    widgets/gslibjobspanel.h \
+    gslib/gslibresultcache.h \
+    workflow/workflow.h \
+    geostats/krigingsolver.h \
+    geostats/covariancetable.h \
+    geostats/neighborbuffer.h \
+    geostats/covariancekernel.h \
+    geostats/crossvalidation.h \
+    spatialindex/searchellipsoid.h \
+    geostats/gridsearchtemplate.h \
+    geostats/boundedcache.h
 
 FORMS    += mainwindow.ui \
     gslib/gslibparams/widgets/widgetgslibpardouble.ui \
@@ -409,7 +441,9 @@ FORMS    += mainwindow.ui \
     dialogs/sgsimdialog.ui \
     widgets/distributionfieldselector.ui \
     viewer3d/view3dverticalexaggerationwidget.ui \
-    dialogs/machinelearningdialog.ui
+    dialogs/machinelearningdialog.ui \
+    dialogs/histogramdialog.ui \
+    widgets/gslibjobspanel.ui
 
 #==================== The Boost include path.==================
 _BOOST_INCLUDE = $$(BOOST_INCLUDE)
@@ -0,0 +1,12 @@
+#-------------------------------------------------
+#
+# Micro-benchmarks of performance critical classes.
+# They are built apart from GammaRay:
+#     qmake benchmarks/benchmarks.pro && make
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS = krigingsolver \
+          spatialindex
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Measures the GFLOP/s of the KrigingSolver factorization
+# and substitutions against plain LDLt loops.
+#
+#-------------------------------------------------
+
+# the Application header included by matrixmxn.h needs the Qt widgets headers
+QT       += core gui widgets
+
+TARGET = krigingsolverbenchmark
+TEMPLATE = app
+
+CONFIG += c++11 console release
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -m64
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../geostats/krigingsolver.cpp
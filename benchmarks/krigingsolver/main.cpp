@@ -0,0 +1,146 @@
+#include "geostats/krigingsolver.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+/**
+ * Measures the GFLOP/s of KrigingSolver::factorize() and KrigingSolver::solve(), the kriging systems solution
+ * of the NDV estimation and of the cross-validation, at the neighborhood sizes with compile-time kernels
+ * (8, 16, 32 and 64 samples) and at sizes only known at run time.  Textbook LDLt loops, without the
+ * vectorizable dot products and row updates, are timed as the reference.
+ */
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    /** The reference factorization: C = L D L^T with L unit lower triangular. */
+    bool referenceFactorize( const MatrixNXM<double>& c, std::vector<double>& L, std::vector<double>& D ){
+        unsigned int n = c.getN();
+        L.assign( n * n, 0.0 );
+        D.assign( n, 0.0 );
+        for( unsigned int j = 0; j < n; ++j ){
+            double d = c( j, j );
+            for( unsigned int k = 0; k < j; ++k )
+                d -= L[ j * n + k ] * L[ j * n + k ] * D[k];
+            if( ! ( d > 0.0 ) )
+                return false;
+            D[j] = d;
+            L[ j * n + j ] = 1.0;
+            for( unsigned int i = j + 1; i < n; ++i ){
+                double value = c( i, j );
+                for( unsigned int k = 0; k < j; ++k )
+                    value -= L[ i * n + k ] * L[ j * n + k ] * D[k];
+                L[ i * n + j ] = value / d;
+            }
+        }
+        return true;
+    }
+
+    /** The reference substitutions, with the backward one reading columns of L. */
+    void referenceSolve( const std::vector<double>& L, const std::vector<double>& D, std::vector<double>& b ){
+        int n = b.size();
+        for( int i = 1; i < n; ++i )
+            for( int k = 0; k < i; ++k )
+                b[i] -= L[ i * n + k ] * b[k];
+        for( int i = 0; i < n; ++i )
+            b[i] /= D[i];
+        for( int i = n - 1; i >= 0; --i )
+            for( int k = i + 1; k < n; ++k )
+                b[i] -= L[ k * n + i ] * b[k];
+    }
+
+    /** Makes the covariance matrix of random samples in a unit square (exponential model, range 0.5, 1% nugget). */
+    MatrixNXM<double> makeCovarianceMatrix( unsigned int n, std::mt19937& generator ){
+        std::uniform_real_distribution<double> distribution( 0.0, 1.0 );
+        std::vector<double> x( n ), y( n );
+        for( unsigned int i = 0; i < n; ++i ){
+            x[i] = distribution( generator );
+            y[i] = distribution( generator );
+        }
+        MatrixNXM<double> c( n, n );
+        for( unsigned int i = 0; i < n; ++i )
+            for( unsigned int j = 0; j < n; ++j ){
+                double h = std::sqrt( ( x[i] - x[j] ) * ( x[i] - x[j] ) + ( y[i] - y[j] ) * ( y[i] - y[j] ) );
+                c( i, j ) = ( i == j ? 1.0 : 0.99 * std::exp( -3.0 * h / 0.5 ) );
+            }
+        return c;
+    }
+
+    /** Repeats an operation for about a quarter of a second and returns its GFLOP/s. */
+    template<typename F>
+    double measure( double flops, F operation ){
+        unsigned long nOperations = 0;
+        unsigned long nRepetitions = 1;
+        double seconds = 0.0;
+        Clock::time_point start = Clock::now();
+        while( seconds < 0.25 ){
+            for( unsigned long i = 0; i < nRepetitions; ++i )
+                operation();
+            nOperations += nRepetitions;
+            nRepetitions *= 2;
+            seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+        }
+        return flops * nOperations / seconds / 1.0e9;
+    }
+}
+
+int main()
+{
+    std::mt19937 generator( 42 );
+    //the checksum keeps the compiler from discarding the results
+    double checksum = 0.0;
+    const unsigned int sizes[] = { 8, 16, 24, 32, 50, 64, 100 };
+
+    std::printf( "%-12s %6s %16s %16s %9s\n", "operation", "size", "LDLt GFLOP/s", "KrigingSolver", "speedup" );
+    for( unsigned int n : sizes ){
+        MatrixNXM<double> c = makeCovarianceMatrix( n, generator );
+        std::vector<double> rhs( n );
+        for( unsigned int i = 0; i < n; ++i )
+            rhs[i] = c( 0, i );
+
+        //the factorization: n^3/6 multiply-adds
+        std::vector<double> L, D;
+        KrigingSolver solver;
+        double factorizationFlops = n * (double)n * n / 3.0;
+        double reference = measure( factorizationFlops, [&](){
+            referenceFactorize( c, L, D );
+            checksum += D[ n - 1 ];
+        });
+        double optimized = measure( factorizationFlops, [&](){
+            solver.factorize( c );
+            checksum += solver.getSize();
+        });
+        std::printf( "%-12s %6u %16.2f %16.2f %8.1fx\n", "factorize", n, reference, optimized, optimized / reference );
+
+        //a right-hand side: 2n^2 multiply-adds
+        std::vector<double> b;
+        double solveFlops = 2.0 * n * n;
+        reference = measure( solveFlops, [&](){
+            b = rhs;
+            referenceSolve( L, D, b );
+            checksum += b[0];
+        });
+        optimized = measure( solveFlops, [&](){
+            b = rhs;
+            solver.solve( b );
+            checksum += b[0];
+        });
+        std::printf( "%-12s %6u %16.2f %16.2f %8.1fx\n", "solve", n, reference, optimized, optimized / reference );
+
+        //both must give the same weights
+        std::vector<double> b1 = rhs, b2 = rhs;
+        referenceSolve( L, D, b1 );
+        solver.solve( b2 );
+        double maxDifference = 0.0;
+        for( unsigned int i = 0; i < n; ++i )
+            maxDifference = std::max( maxDifference, std::abs( b1[i] - b2[i] ) );
+        if( maxDifference > 1.0e-9 )
+            std::printf( "the solutions differ by %g\n", maxDifference );
+    }
+    std::printf( "(checksum %g)\n", checksum );
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "spatialindex/spatialindexpoints.h"
+
+#include <QDir>
+#include <QFile>
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+/**
+ * Measures SpatialIndexPoints on random points (10 million by default, or the number given as the first
+ * argument): the packed build, the save() and load() round trip and the throughput of the n-nearest queries,
+ * one by one and in parallel batches.  An R*-tree filled by inserting the points one by one, as the index
+ * was built before the packed build, is timed as the reference.
+ */
+
+namespace {
+
+    namespace bg = boost::geometry;
+    namespace bgi = boost::geometry::index;
+    typedef bg::model::point<double, 3, bg::cs::cartesian> Point3D;
+    typedef bg::model::box<Point3D> Box;
+    typedef std::pair<Box, std::size_t> Value;
+
+    typedef std::chrono::steady_clock Clock;
+
+    double secondsSince( Clock::time_point start ){
+        return std::chrono::duration<double>( Clock::now() - start ).count();
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    const uint nPoints = argc > 1 ? (uint)std::atol( argv[1] ) : 10000000;
+    const uint nQueries = std::min<uint>( nPoints, 1000000 );
+    const uint nNeighbors = 8;
+
+    //points spread in a 10km x 10km x 1km box
+    std::printf( "Making %u random points...\n", nPoints );
+    std::mt19937 generator( 42 );
+    std::uniform_real_distribution<double> horizontal( 0.0, 10000.0 );
+    std::uniform_real_distribution<double> vertical( 0.0, 1000.0 );
+    std::vector<double> x( nPoints ), y( nPoints ), z( nPoints );
+    for( uint i = 0; i < nPoints; ++i ){
+        x[i] = horizontal( generator );
+        y[i] = horizontal( generator );
+        z[i] = vertical( generator );
+    }
+
+    //the reference: one insertion per point
+    Clock::time_point start = Clock::now();
+    {
+        bgi::rtree< Value, bgi::rstar<16,5,5,32> > tree;
+        for( uint i = 0; i < nPoints; ++i )
+            tree.insert( std::make_pair( Box( Point3D( x[i], y[i], z[i] ), Point3D( x[i], y[i], z[i] ) ), i ) );
+        std::printf( "R*-tree built by insertions:  %8.2f s\n", secondsSince( start ) );
+    }
+
+    //the packed index takes the coordinate arrays, so the query locations are copied first
+    std::vector<double> qx( x.begin(), x.begin() + nQueries );
+    std::vector<double> qy( y.begin(), y.begin() + nQueries );
+    std::vector<double> qz( z.begin(), z.begin() + nQueries );
+    start = Clock::now();
+    SpatialIndexPoints index( std::move( x ), std::move( y ), std::move( z ), 0.0 );
+    std::printf( "packed build:                 %8.2f s\n", secondsSince( start ) );
+
+    //the save and load round trip
+    QString path = QDir( QDir::tempPath() ).filePath( "spatialindexbenchmark.sidx" );
+    start = Clock::now();
+    if( ! index.save( path, "benchmark" ) ){
+        std::printf( "could not save the index to %s\n", path.toLocal8Bit().constData() );
+        return 1;
+    }
+    std::printf( "save:                         %8.2f s (%.0f MB)\n", secondsSince( start ),
+                 QFile( path ).size() / 1048576.0 );
+    start = Clock::now();
+    std::shared_ptr<SpatialIndexPoints> loaded = SpatialIndexPoints::load( path, "benchmark" );
+    double loadSeconds = secondsSince( start );
+    QFile::remove( path );
+    if( ! loaded || loaded->getPointCount() != nPoints ){
+        std::printf( "could not load the saved index\n" );
+        return 1;
+    }
+    std::printf( "load (with the packed build): %8.2f s\n", loadSeconds );
+
+    //the queries, one by one and in batches
+    std::size_t nFound = 0;
+    start = Clock::now();
+    for( uint i = 0; i < nQueries; ++i )
+        nFound += index.getNearest( i, nNeighbors + 1 ).size();
+    double seconds = secondsSince( start );
+    std::printf( "%u-nearest queries one by one:  %8.0f queries/s (%zu neighbors)\n",
+                 nNeighbors, nQueries / seconds, nFound );
+    SpatialIndexNeighborhoods neighborhoods;
+    start = Clock::now();
+    index.getNearest( qx.data(), qy.data(), qz.data(), nQueries, nNeighbors, neighborhoods );
+    seconds = secondsSince( start );
+    std::printf( "%u-nearest queries in batches:  %8.0f queries/s (%zu neighbors)\n",
+                 nNeighbors, nQueries / seconds, neighborhoods.indexes.size() );
+
+    return 0;
+}
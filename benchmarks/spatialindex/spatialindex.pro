@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Measures the build, save/load and query throughput of
+# SpatialIndexPoints on 10 million points.
+#
+#-------------------------------------------------
+
+QT       += core concurrent
+QT       -= gui
+
+TARGET = spatialindexbenchmark
+TEMPLATE = app
+
+CONFIG += c++11 console release
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -m64
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../spatialindex/spatialindexpoints.cpp
+
+#==================== The Boost include path.==================
+_BOOST_INCLUDE = $$(BOOST_INCLUDE)
+isEmpty(_BOOST_INCLUDE){
+    error(BOOST_INCLUDE environment variable not defined.)
+}
+INCLUDEPATH += $$_BOOST_INCLUDE
+#==============================================================
@@ -16,6 +16,7 @@
 #include <QDir>
 #include "domain/variogrammodel.h"
 #include "gslib/gslib.h"
+#include "geostats/gammabar.h"
 
 CreateGridDialog::CreateGridDialog(PointSet *pointSet, QWidget *parent) :
     QDialog(parent),
@@ -86,55 +87,32 @@ CreateGridDialog::~CreateGridDialog()
 
 void CreateGridDialog::runGammaBar()
 {
-    //read values entered by the user
-    m_gridParameters->updateValue( m_par );
-    //get selected variogram model
-    VariogramModel* vm = m_vModelList->getSelectedVModel();
     //makes sure user selected one model
-    if( !vm ){
+    if( ! m_vModelList->getSelectedVModel() ){
         QMessageBox::critical( this, "Error", "Please, select one variogram model.");
         return;
     }
+    updateVarianceLoss();
+}
 
-    GSLibParameterFile gpar("gammabar");
-    //set variogram model parameters
-    gpar.setVariogramModel( vm );
-    //set grid cell sizes
-    GSLibParMultiValuedFixed *par0 = gpar.getParameter<GSLibParMultiValuedFixed*>(0);
-    par0->getParameter<GSLibParDouble*>(0)->_value = m_par->_specs_x->getParameter<GSLibParDouble*>(2)->_value;
-    par0->getParameter<GSLibParDouble*>(1)->_value = m_par->_specs_y->getParameter<GSLibParDouble*>(2)->_value;
-    par0->getParameter<GSLibParDouble*>(2)->_value = m_par->_specs_z->getParameter<GSLibParDouble*>(2)->_value;
-    //leave block discretization as one
-    GSLibParMultiValuedFixed *par1 = gpar.getParameter<GSLibParMultiValuedFixed*>(1);
-    par1->getParameter<GSLibParUInt*>(0)->_value = ui->txtBlkDiscrX->text().toInt();
-    par1->getParameter<GSLibParUInt*>(1)->_value = ui->txtBlkDiscrY->text().toInt();
-    par1->getParameter<GSLibParUInt*>(2)->_value = ui->txtBlkDiscrZ->text().toInt();
-
-    //Generate the parameter file
-    //NOTE: due to a buggy input file setting in gammabar, the parameter file must be generated
-    //      in the same directory of the executable and the path is simply the file name, without a path.
-    QString par_file_path = Application::instance()->generateUniqueFilePathInGSLibDir("par");
-    gpar.save( par_file_path );
-
-    //to extract the filename from the path
-    QFileInfo par_fileinfo( par_file_path );
-    par_file_path = par_fileinfo.fileName();
-
-    //run gammabar program
-    //NOTE: do not pass the complete path to gammabar.
-    Application::instance()->logInfo("Starting gammabar program...");
-    GSLib::instance()->runProgram( "gammabar", par_file_path, true );
-
-    //get gammabar output text
-    QString gammabar_out = GSLib::instance()->getLastOutput();
-
-    //parse the gammabar text for the average variogram value
-    QRegularExpression re("average\\s*variogram\\s*=\\s*([^\\s]+)", QRegularExpression::MultilineOption | QRegularExpression::CaseInsensitiveOption );
-    double gamma_value = 0.0;
-    QRegularExpressionMatch match = re.match( gammabar_out );
-    if( match.hasMatch() ){
-        gamma_value = match.captured(1).toDouble();
-    }
+void CreateGridDialog::updateVarianceLoss()
+{
+    //get selected variogram model
+    VariogramModel* vm = m_vModelList->getSelectedVModel();
+    if( !vm )
+        return;
+
+    //read values entered by the user
+    m_gridParameters->updateValue( m_par );
+
+    //compute the average variogram within a grid cell (same result of the gammabar program)
+    double gamma_value = GammaBar::compute( vm,
+                                            m_par->_specs_x->getParameter<GSLibParDouble*>(2)->_value,
+                                            m_par->_specs_y->getParameter<GSLibParDouble*>(2)->_value,
+                                            m_par->_specs_z->getParameter<GSLibParDouble*>(2)->_value,
+                                            ui->txtBlkDiscrX->text().toInt(),
+                                            ui->txtBlkDiscrY->text().toInt(),
+                                            ui->txtBlkDiscrZ->text().toInt() );
 
     //compute variance loss due to current grid resolution against the selected variogram model.
     double variance_loss = gamma_value / vm->getSill() * 100;
@@ -142,10 +120,6 @@ void CreateGridDialog::runGammaBar()
     //display result
     ui->lblVarianceLoss->setText("<html><head/><body><p><span style=\" font-weight:600; color:#0000ff;\">Variance Loss = " +
                                  QString::number( variance_loss, 'f', 1) + "%</span></p></body></html>");
-
-    //delete the parameter file generated in the GSLib directory.
-    QFile file( par_fileinfo.absoluteFilePath() );
-    file.remove();
 }
 
 void CreateGridDialog::createGridAndClose()
@@ -225,6 +199,8 @@ void CreateGridDialog::calcN()
     m_par->_specs_z->getParameter<GSLibParUInt*>(0)->_value = nz;
     //update interface
     m_gridParameters->fillFields( m_par );
+    //the variance loss depends on the cell sizes
+    updateVarianceLoss();
 }
 
 void CreateGridDialog::preview()
@@ -268,5 +244,6 @@ void CreateGridDialog::onVariogramClicked()
     ui->lblNugget->setText("<html><head/><body><p><span style=\" font-weight:600; color:#ff0000;\">Nugget = " +
                            QString::number( nugget_prop, 'f', 1) + "%</span></p></body></html>");
 
-
+    //update the variance loss for the newly selected model
+    updateVarianceLoss();
 }
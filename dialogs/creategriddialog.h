@@ -27,6 +27,9 @@ private:
     WidgetGSLibParGrid* m_gridParameters;
     GSLibParGrid* m_par;
 
+    /** Computes and displays the variance loss of the current cell size for the selected variogram model. */
+    void updateVarianceLoss();
+
 private slots:
     void runGammaBar();
     void createGridAndClose();
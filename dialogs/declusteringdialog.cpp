@@ -12,6 +12,8 @@
 #include <QMessageBox>
 #include "filecontentsdialog.h"
 #include "displayplotdialog.h"
+#include "histogramdialog.h"
+#include "geostats/histogram.h"
 #include <QInputDialog>
 #include "util.h"
 
@@ -198,17 +200,16 @@ void DeclusteringDialog::onHistogram()
     gpf.getParameter<GSLibParDouble*>(11)->_value = input_data_file->mean( var_index-1 );
     //----------------------------------------------------------------------------------
 
-    //Generate the parameter file
-    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-    gpf.save( par_file_path );
+    //compute the weighted histogram in-process (histplt is run only if the user asks for the PostScript plot)
+    Histogram histogram;
+    histogram.compute( input_data_file, var_index-1, declus_weight_index-1,
+                       par0->_trimming_limits._min, par0->_trimming_limits._max );
 
-    //run histplt program
-    Application::instance()->logInfo("Starting histplt program...");
-    GSLib::instance()->runProgram( "histplt", par_file_path );
-
-    //display the plot output
-    DisplayPlotDialog *dpd = new DisplayPlotDialog(gpf.getParameter<GSLibParFile*>(1)->_path, title, gpf, this);
-    dpd->show(); //show() makes dialog modalless
+    //display the histogram
+    HistogramDialog *hd = new HistogramDialog( title, this );
+    hd->setHistogram( histogram, m_attribute->getName() );
+    hd->setGSLibPlot( gpf, gpf.getParameter<GSLibParFile*>(1)->_path );
+    hd->show(); //show() makes dialog modalless
 
     //discard the locally constructed PointSet object
     delete input_data_file;
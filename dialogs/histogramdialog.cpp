@@ -0,0 +1,121 @@
+#include "histogramdialog.h"
+#include "ui_histogramdialog.h"
+#include "widgets/histogramplot.h"
+#include "domain/application.h"
+#include "domain/project.h"
+#include "gslib/gslib.h"
+#include "gslib/gslibresultcache.h"
+#include "displayplotdialog.h"
+
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+HistogramDialog::HistogramDialog(const QString title, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::HistogramDialog)
+{
+    ui->setupUi(this);
+
+    //deletes dialog from memory upon user closing it
+    this->setAttribute(Qt::WA_DeleteOnClose);
+
+    //set dialog title
+    this->setWindowTitle( title );
+
+    //add the plot widget (not originally present in .UI file)
+    QVBoxLayout *vbl = new QVBoxLayout();
+    vbl->setSpacing(0);
+    vbl->setMargin(0);
+    ui->widgetPlace->setLayout( vbl );
+    m_plot = new HistogramPlot();
+    m_plot->setTitle( title );
+    vbl->addWidget( m_plot );
+
+    adjustSize();
+}
+
+HistogramDialog::~HistogramDialog()
+{
+    delete ui;
+}
+
+void HistogramDialog::setHistogram(const Histogram &histogram, const QString variableName)
+{
+    m_histogram = histogram;
+    m_plot->setXAxisLabel( variableName );
+    m_plot->setNumberOfClasses( ui->spinClasses->value() );
+    m_plot->setHistogram( &m_histogram );
+    updateStatistics();
+}
+
+void HistogramDialog::addRealization(const Histogram &histogram)
+{
+    if( histogram.isEmpty() )
+        return;
+    std::vector<double> values, probabilities;
+    histogram.getCDF( values, probabilities );
+    m_plot->addCDFCurve( values, probabilities, Qt::gray );
+    m_realizationSummaries.push_back( histogram.getSummary() );
+    if( m_realizationSummaries.size() == 1 )
+        ui->chkCumulative->setChecked( true );
+    updateStatistics();
+}
+
+void HistogramDialog::setGSLibPlot(GSLibParameterFile gpf, const QString path_to_postscript)
+{
+    m_gpf = gpf;
+    m_ps_file_path = path_to_postscript;
+    ui->btnGSLibPlot->setEnabled( true );
+}
+
+void HistogramDialog::updateStatistics()
+{
+    QString text = m_histogram.getSummaryText();
+    if( ! m_realizationSummaries.empty() ){
+        //show the fluctuation of the realizations' statistics
+        double minMean = std::numeric_limits<double>::max();
+        double maxMean = -std::numeric_limits<double>::max();
+        double minStdDev = std::numeric_limits<double>::max();
+        double maxStdDev = -std::numeric_limits<double>::max();
+        for( const HistogramSummary& summary : m_realizationSummaries ){
+            minMean = std::min( minMean, summary.mean );
+            maxMean = std::max( maxMean, summary.mean );
+            minStdDev = std::min( minStdDev, std::sqrt( summary.variance ) );
+            maxStdDev = std::max( maxStdDev, std::sqrt( summary.variance ) );
+        }
+        text += "\n\nRealizations: " + QString::number( m_realizationSummaries.size() );
+        text += "\nMeans: " + QString::number( minMean ) + " to " + QString::number( maxMean );
+        text += "\nStd. devs.: " + QString::number( minStdDev ) + " to " + QString::number( maxStdDev );
+    }
+    ui->lblStatistics->setText( text );
+}
+
+void HistogramDialog::onNumberOfClassesChanged(int number)
+{
+    m_plot->setNumberOfClasses( number );
+}
+
+void HistogramDialog::onCumulativeToggled(bool value)
+{
+    ui->spinClasses->setEnabled( ! value );
+    m_plot->setCumulative( value );
+}
+
+void HistogramDialog::onGSLibPlot()
+{
+    if( m_gpf.isEmpty() )
+        return;
+
+    //Generate the parameter file
+    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
+    m_gpf.save( par_file_path );
+
+    //run the GSLib program (or get the plot of an identical previous run)
+    GSLibResultCache::instance()->runProgram( m_gpf.getProgramName(), par_file_path, QStringList() << m_ps_file_path );
+
+    //display the plot output
+    DisplayPlotDialog *dpd = new DisplayPlotDialog( m_ps_file_path, windowTitle(), m_gpf, this );
+    dpd->show();
+}
@@ -0,0 +1,58 @@
+#ifndef HISTOGRAMDIALOG_H
+#define HISTOGRAMDIALOG_H
+
+#include <QDialog>
+#include <vector>
+#include "geostats/histogram.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
+
+namespace Ui {
+class HistogramDialog;
+}
+
+class HistogramPlot;
+
+/**
+ * The HistogramDialog class displays histograms computed in-process with the Histogram class, so
+ * the user can interactively change the number of classes and toggle the cumulative view.  Optionally,
+ * the distributions of an ensemble of realizations can be overlaid to the reference distribution.
+ * The PostScript plot with the corresponding GSLib program is still available on demand.
+ */
+class HistogramDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit HistogramDialog(const QString title, QWidget *parent = 0);
+    ~HistogramDialog();
+
+    /** Sets the main histogram (e.g. the variable or the reference distribution). */
+    void setHistogram( const Histogram& histogram, const QString variableName );
+
+    /** Adds the distribution of a realization, shown as a cdf curve in cumulative mode.
+     * The first call also turns the cumulative view on. */
+    void addRealization( const Histogram& histogram );
+
+    /** Enables the button to make a plot with the GSLib program configured in gpf.
+     * @param path_to_postscript The PostScript file set in gpf.
+     */
+    void setGSLibPlot( GSLibParameterFile gpf, const QString path_to_postscript );
+
+private:
+    Ui::HistogramDialog *ui;
+    HistogramPlot* m_plot;
+    Histogram m_histogram;
+    std::vector<HistogramSummary> m_realizationSummaries;
+    GSLibParameterFile m_gpf;
+    QString m_ps_file_path;
+
+    /** Updates the statistics text. */
+    void updateStatistics();
+
+private slots:
+    void onNumberOfClassesChanged( int number );
+    void onCumulativeToggled( bool value );
+    void onGSLibPlot();
+};
+
+#endif // HISTOGRAMDIALOG_H
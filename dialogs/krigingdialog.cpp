@@ -14,10 +14,12 @@
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslib.h"
+#include "geostats/crossvalidation.h"
 #include "util.h"
 
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <cmath>
 
 KrigingDialog::KrigingDialog(QWidget *parent) :
@@ -242,31 +244,117 @@ void KrigingDialog::onXValidation()
         return;
     }
 
-    //change only the kriging mode ( 1 = estimate for cross validation )
-    m_gpf_kt3d->getParameter<GSLibParOption*>(3)->_selected_value = 1;
+    //get the input data file
+    PointSet* input_data_file = (PointSet*)m_psSelector->getSelectedDataFile();
+    if( ! input_data_file ){
+        QMessageBox::critical( this, "Error", "Please, select a point set with the samples.");
+        return;
+    }
+
+    //the cross-validation is done in-process with the variogram model of the kt3d parameters (which
+    //the user may have edited)
+    QString var_model_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath( "vmodel" );
+    m_gpf_kt3d->saveVariogramModel( var_model_file_path );
+    VariogramModel variogram( var_model_file_path );
+
+    CrossValidation xvalidation( input_data_file,
+                                 m_PointSetVariableSelector->getSelectedVariableGEOEASIndex() - 1,
+                                 &variogram );
+
+    //trimming limits
+    GSLibParMultiValuedFixed *par2 = m_gpf_kt3d->getParameter<GSLibParMultiValuedFixed*>(2);
+    xvalidation.setTrimmingLimits( par2->getParameter<GSLibParDouble*>(0)->_value,
+                                   par2->getParameter<GSLibParDouble*>(1)->_value );
+
+    //kriging type
+    GSLibParMultiValuedFixed *par15 = m_gpf_kt3d->getParameter<GSLibParMultiValuedFixed*>(15);
+    switch( par15->getParameter<GSLibParOption*>(0)->_selected_value ){
+    case 0:
+        xvalidation.setKrigingType( KrigingType::SK, par15->getParameter<GSLibParDouble*>(1)->_value );
+        break;
+    case 1:
+        xvalidation.setKrigingType( KrigingType::OK );
+        break;
+    default:
+        Application::instance()->logWarn("KrigingDialog::onXValidation(): cross-validation supports only simple and"
+                                         " ordinary kriging.  Using ordinary kriging.");
+        xvalidation.setKrigingType( KrigingType::OK );
+    }
 
-    //Generate the parameter file
-    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath( "par" );
-    m_gpf_kt3d->save( par_file_path );
+    //search parameters: number of samples, max per octant, search ellipsoid radii and angles
+    GSLibParMultiValuedFixed *par11 = m_gpf_kt3d->getParameter<GSLibParMultiValuedFixed*>(11);
+    uint ndmin = par11->getParameter<GSLibParUInt*>(0)->_value;
+    uint ndmax = par11->getParameter<GSLibParUInt*>(1)->_value;
+    uint noct = m_gpf_kt3d->getParameter<GSLibParUInt*>(12)->_value;
+    GSLibParMultiValuedFixed *par13 = m_gpf_kt3d->getParameter<GSLibParMultiValuedFixed*>(13);
+    GSLibParMultiValuedFixed *par14 = m_gpf_kt3d->getParameter<GSLibParMultiValuedFixed*>(14);
+    SearchEllipsoid search( par13->getParameter<GSLibParDouble*>(0)->_value,
+                            par13->getParameter<GSLibParDouble*>(1)->_value,
+                            par13->getParameter<GSLibParDouble*>(2)->_value,
+                            par14->getParameter<GSLibParDouble*>(0)->_value,
+                            par14->getParameter<GSLibParDouble*>(1)->_value,
+                            par14->getParameter<GSLibParDouble*>(2)->_value,
+                            ndmax, noct );
+    xvalidation.setSearch( ndmin, search );
+
+    //if the search takes all other samples, use the global neighborhood shortcut: the maximum number
+    //of samples must cover all samples, there must be no octant limit and the search ellipsoid must
+    //contain the whole data extent (the largest anisotropic distance in a box is along one of its diagonals)
+    input_data_file->loadData();
+    bool searchCoversAll = ndmax + 1 >= input_data_file->getDataLineCount() && noct == 0;
+    if( searchCoversAll ){
+        double lx = input_data_file->max( input_data_file->getXindex() - 1 ) - input_data_file->min( input_data_file->getXindex() - 1 );
+        double ly = input_data_file->max( input_data_file->getYindex() - 1 ) - input_data_file->min( input_data_file->getYindex() - 1 );
+        double lz = 0.0;
+        if( input_data_file->is3D() )
+            lz = input_data_file->max( input_data_file->getZindex() - 1 ) - input_data_file->min( input_data_file->getZindex() - 1 );
+        searchCoversAll = search.getDistance2(  lx,  ly, lz ) <= search.getRadius2() &&
+                          search.getDistance2( -lx,  ly, lz ) <= search.getRadius2() &&
+                          search.getDistance2(  lx, -ly, lz ) <= search.getRadius2() &&
+                          search.getDistance2( -lx, -ly, lz ) <= search.getRadius2();
+    }
+    if( searchCoversAll ){
+        Application::instance()->logInfo("Search neighborhood covers all samples: using global neighborhood cross-validation.");
+        xvalidation.setGlobalNeighborhood( true );
+    }
 
-    //re-run kt3d program
-    Application::instance()->logInfo("Starting kt3d program...");
-    GSLib::instance()->runProgram( "kt3d", par_file_path );
+    Application::instance()->logInfo("Starting cross-validation...");
+    QProgressDialog progressDialog;
+    progressDialog.show();
+    progressDialog.setMinimum( 0 );
+    progressDialog.setMaximum( 100 );
+    progressDialog.setValue( 0 );
+    connect( &xvalidation, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)) );
+    connect( &xvalidation, SIGNAL(setLabel(QString)), &progressDialog, SLOT(setLabelText(QString)) );
+    bool ok = xvalidation.run();
+    progressDialog.hide();
+
+    //the output goes to the kt3d output file, as before
+    QString xvalidation_file_path = m_gpf_kt3d->getParameter<GSLibParFile*>(8)->_path;
+    if( ! ok || ! xvalidation.writeToFile( xvalidation_file_path ) ){
+        QMessageBox::critical( this, "Error", "Cross-validation failed.  Check the message panel for details.");
+        return;
+    }
 
-    //get the tmp file path created by kt3d with the sample values and estimates
-    QString estimation_file_path = m_gpf_kt3d->getParameter<GSLibParFile*>(8)->_path;
+    //report the error statistics
+    const CrossValidationStatistics& stats = xvalidation.getStatistics();
+    Application::instance()->logInfo("Cross-validation completed: " + QString::number( stats.count ) + " samples estimated.");
+    Application::instance()->logInfo("   mean error (est-true): " + QString::number( stats.meanError ));
+    Application::instance()->logInfo("   mean squared error: " + QString::number( stats.meanSquaredError ));
+    Application::instance()->logInfo("   mean standardized squared error: " + QString::number( stats.meanStandardizedSquaredError ));
+    Application::instance()->logInfo("   correlation true x estimate: " + QString::number( stats.correlation ));
 
-    //create a new point set object corresponding to the file created by kt3d
-    PointSet* ps = new PointSet( estimation_file_path );
+    //create a new point set object corresponding to the cross-validation output file
+    PointSet* ps = new PointSet( xvalidation_file_path );
 
-    //expecting kt3d outputs a x-validation point-set with coordinates X, Y, Z (even if the samples are 2D)
-    //as columns 1, 2 and 3 and with no-data-values equal to -999
+    //the cross-validation output has coordinates X, Y, Z (even if the samples are 2D)
+    //as columns 1, 2 and 3 and no-data-values equal to -999
     ps->setInfo( 1, 2, 3, "-999");
 
-    //get the variable with the sample values (normally the 4th)
+    //get the variable with the sample values (the 4th)
     Attribute* true_var = (Attribute*)ps->getChildByIndex( 3 );
 
-    //get the variable with the estimation values (normally the 5th)
+    //get the variable with the estimation values (the 5th)
     Attribute* est_var = (Attribute*)ps->getChildByIndex( 4 );
 
     //open the plot dialog
@@ -350,6 +438,7 @@ void KrigingDialog::onSaveOrUpdateVModel()
                 //Overwrites the existing variogram model file (vmodel parameter file)
                 QString var_model_file_path = variogram->getPath();
                 m_gpf_kt3d->saveVariogramModel( var_model_file_path );
+                variogram->setChanged();
             }
         } else { //save a new variogram model
             //Generate the parameter file in the tmp directory as if we were about to run vmodel
@@ -11,6 +11,7 @@
 #include "gslib/gslibparameterfiles/gslibparameterfile.h"
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslib.h"
+#include "gslib/gslibjobscheduler.h"
 #include "dialogs/displayplotdialog.h"
 
 MultiVariogramDialog::MultiVariogramDialog(const std::vector<Attribute *> attributes,
@@ -105,9 +106,9 @@ void MultiVariogramDialog::onGam()
     //if the user didn't cancel the dialog...
     if( result == QDialog::Accepted ){
         std::vector<QString> expVarFilePaths;
+        std::vector<GSLibJobPtr> jobs;
 
         //set attributes that must vary for each variable...
-        //TODO: these can be done in parallel
         it = validAttributes.begin();
         for(; it != validAttributes.end(); ++it){
             //get the Attribute
@@ -167,12 +168,15 @@ void MultiVariogramDialog::onGam()
             QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
             m_gpf_gam->save( par_file_path );
 
-            //...run gam program
-            Application::instance()->logInfo("Starting gam program for variable " +
-                                             at->getName() + " in file " + cg->getName() + "...");
-            GSLib::instance()->runProgram( "gam", par_file_path );
+            //...submit a gam run (the runs execute concurrently)
+            jobs.push_back( GSLibJobScheduler::instance()->submit( "gam", par_file_path,
+                                                                   "gam for variable " + at->getName() +
+                                                                   " in file " + cg->getName() ) );
         }
 
+        //wait for all gam runs to finish
+        if( ! GSLibJobScheduler::instance()->waitForAll( jobs ) )
+            Application::instance()->logWarn("Some gam runs did not complete normally.  Check the message panel for details.");
 
         onVargplt( expVarFilePaths );
     }
@@ -12,6 +12,7 @@
 #include "util.h"
 
 #include <QInputDialog>
+#include <QListWidgetItem>
 
 NDVEstimationDialog::NDVEstimationDialog(Attribute *at, QWidget *parent) :
     QDialog(parent),
@@ -34,6 +35,16 @@ NDVEstimationDialog::NDVEstimationDialog(Attribute *at, QWidget *parent) :
 
     ui->frmVariogramPlaceholder->layout()->addWidget( _vmSelector );
 
+    //list the other variables of the grid, which can be estimated in the same run
+    std::vector<ProjectComponent*> all_contained_objects;
+    at->getContainingFile()->getAllObjects( all_contained_objects );
+    std::vector<ProjectComponent*>::iterator it = all_contained_objects.begin();
+    for(; it != all_contained_objects.end(); ++it){
+        ProjectComponent* pc = (ProjectComponent*)(*it);
+        if( pc->isAttribute() && pc != at )
+            ui->lstOtherVariables->addItem( new QListWidgetItem( pc->getIcon(), pc->getName() ) );
+    }
+
     updateMetricSizeLabels();
 }
 
@@ -79,6 +90,9 @@ void NDVEstimationDialog::run()
 
     //run the estimation
     NDVEstimation* estimation = new NDVEstimation( _at );
+    QList<QListWidgetItem*> selectedItems = ui->lstOtherVariables->selectedItems();
+    for( QListWidgetItem* item : selectedItems )
+        estimation->addAttribute( (Attribute*)cg->getChildByName( item->text() ) );
     estimation->setSearchParameters( ui->spinNbSamples->value(),
                                      ui->spinNCols->value(),
                                      ui->spinNRows->value(),
@@ -91,7 +105,10 @@ void NDVEstimationDialog::run()
         estimation->setKtype( KrigingType::SK );
     else
         estimation->setKtype( KrigingType::OK );
-    std::vector<double> results = estimation->run();
+    if( estimation->run().empty() ){
+        delete estimation;
+        return;
+    }
 
     //make a tmp file path
     QString tmp_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("dat");
@@ -103,7 +120,8 @@ void NDVEstimationDialog::run()
     new_cg->setInfoFromOtherCG( cg, false );
 
     //save the results in the project's tmp directory
-    Util::createGEOEASGrid( _at->getName(), results, tmp_file_path);
+    estimation->writeToFile( tmp_file_path );
+    delete estimation;
 
     //import the saved file to the project
     Application::instance()->getProject()->importCartesianGrid( new_cg, new_cg_name );
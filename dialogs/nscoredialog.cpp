@@ -10,13 +10,18 @@
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslib.h"
+#include "gslib/gslibresultcache.h"
+#include "geostats/normalscoretransform.h"
 #include "displayplotdialog.h"
 #include "util.h"
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QLineEdit>
 #include <QFileInfo>
+#include <QTextStream>
 #include <cmath>
+#include <sstream>
+#include <iomanip>
 
 NScoreDialog::NScoreDialog(Attribute *attribute, QWidget *parent) :
     QDialog(parent),
@@ -99,12 +104,16 @@ void NScoreDialog::onParams()
         GSLibParametersDialog gslibpardiag ( m_gpf_nscore );
         int result = gslibpardiag.exec();
         if( result == QDialog::Accepted ){
-            //Generate the parameter file
-            QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-            m_gpf_nscore->save( par_file_path );
-            //run nscore program
-            Application::instance()->logInfo("Starting nscore program...");
-            GSLib::instance()->runProgram( "nscore", par_file_path );
+            //transformation according to a reference distribution is still delegated to nscore
+            bool useReferenceDistribution = m_gpf_nscore->getParameter<GSLibParOption*>(3)->_selected_value == 1;
+            if( useReferenceDistribution || ! doNScoreNative( input_file ) ){
+                //Generate the parameter file
+                QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
+                m_gpf_nscore->save( par_file_path );
+                //run nscore program
+                Application::instance()->logInfo("Starting nscore program...");
+                GSLib::instance()->runProgram( "nscore", par_file_path );
+            }
         } else {
             discard_parameters = true;
         }
@@ -274,9 +283,9 @@ void NScoreDialog::doHistogramCommon(DataFile *input_data_file)
     QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
     gpf.save( par_file_path );
 
-    //run histplt program
-    Application::instance()->logInfo("Starting histplt program...");
-    GSLib::instance()->runProgram( "histplt", par_file_path );
+    //run histplt program (or get the plot of an identical previous run)
+    GSLibResultCache::instance()->runProgram( "histplt", par_file_path,
+                                              QStringList() << gpf.getParameter<GSLibParFile*>(1)->_path );
 
     //display the plot output
     DisplayPlotDialog *dpd = new DisplayPlotDialog(gpf.getParameter<GSLibParFile*>(1)->_path, title, gpf, this);
@@ -285,3 +294,81 @@ void NScoreDialog::doHistogramCommon(DataFile *input_data_file)
     //discard the locally constructed CartesianGrid object
     delete input_data_file;
 }
+
+bool NScoreDialog::doNScoreNative(DataFile *input_file)
+{
+    //get the variable and weight columns (GEO-EAS indexes, weight == 0 means no weight)
+    GSLibParMultiValuedFixed* par1 = m_gpf_nscore->getParameter<GSLibParMultiValuedFixed*>(1);
+    uint var_index = par1->getParameter<GSLibParUInt*>(0)->_value;
+    uint wgt_index = par1->getParameter<GSLibParUInt*>(1)->_value;
+
+    //get the trimming limits
+    GSLibParMultiValuedFixed *par2 = m_gpf_nscore->getParameter<GSLibParMultiValuedFixed*>(2);
+    double tmin = par2->getParameter<GSLibParDouble*>(0)->_value;
+    double tmax = par2->getParameter<GSLibParDouble*>(1)->_value;
+
+    uint nLines = input_file->getDataLineCount();
+    uint nCols = input_file->getDataColumnCount();
+    if( var_index < 1 || var_index > nCols || wgt_index > nCols ){
+        Application::instance()->logError("NScoreDialog::doNScoreNative(): invalid variable or weight column.");
+        return false;
+    }
+
+    //collect the values and weights
+    std::vector<double> values;
+    std::vector<double> weights;
+    values.reserve( nLines );
+    if( wgt_index > 0 )
+        weights.reserve( nLines );
+    for( uint line = 0; line < nLines; ++line ){
+        values.push_back( input_file->data( line, var_index-1 ) );
+        if( wgt_index > 0 )
+            weights.push_back( input_file->data( line, wgt_index-1 ) );
+    }
+
+    //build the transform table
+    NormalScoreTransform nscore;
+    if( ! nscore.build( values, weights, tmin, tmax ) )
+        return false;
+
+    //transform the values (-999 for values outside the trimming limits, as nscore does)
+    std::vector<double> normalScores;
+    nscore.toNormal( values, normalScores );
+    for( uint line = 0; line < nLines; ++line )
+        if( values[line] < tmin || values[line] >= tmax )
+            normalScores[line] = -999.0;
+
+    //write the output file: the input file with the normal scores appended as the last column
+    QString output_path = m_gpf_nscore->getParameter<GSLibParFile*>(6)->_path;
+    QFile outputFile( output_path );
+    if( ! outputFile.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError("NScoreDialog::doNScoreNative(): could not create " + output_path);
+        return false;
+    }
+    QTextStream out(&outputFile);
+    out << Util::getGEOEAScomment( input_file->getPath() ) << endl;
+    QStringList field_names = Util::getFieldNames( input_file->getPath() );
+    out << field_names.size() + 1 << endl;
+    for( const QString& field_name : field_names )
+        out << field_name << endl;
+    out << "Normal Score value" << endl;
+    for( uint line = 0; line < nLines; ++line ){
+        //making sure the values are written in GSLib-like precision
+        std::stringstream ss;
+        ss << std::setprecision( 12 );
+        for( uint col = 0; col < nCols; ++col )
+            ss << input_file->data( line, col ) << '\t';
+        ss << normalScores[line];
+        out << ss.str().c_str() << endl;
+    }
+    outputFile.close();
+
+    //write the transform table
+    if( ! nscore.saveTable( m_gpf_nscore->getParameter<GSLibParFile*>(7)->_path ) )
+        return false;
+
+    Application::instance()->logInfo("NScoreDialog::doNScoreNative(): normal scores computed for " +
+                                     QString::number( values.size() ) + " values (" +
+                                     QString::number( nscore.size() ) + " distinct values in the transform table).");
+    return true;
+}
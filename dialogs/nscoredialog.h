@@ -33,6 +33,8 @@ private:
     void doHistogramPointSet();
     void doHistogramGrid();
     void doHistogramCommon(DataFile* input_data_file);
+    /** Computes the normal scores in-process, writing the same output and transform table files as nscore. */
+    bool doNScoreNative( DataFile* input_file );
 };
 
 #endif // NSCOREDIALOG_H
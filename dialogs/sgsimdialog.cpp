@@ -12,6 +12,7 @@
 #include "gslib/gslibparams/widgets/widgetgslibpargrid.h"
 #include "gslib/gslibparametersdialog.h"
 #include "gslib/gslib.h"
+#include "gslib/gslibjobscheduler.h"
 #include "widgets/cartesiangridselector.h"
 #include "widgets/pointsetselector.h"
 #include "widgets/variableselector.h"
@@ -19,10 +20,14 @@
 #include "widgets/variogrammodelselector.h"
 #include "widgets/distributionfieldselector.h"
 #include "dialogs/displayplotdialog.h"
+#include "dialogs/histogramdialog.h"
+#include "geostats/histogram.h"
+#include "geostats/ensemblepostprocessor.h"
 #include "util.h"
 
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
 
 SGSIMDialog::SGSIMDialog( QWidget *parent) :
     QDialog(parent),
@@ -518,18 +523,34 @@ void SGSIMDialog::onEnsembleHistogram()
 
     //----------------------------------------------------------------------------------
 
-    //Generate the parameter file
-    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-    gpf.save( par_file_path );
-
-    //run histpltsim program
-    Application::instance()->logInfo("Starting histpltsim program...");
-    GSLib::instance()->runProgram( "histpltsim", par_file_path );
-
-    //display the plot output
-    DisplayPlotDialog *dpd = new DisplayPlotDialog(gpf.getParameter<GSLibParFile*>(10)->_path, title, gpf, this);
-    dpd->show(); //show() makes dialog modalless
+    //--------------compute the histograms in-process (histpltsim only runs on demand)------------------
+
+    //the reference distribution
+    GSLibParMultiValuedFixed* sgsim_par2 = m_gpf_sgsim->getParameter<GSLibParMultiValuedFixed*>(2);
+    Histogram reference;
+    reference.computeFromGEOEASFile( gpf.getParameter<GSLibParFile*>(2)->_path,
+                                     par3->getParameter<GSLibParUInt*>(0)->_value,
+                                     par3->getParameter<GSLibParUInt*>(1)->_value,
+                                     sgsim_par2->getParameter<GSLibParDouble*>(0)->_value,
+                                     sgsim_par2->getParameter<GSLibParDouble*>(1)->_value );
+
+    HistogramDialog *hd = new HistogramDialog( title, this );
+    hd->setHistogram( reference, m_primVarSelector->getSelectedVariableName() );
+
+    //the distribution of each realization (each one is binned in parallel)
+    uint nCells = gridRealizations->getNX() * gridRealizations->getNY() * gridRealizations->getNZ();
+    uint column = realizationsAttribute->getAttributeGEOEASgivenIndex()-1;
+    for( uint iReal = 0; iReal < gridRealizations->getNReal(); ++iReal ){
+        Histogram realization;
+        if( realization.compute( gridRealizations, column, -1,
+                                 par9->getParameter<GSLibParDouble*>(0)->_value,
+                                 par9->getParameter<GSLibParDouble*>(1)->_value,
+                                 iReal * nCells, (iReal+1) * nCells - 1 ) )
+            hd->addRealization( realization );
+    }
 
+    hd->setGSLibPlot( gpf, gpf.getParameter<GSLibParFile*>(10)->_path );
+    hd->show(); //show() makes dialog modalless
 }
 
 void SGSIMDialog::onEnsembleVariogram()
@@ -604,6 +625,7 @@ void SGSIMDialog::onEnsembleVariogram()
     GSLibParametersDialog gslibpardiag( m_gpf_gam );
     int result = gslibpardiag.exec();
     std::vector<QString> expVarFilePaths;
+    std::vector<GSLibJobPtr> jobs;
     if( result == QDialog::Accepted ){
         //save the realization number setting for the variogram modeling workflow
         int oldNReal = m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value;
@@ -618,13 +640,15 @@ void SGSIMDialog::onEnsembleVariogram()
             //...Generate the parameter file
             QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
             m_gpf_gam->save( par_file_path );
-            //...run gam program
-            Application::instance()->logInfo("Starting gam program for realization " +
-                                             QString::number(iRealNum + 1) + "...");
-            GSLib::instance()->runProgram( "gam", par_file_path );
+            //...submit a gam run (the runs execute concurrently)
+            jobs.push_back( GSLibJobScheduler::instance()->submit( "gam", par_file_path,
+                                                                   "gam for realization " + QString::number(iRealNum + 1) ) );
         }
         //restore the realization number setting for the variogram modeling workflow
         m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value = oldNReal;
+        //wait for all gam runs to finish
+        if( ! GSLibJobScheduler::instance()->waitForAll( jobs ) )
+            Application::instance()->logWarn("Some gam runs did not complete normally.  Check the message panel for details.");
     }
 
     //---------------------------------------------------------------------------------------------------------------
@@ -828,13 +852,45 @@ void SGSIMDialog::onPostsim()
 
     //if user didn't cancel the dialog
     if( result == QDialog::Accepted ){
-        //Generate the parameter file
-        QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath( "par" );
-        m_gpf_postsim->save( par_file_path );
+        //the post-processing is done in-process, in a single pass through the realizations
+        EnsemblePostProcessor postprocessor( m_cg_simulation, 0 );
+        postprocessor.setTrimmingLimits( par2->getParameter<GSLibParDouble*>(0)->_value,
+                                         par2->getParameter<GSLibParDouble*>(1)->_value );
+
+        //set the product according to the postsim output option
+        GSLibParMultiValuedFixed* par5 = m_gpf_postsim->getParameter<GSLibParMultiValuedFixed*>(5);
+        double outputParameter = par5->getParameter<GSLibParDouble*>(1)->_value;
+        switch( par5->getParameter<GSLibParOption*>(0)->_selected_value ){
+        case 1: //E-type and conditional variance
+            postprocessor.setComputeMoments( true );
+            break;
+        case 2: //probability and mean above threshold
+            postprocessor.addThreshold( outputParameter );
+            break;
+        case 3: //percentile
+            postprocessor.addQuantile( outputParameter );
+            break;
+        case 4: //symmetric probability interval
+            postprocessor.addQuantile( ( 1.0 - outputParameter ) / 2.0 );
+            postprocessor.addQuantile( ( 1.0 + outputParameter ) / 2.0 );
+        }
 
-        //run postsim program asynchronously
-        Application::instance()->logInfo("Starting postsim program...");
-        GSLib::instance()->runProgram( "postsim", par_file_path );
+        Application::instance()->logInfo("Post-processing realizations...");
+        QProgressDialog progressDialog;
+        progressDialog.show();
+        progressDialog.setMinimum( 0 );
+        progressDialog.setMaximum( 100 );
+        progressDialog.setValue( 0 );
+        connect( &postprocessor, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)) );
+        connect( &postprocessor, SIGNAL(setLabel(QString)), &progressDialog, SLOT(setLabelText(QString)) );
+        bool ok = postprocessor.run();
+        progressDialog.hide();
+
+        if( ! ok || ! postprocessor.writeToFile( m_gpf_postsim->getParameter<GSLibParFile*>(4)->_path ) ){
+            QMessageBox::critical( this, "Error", "Post-processing failed.  Check the message panel for details.");
+            return;
+        }
+        Application::instance()->logInfo("Post-processing completed.");
 
         previewPostsim();
     }
@@ -6,6 +6,8 @@
 #include "gslib/gslibparameterfiles/gslibparameterfile.h"
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "gslib/gslib.h"
+#include "gslib/gslibjobscheduler.h"
+#include "gslib/gslibresultcache.h"
 #include "gslib/gslibparametersdialog.h"
 #include "domain/project.h"
 #include "domain/attribute.h"
@@ -13,8 +15,10 @@
 #include "realizationselectiondialog.h"
 #include <QMessageBox>
 #include "displayplotdialog.h"
+#include "geostats/variogramfitter.h"
 #include <QDir>
 #include <QInputDialog>
+#include <QProgressDialog>
 #include <cmath>
 #include <util.h>
 
@@ -103,6 +107,7 @@ void VariogramAnalysisDialog::finishUISetup()
         ui->btnModelVarioPar->setIcon( QIcon(":icons32/setting32") );
         ui->btnModelVarioPlot->setIcon( QIcon(":icons32/plot32") );
         ui->btnModelVarioSave->setIcon( QIcon(":icons32/save32") );
+        ui->btnModelVarioFit->setIcon( QIcon(":icons32/play32") );
         ui->btnVarioMapSave->setIcon( QIcon(":icons32/save32") );
         ui->btnVarmapPar->setIcon( QIcon(":icons32/setting32") );
         ui->btnVarmapPlot->setIcon( QIcon(":icons32/plot32") );
@@ -218,9 +223,19 @@ void VariogramAnalysisDialog::onOpenVarMapParameters()
         //Generate the parameter file
         QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
         m_gpf_varmap->save( par_file_path );
+        //use the results of an identical previous run, if any
+        QStringList output_paths = QStringList() << m_gpf_varmap->getParameter<GSLibParFile*>(7)->_path;
+        m_varmap_cache_key = GSLibResultCache::instance()->makeKey( "varmap", par_file_path, output_paths );
+        if( GSLibResultCache::instance()->fetch( m_varmap_cache_key, output_paths ) ){
+            Application::instance()->logInfo("Using cached results of a previous varmap run.");
+            onOpenVarMapPlot();
+            return;
+        }
         //to be notified when varmap completes.
         connect( GSLib::instance(), SIGNAL(programFinished()), this, SLOT(onVarmapCompletion()) );
         //run varmap program asynchronously (user can see the program outputs while it runs)
+        QFile::remove( output_paths.first() );
+        m_varmap_start_time = QDateTime::currentDateTime();
         Application::instance()->logInfo("Starting varmap program...");
         GSLib::instance()->runProgramAsync( "varmap", par_file_path );
     }
@@ -468,6 +483,85 @@ void VariogramAnalysisDialog::onOpenVariogramModelParamateres()
         return;
     }
 
+    makeVModelParameters();
+
+    //show the parameter dialog so the user can review and adjust other settings before running vmodel
+    GSLibParametersDialog gslibpardiag( m_gpf_vmodel );
+    int result = gslibpardiag.exec();
+    if( result == QDialog::Accepted ){
+        runVModel();
+    }
+}
+
+void VariogramAnalysisDialog::onFitVariogramModel()
+{
+    if( !m_gpf_gam and !m_gpf_gamv and !m_ev ){
+        QMessageBox::critical( this, "Error", "To perform variogam fitting, you must first compute the experimental variogram at least once.");
+        return;
+    }
+
+    makeVModelParameters();
+
+    //get the experimental variogram data
+    QString path_to_exp_variogram_data;
+    if( m_gpf_gamv )
+        path_to_exp_variogram_data = m_gpf_gamv->getParameter<GSLibParFile*>(4)->_path;
+    if( m_gpf_gam )
+        path_to_exp_variogram_data = m_gpf_gam->getParameter<GSLibParFile*>(3)->_path;
+    if( m_ev )
+        path_to_exp_variogram_data = m_ev->getPath();
+    std::vector<ExperimentalVariogramDirection> directions;
+    if( ! VariogramFitter::readExperimentalVariogram( path_to_exp_variogram_data, directions ) ){
+        QMessageBox::critical( this, "Error", "Could not read the experimental variogram.  Check the message panel for details.");
+        return;
+    }
+
+    //the directions are not in the experimental variogram file, so get them from the vmodel parameters,
+    //which were suggested from the experimental variogram computation parameters
+    GSLibParRepeat *par2 = m_gpf_vmodel->getParameter<GSLibParRepeat*>(2); //repeat ndir-times
+    for( uint i = 0; i < directions.size() && i < par2->getCount(); ++i )
+    {
+        GSLibParMultiValuedFixed *par2_0 = par2->getParameter<GSLibParMultiValuedFixed*>(i, 0);
+        directions[i].azimuth = par2_0->getParameter<GSLibParDouble*>(0)->_value;
+        directions[i].dip = par2_0->getParameter<GSLibParDouble*>(1)->_value;
+    }
+
+    //ask for the number of nested structures
+    bool ok;
+    int nst = QInputDialog::getInt(this, "Variogram model fitting", "Number of nested structures:", 1, 1, 3, 1, &ok);
+    if( ! ok )
+        return;
+
+    //fit the model
+    VariogramFitter fitter;
+    fitter.setExperimentalVariogram( directions );
+    fitter.setNumberOfStructures( nst );
+    Application::instance()->logInfo("Fitting variogram model...");
+    QProgressDialog progressDialog;
+    progressDialog.show();
+    progressDialog.setMinimum( 0 );
+    progressDialog.setMaximum( 100 );
+    progressDialog.setValue( 0 );
+    connect( &fitter, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)) );
+    connect( &fitter, SIGNAL(setLabel(QString)), &progressDialog, SLOT(setLabelText(QString)) );
+    bool fitted = fitter.fit();
+    progressDialog.hide();
+    if( ! fitted ){
+        QMessageBox::critical( this, "Error", "Variogram model fitting failed.  Check the message panel for details.");
+        return;
+    }
+    Application::instance()->logInfo("Variogram model fitted (misfit = " +
+                                     QString::number( fitter.getObjectiveValue() ) + ").");
+
+    //set the fitted model to the vmodel parameters, so it can be reviewed, plotted and saved as usual
+    fitter.setVModelParameters( m_gpf_vmodel );
+
+    //run vmodel only to plot the fitted model
+    runVModel();
+}
+
+void VariogramAnalysisDialog::makeVModelParameters()
+{
     //suggest number of directions based on the previous experimental variogram computation
     uint ndir = 1; //default for variogram fitting mode
     if( m_gpf_gamv )
@@ -624,20 +718,18 @@ void VariogramAnalysisDialog::onOpenVariogramModelParamateres()
             par2_0->getParameter<GSLibParDouble*>(2)->_value = lags[i];
         }
     }
+}
 
-    //show the parameter dialog so the user can review and adjust other settings before running vmodel
-    GSLibParametersDialog gslibpardiag( m_gpf_vmodel );
-    int result = gslibpardiag.exec();
-    if( result == QDialog::Accepted ){
-        //Generate the parameter file
-        QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-        m_gpf_vmodel->save( par_file_path );
-        //to be notified when vmap completes.
-        connect( GSLib::instance(), SIGNAL(programFinished()), this, SLOT(onVmodelCompletion()) );
-        //run vmodel program asynchronously (user can see the program outputs while it runs)
-        Application::instance()->logInfo("Starting vmodel program...");
-        GSLib::instance()->runProgramAsync( "vmodel", par_file_path );
-    }
+void VariogramAnalysisDialog::runVModel()
+{
+    //Generate the parameter file
+    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
+    m_gpf_vmodel->save( par_file_path );
+    //to be notified when vmap completes.
+    connect( GSLib::instance(), SIGNAL(programFinished()), this, SLOT(onVmodelCompletion()) );
+    //run vmodel program asynchronously (user can see the program outputs while it runs)
+    Application::instance()->logInfo("Starting vmodel program...");
+    GSLib::instance()->runProgramAsync( "vmodel", par_file_path );
 }
 
 void VariogramAnalysisDialog::onVmodelCompletion()
@@ -832,6 +924,11 @@ void VariogramAnalysisDialog::onVarmapCompletion()
 {
     //frees all signal connections to the GSLib singleton.
     GSLib::instance()->disconnect();
+    //keep the results for identical runs
+    if( GSLib::instance()->isLastRunSuccessful() )
+        GSLibResultCache::instance()->store( m_varmap_cache_key,
+                                             QStringList() << m_gpf_varmap->getParameter<GSLibParFile*>(7)->_path,
+                                             m_varmap_start_time );
     //when varmap completes, call pixelplt to plot the varmap grid.
     onOpenVarMapPlot();
 }
@@ -1046,9 +1143,9 @@ void VariogramAnalysisDialog::onVargplt(const QString path_to_exp_variogram_data
     QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
     m_gpf_vargplt->save( par_file_path );
 
-    //run vargplt program
-    Application::instance()->logInfo("Starting vargplt program...");
-    GSLib::instance()->runProgram( "vargplt", par_file_path );
+    //run vargplt program (or get the plot of an identical previous run)
+    GSLibResultCache::instance()->runProgram( "vargplt", par_file_path,
+                                              QStringList() << m_gpf_vargplt->getParameter<GSLibParFile*>(0)->_path );
 
     GSLibParameterFile gpf = *m_gpf_vargplt;
 
@@ -1156,14 +1253,15 @@ void VariogramAnalysisDialog::onGam(bool forMultipleRealizations)
             //Generate the parameter file
             QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
             m_gpf_gam->save( par_file_path );
-            //run gam program
-            Application::instance()->logInfo("Starting gam program...");
-            GSLib::instance()->runProgram( "gam", par_file_path );
+            //run gam program (or get the results of an identical previous run)
+            GSLibResultCache::instance()->runProgram( "gam", par_file_path,
+                                                      QStringList() << m_gpf_gam->getParameter<GSLibParFile*>(3)->_path );
             onVargpltExperimentalRegular();
 
         } else { //usage for simulation validation (plot of several realization variograms)
 
             std::vector<QString> expVarFilePaths;
+            std::vector<GSLibJobPtr> jobs;
             std::vector<int> reals = m_realsSelecDiag->getSelectedRealizations();
             std::vector<int>::iterator it = reals.begin();
             //save the realization number setting for the variogram modeling workflow
@@ -1180,13 +1278,15 @@ void VariogramAnalysisDialog::onGam(bool forMultipleRealizations)
                 //...Generate the parameter file
                 QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
                 m_gpf_gam->save( par_file_path );
-                //...run gam program
-                Application::instance()->logInfo("Starting gam program for realization " +
-                                                 QString::number(realNum) + "...");
-                GSLib::instance()->runProgram( "gam", par_file_path );
+                //...submit a gam run (the runs execute concurrently)
+                jobs.push_back( GSLibJobScheduler::instance()->submit( "gam", par_file_path,
+                                                                       "gam for realization " + QString::number(realNum) ) );
             }
             //restore the realization number setting for the variogram modeling workflow
             m_gpf_gam->getParameter<GSLibParUInt*>(4)->_value = oldNReal;
+            //wait for all gam runs to finish
+            if( ! GSLibJobScheduler::instance()->waitForAll( jobs ) )
+                Application::instance()->logWarn("Some gam runs did not complete normally.  Check the message panel for details.");
             onVargpltNReals( expVarFilePaths );
 
         }
@@ -1324,9 +1424,9 @@ void VariogramAnalysisDialog::onVargpltNReals( std::vector<QString> &expVarFileP
     QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
     m_gpf_vargplt_for_nreals->save( par_file_path );
 
-    //run vargplt program
-    Application::instance()->logInfo("Starting vargplt program...");
-    GSLib::instance()->runProgram( "vargplt", par_file_path );
+    //run vargplt program (or get the plot of an identical previous run)
+    GSLibResultCache::instance()->runProgram( "vargplt", par_file_path,
+                                              QStringList() << m_gpf_vargplt_for_nreals->getParameter<GSLibParFile*>(0)->_path );
 
     GSLibParameterFile gpf = *m_gpf_vargplt_for_nreals;
 
@@ -1,6 +1,7 @@
 #ifndef VARIOGRAMANALYSISDIALOG_H
 #define VARIOGRAMANALYSISDIALOG_H
 
+#include <QDateTime>
 #include <QDialog>
 
 namespace Ui {
@@ -48,9 +49,18 @@ private:
     CartesianGrid* m_varmap_grid;
     GSLibParameterFile* m_gpf_vmodel;
     RealizationSelectionDialog *m_realsSelecDiag;
+    /** The result cache key of the last varmap run. */
+    QString m_varmap_cache_key;
+    /** When the last varmap run started (the result cache only keeps outputs written after it). */
+    QDateTime m_varmap_start_time;
     /** Does some UI details not in ui->setup(). */
     void finishUISetup();
     bool isCrossVariography();
+    /** Makes the vmodel parameters object, if not already made, with the directions and lags
+     *  suggested from the experimental variogram computation. */
+    void makeVModelParameters();
+    /** Runs vmodel with the current vmodel parameters and plots the result when it completes. */
+    void runVModel();
 
 private slots:
     void onOpenVarMapParameters();
@@ -60,6 +70,7 @@ private slots:
     void onSaveVarmapGrid();
     void onSaveExpVariogram();
     void onOpenVariogramModelParamateres();
+    void onFitVariogramModel();
     void onVmodelCompletion();
     void onSaveVariogramModel();
     void onVarNReals();
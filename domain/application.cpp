@@ -3,6 +3,9 @@
 #include <QDir>
 #include <QSettings>
 #include <QMessageBox>
+#include <QTextStream>
+#include <QMutex>
+#include <cstdio>
 
 //global instance pointer in the heap.
 Application* Application::_instance = nullptr;
@@ -79,6 +82,13 @@ void Application::setMaxGridCellCountFor3DVisualizationSetting(int value)
 
 void Application::logInfo(const QString text, bool showMessageBox)
 {
+    if( _headless ){
+        if( _logInfo )
+            printToConsole( "", text, stdout );
+        else
+            _infoBuffer.push_back( text );
+        return;
+    }
     Q_ASSERT(_mw != 0);
     if( _logInfo )
         _mw->log_message( text, "information" );
@@ -90,6 +100,13 @@ void Application::logInfo(const QString text, bool showMessageBox)
 
 void Application::logWarn(const QString text, bool showMessageBox)
 {
+    if( _headless ){
+        if( _logWarnings )
+            printToConsole( "WARNING: ", text, stderr );
+        else
+            _warningBuffer.push_back( text );
+        return;
+    }
     Q_ASSERT(_mw != 0);
     if( _logWarnings )
         _mw->log_message( text, "warning" );
@@ -101,6 +118,13 @@ void Application::logWarn(const QString text, bool showMessageBox)
 
 void Application::logError(const QString text, bool showMessageBox)
 {
+    if( _headless ){
+        if( _logErrors )
+            printToConsole( "ERROR: ", text, stderr );
+        else
+            _errorBuffer.push_back( text );
+        return;
+    }
     Q_ASSERT(_mw != 0);
     if( _logErrors )
         _mw->log_message( text, "error" );
@@ -112,7 +136,8 @@ void Application::logError(const QString text, bool showMessageBox)
 
 void Application::refreshProjectTree()
 {
-    _mw->refreshTreeStyle();
+    if( _mw )
+        _mw->refreshTreeStyle();
 }
 
 QString Application::generateUniqueFilePathInGSLibDir(const QString file_extension)
@@ -131,6 +156,10 @@ QString Application::generateUniqueFilePathInGSLibDir(const QString file_extensi
 
 void Application::addDataFile(const QString path)
 {
+    if( _headless ){
+        logError("Application::addDataFile(): adding data files requires user interaction, which is not possible in headless mode.");
+        return;
+    }
     if( this->hasOpenProject() ){
         _mw->doAddDataFile( path );
     }
@@ -280,6 +309,8 @@ QString Application::getGhostscriptPathSetting()
 }
 
 Application::Application() :
+    _mw( nullptr ),
+    _headless( false ),
     _logWarnings( true ),
     _logErrors( true ),
     _logInfo( true )
@@ -291,3 +322,15 @@ Application::~Application()
 {
     delete this->_open_project;
 }
+
+void Application::printToConsole(const QString prefix, const QString text, FILE *stream)
+{
+    //GSLib programs often report empty error texts
+    if( text.trimmed().isEmpty() )
+        return;
+    //messages may come from worker threads
+    static QMutex mutex;
+    QMutexLocker locker( &mutex );
+    QTextStream out( stream );
+    out << prefix << text.trimmed() << endl;
+}
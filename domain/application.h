@@ -3,6 +3,7 @@
 
 #include <QString>
 #include <QByteArray>
+#include <cstdio>
 #include "mainwindow.h"
 
 class Project;
@@ -30,6 +31,16 @@ public:
      */
     void setMainWindow( MainWindow* mw );
 
+    /**
+     * Enables the headless mode, used to run workflows from the command line (see Workflow).
+     * In headless mode there is no main window: messages are printed to the console,
+     * no message boxes or progress dialogs are shown and no user interaction is possible.
+     */
+    void setHeadless( bool value ){ _headless = value; }
+
+    /** Returns whether the program is running without a GUI. */
+    bool isHeadless(){ return _headless; }
+
     /**
      * @brief Closes the currently opened project.
      * If there is no opened project, nothing happens.
@@ -125,12 +136,18 @@ private:
     /** The singleton pointer */
     static Application* _instance;
 
+    /** Prints a message to standard output or standard error (used in headless mode). */
+    void printToConsole( const QString prefix, const QString text, FILE* stream );
+
     /** Pointer to the currently opened project. */
     Project* _open_project;
 
     /** Pointer to the main window. */
     MainWindow* _mw;
 
+    /** Whether the program is running without a GUI. */
+    bool _headless;
+
     /** Flag that enables/disables warning logging/printing. */
     bool _logWarnings;
 
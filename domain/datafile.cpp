@@ -6,6 +6,7 @@
 #include <iomanip>      // std::setprecision
 #include <sstream>    // std::stringstream
 #include <cmath>
+#include <memory>
 #include <QProgressDialog>
 #include <QFutureWatcher>
 #include <QtConcurrent/QtConcurrent>
@@ -128,13 +129,17 @@ void DataFile::loadData()
     _data.clear();
 
     //data load takes place in another thread, so we can show and update a progress bar
+    //(there is no progress bar in headless mode)
     //////////////////////////////////
-    QProgressDialog progressDialog;
-    progressDialog.show();
-    progressDialog.setLabelText("Loading and parsing " + _path + "...");
-    progressDialog.setMinimum( 0 );
-    progressDialog.setValue( 0 );
-    progressDialog.setMaximum( getFileSize() / 100 ); //see DataLoader::doLoad(). Dividing by 100 allows a max value of ~400GB when converting from long to int
+    std::unique_ptr<QProgressDialog> progressDialog;
+    if( ! Application::instance()->isHeadless() ){
+        progressDialog.reset( new QProgressDialog() );
+        progressDialog->show();
+        progressDialog->setLabelText("Loading and parsing " + _path + "...");
+        progressDialog->setMinimum( 0 );
+        progressDialog->setValue( 0 );
+        progressDialog->setMaximum( getFileSize() / 100 ); //see DataLoader::doLoad(). Dividing by 100 allows a max value of ~400GB when converting from long to int
+    }
     QThread* thread = new QThread();  //does it need to set parent (a QObject)?
     DataLoader* dl = new DataLoader(file,
                                     _data,
@@ -144,7 +149,8 @@ void DataFile::loadData()
     dl->moveToThread(thread);
     dl->connect(thread, SIGNAL(finished()), dl, SLOT(deleteLater()));
     dl->connect(thread, SIGNAL(started()), dl, SLOT(doLoad()));
-    dl->connect(dl, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)));
+    if( progressDialog )
+        dl->connect(dl, SIGNAL(progress(int)), progressDialog.get(), SLOT(setValue(int)));
     thread->start();
     /////////////////////////////////
 
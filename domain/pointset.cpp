@@ -9,6 +9,11 @@
 #include "../exceptions/invalidgslibdatafileexception.h"
 #include "weight.h"
 #include "util.h"
+#include "spatialindex/spatialindexpoints.h"
+#include <QFileInfo>
+
+/** Spatial indexes of point sets with at least this many points are saved for reuse in later sessions. */
+#define SPATIAL_INDEX_SAVE_MIN_POINTS 1000000
 
 PointSet::PointSet( QString path ) : DataFile( path )
 {
@@ -63,6 +68,62 @@ void PointSet::setInfo(int x_index, int y_index, int z_index, const QString no_d
     _categorical_attributes.clear();
     _categorical_attributes << categorical_attributes;
     this->updatePropertyCollection();
+    //the coordinate columns may have changed
+    _spatialIndex.reset();
+}
+
+std::shared_ptr<const SpatialIndexPoints> PointSet::getSpatialIndex(double tolerance)
+{
+    //the index is current if it was made from the same file contents, coordinate columns and tolerance
+    QFileInfo info( _path );
+    QString key = QString::number( info.lastModified().toMSecsSinceEpoch() ) + ";" +
+                  QString::number( info.size() ) + ";" +
+                  QString::number( _x_field_index ) + ";" +
+                  QString::number( _y_field_index ) + ";" +
+                  QString::number( _z_field_index ) + ";" +
+                  QString::number( tolerance, 'g', 17 );
+    if( _spatialIndex && _spatialIndexKey == key )
+        return _spatialIndex;
+
+    //reuse the index saved in a previous session, which does not need the data to be loaded
+    QString spatialIndexPath = getSpatialIndexFilePath();
+    std::shared_ptr<SpatialIndexPoints> spatialIndex = SpatialIndexPoints::load( spatialIndexPath, key );
+    if( ! spatialIndex ){
+        loadData();
+        //copy the coordinates to contiguous arrays (GEO-EAS indexes are 1-based)
+        int iX = getXindex() - 1;
+        int iY = getYindex() - 1;
+        int iZ = getZindex() - 1;
+        uint totlines = getDataLineCount();
+        std::vector<double> x( totlines ), y( totlines ), z( totlines, 0.0 ); //2D data go in the z==0.0 plane
+        for( uint iLine = 0; iLine < totlines; ++iLine ){
+            x[iLine] = data( iLine, iX );
+            y[iLine] = data( iLine, iY );
+            if( iZ >= 0 )
+                z[iLine] = data( iLine, iZ );
+        }
+        spatialIndex.reset( new SpatialIndexPoints( std::move( x ), std::move( y ), std::move( z ), tolerance ) );
+        //large indexes are saved for the next sessions
+        if( spatialIndex->getPointCount() >= SPATIAL_INDEX_SAVE_MIN_POINTS &&
+            ! spatialIndex->save( spatialIndexPath, key ) )
+            Application::instance()->logWarn("PointSet::getSpatialIndex(): could not save the spatial index to " + spatialIndexPath);
+    }
+    _spatialIndex = spatialIndex;
+    _spatialIndexKey = key;
+    return _spatialIndex;
+}
+
+QString PointSet::getSpatialIndexFilePath()
+{
+    return QString( _path ).append(".sidx");
+}
+
+void PointSet::deleteFromFS()
+{
+    DataFile::deleteFromFS();
+    //also deletes the saved spatial index
+    QFile file( getSpatialIndexFilePath() );
+    file.remove();
 }
 
 
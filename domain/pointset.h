@@ -5,6 +5,7 @@
 #include <QMap>
 
 class Attribute;
+class SpatialIndexPoints;
 
 /**
  * @brief The PointSet class represents a point set data file.  A point set is made of scattered values
@@ -46,6 +47,21 @@ public:
      */
     void addVariableWeightRelationship( uint variableGEOEASindex, uint weightGEOEASindex );
 
+    /**
+     * Returns the spatial index of the points, building it if there is none or if the point coordinates
+     * changed (the file changed or the coordinate columns were reassigned) since it was built.
+     * The index is shared by all users until it is rebuilt, so holding the returned pointer keeps a valid
+     * index even if another call rebuilds it.  Call this from the main thread (it may load data), the
+     * returned index can be queried by any number of threads.  The data may not be loaded on return.
+     * Indexes of large point sets are saved next to the point set file (see getSpatialIndexFilePath()), so
+     * later sessions reuse them without loading the data as long as the file does not change.
+     * @param tolerance The size of the bounding boxes around each point (see SpatialIndexPoints).
+     */
+    std::shared_ptr<const SpatialIndexPoints> getSpatialIndex( double tolerance = 0.0 );
+
+    /** Returns the path of the file with the saved spatial index. */
+    QString getSpatialIndexFilePath();
+
     //DataFile interface
 public:
     /** Returns whether the passed Attribute is a weight according to the file's metadata. */
@@ -60,6 +76,7 @@ public:
     QString getFileType();
     void updateMetaDataFile();
     bool isDataFile(){ return true; }
+    void deleteFromFS();
 
     // ProjectComponent interface
 public:
@@ -73,6 +90,9 @@ private:
     int _z_field_index;
     QMap<uint, uint> _wgt_var_pairs; //pairs relating weights (firs uint) and variables (second uint
                                      //) by their GEO-EAS indexes (1=first)
+    /** The cached spatial index and the key of the data it was built from (see getSpatialIndex()). */
+    std::shared_ptr<const SpatialIndexPoints> _spatialIndex;
+    QString _spatialIndexKey;
 };
 
 #endif // POINTSET_H
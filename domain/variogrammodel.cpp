@@ -1,81 +1,139 @@
 #include "variogrammodel.h"
 
+#include <QCoreApplication>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutexLocker>
+#include <QPointer>
 #include <QTextStream>
+#include <QThread>
 
 #include "gslib/gslibparameterfiles/gslibparameterfile.h"
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "util.h"
 
+namespace {
+    /** The last version given to a parse of a model file, shared by all models (see VariogramModel::getVersion()). */
+    std::atomic<uint> lastVersion( 0 );
+
+    //A single file watcher serves all models: each QFileSystemWatcher takes an inotify instance, which are
+    //limited per user, and models are also made as temporaries (e.g. for a cross-validation run).
+    /** Guards the watcher and the maps below. */
+    QMutex watchMutex;
+    /** The shared watcher.  It lives in the main thread, which has the event loop that delivers its signals,
+     * and is deleted with the application. */
+    QPointer<QFileSystemWatcher> watcher;
+    /** The models watching each path. */
+    QMultiHash<QString, VariogramModel*> modelsByPath;
+    /** The path each model watches. */
+    QHash<VariogramModel*, QString> pathsByModel;
+
+    /** Removes the watch of a model.  The path is no longer watched if no other model watches it.
+     * watchMutex must be locked. */
+    void unwatchLocked( VariogramModel* model ){
+        if( ! pathsByModel.contains( model ) )
+            return;
+        QString path = pathsByModel.take( model );
+        modelsByPath.remove( path, model );
+        if( watcher && watcher->thread() == QThread::currentThread() && ! modelsByPath.contains( path ) )
+            watcher->removePath( path );
+    }
+
+    /** Makes a model watch a path (and stop watching its previous one). */
+    void watch( VariogramModel* model, const QString& path ){
+        QMutexLocker locker( &watchMutex );
+        bool inMainThread = QCoreApplication::instance() &&
+                            QThread::currentThread() == QCoreApplication::instance()->thread();
+        if( ! watcher && inMainThread ){
+            watcher = new QFileSystemWatcher( QCoreApplication::instance() );
+            QObject::connect( watcher.data(), &QFileSystemWatcher::fileChanged, []( const QString& changedPath ){
+                QMutexLocker locker( &watchMutex );
+                for( VariogramModel* model : modelsByPath.values( changedPath ) )
+                    model->setChanged();
+            });
+        }
+        unwatchLocked( model );
+        pathsByModel.insert( model, path );
+        modelsByPath.insert( path, model );
+        //the path is watched again, since a file renamed or replaced ends its watch
+        if( watcher && watcher->thread() == QThread::currentThread() ){
+            if( watcher->files().contains( path ) )
+                watcher->removePath( path );
+            watcher->addPath( path );
+        }
+    }
+
+    /** Removes the watch of a model. */
+    void unwatch( VariogramModel* model ){
+        QMutexLocker locker( &watchMutex );
+        unwatchLocked( model );
+    }
+}
+
 VariogramModel::VariogramModel(const QString path) : File( path ),
-    _forceReread (true)
+    _stale( true )
+{
+}
+
+VariogramModel::~VariogramModel()
 {
+    unwatch( this );
 }
 
 double VariogramModel::getSill()
 {
-    if(_forceReread) readParameters();
-    return m_Sill;
+    return getParameters()->sill;
 }
 
 double VariogramModel::getNugget()
 {
-    if(_forceReread) readParameters();
-    return m_Nugget;
+    return getParameters()->nugget;
 }
 
 uint VariogramModel::getNst()
 {
-    if(_forceReread) readParameters();
-    return m_nst;
+    return getParameters()->nst;
 }
 
 VariogramStructureType VariogramModel::getIt(int structure)
 {
-    if(_forceReread) readParameters();
-    return m_it.at( structure );
+    return getParameters()->it.at( structure );
 }
 
 double VariogramModel::getCC(int structure)
 {
-    if(_forceReread) readParameters();
-    return m_cc.at( structure );
+    return getParameters()->cc.at( structure );
 }
 
 double VariogramModel::get_a_hMax(int structure)
 {
-    if(_forceReread) readParameters();
-    return m_a_hMax.at( structure );
+    return getParameters()->a_hMax.at( structure );
 }
 
 double VariogramModel::get_a_hMin( int structure )
 {
-    if(_forceReread) readParameters();
-    return m_a_hMin.at( structure );
+    return getParameters()->a_hMin.at( structure );
 }
 
 double VariogramModel::get_a_vert(int structure)
 {
-    if(_forceReread) readParameters();
-    return m_a_vert.at( structure );
+    return getParameters()->a_vert.at( structure );
 }
 
 double VariogramModel::getAzimuth(int structure)
 {
-    if(_forceReread) readParameters();
-    return m_Azimuth.at( structure );
+    return getParameters()->azimuth.at( structure );
 }
 
 double VariogramModel::getDip(int structure)
 {
-    if(_forceReread) readParameters();
-    return m_Dip.at( structure );
+    return getParameters()->dip.at( structure );
 }
 
 double VariogramModel::getRoll(int structure)
 {
-    if(_forceReread) readParameters();
-    return m_Roll.at( structure );
+    return getParameters()->roll.at( structure );
 }
 
 double VariogramModel::get_max_hMax()
@@ -125,34 +183,8 @@ void VariogramModel::save(QTextStream *txt_stream)
     (*txt_stream) << this->getFileType() << ":" << this->getFileName() << '\n';
 }
 
-void VariogramModel::readParameters()
+void VariogramModel::readParameters(Parameters &parameters)
 {
-
-    //get info on the physical file that stores the variogram model data
-    QFileInfo info( _path );
-
-    //if read data is not empty and was loaded before
-    if( ! m_it.empty() && ! _lastModifiedDateTimeLastRead.isNull() ){
-        QDateTime currentLastModified = info.lastModified();
-        //if modified datetime didn't change since last call to readParameters
-        if( currentLastModified <= _lastModifiedDateTimeLastRead ){
-            return; //does nothing
-        }
-    }
-
-    //record the current datetime of file change
-    _lastModifiedDateTimeLastRead = info.lastModified();
-
-    //reset the ranges and angles collections
-    m_it.clear();
-    m_cc.clear();
-    m_a_hMax.clear();
-    m_a_hMin.clear();
-    m_a_vert.clear();
-    m_Azimuth.clear();
-    m_Dip.clear();
-    m_Roll.clear();
-
     //Variogram models are stored as parameter files for the vmodel GSLib program,
     //ergo, to read the values, just create a parameter file object for vmodel
     GSLibParameterFile par_vmodel( "vmodel" );
@@ -160,48 +192,78 @@ void VariogramModel::readParameters()
 
     //get the nugget effect
     GSLibParMultiValuedFixed *par3 = par_vmodel.getParameter<GSLibParMultiValuedFixed*>(3);
-    m_Nugget = par3->getParameter<GSLibParDouble*>(1)->_value;
+    parameters.nugget = par3->getParameter<GSLibParDouble*>(1)->_value;
 
     //Sill starts with the nugget effect value.
-    m_Sill = m_Nugget;
+    parameters.sill = parameters.nugget;
 
     //get the number of variogram structures
     GSLibParRepeat *par4 = par_vmodel.getParameter<GSLibParRepeat*>(4); //repeat nst-times
-    m_nst = par3->getParameter<GSLibParUInt*>(0)->_value;
-    par4->setCount( m_nst );
+    parameters.nst = par3->getParameter<GSLibParUInt*>(0)->_value;
+    par4->setCount( parameters.nst );
 
     //for each structure...
-    for( uint inst = 0; inst < m_nst; ++inst)
+    for( uint inst = 0; inst < parameters.nst; ++inst)
     {
         GSLibParMultiValuedFixed *par4_0 = par4->getParameter<GSLibParMultiValuedFixed*>(inst, 0);
         //...collect the struture type
-        m_it.append( (VariogramStructureType)par4_0->getParameter<GSLibParOption*>(0)->_selected_value );
+        parameters.it.append( (VariogramStructureType)par4_0->getParameter<GSLibParOption*>(0)->_selected_value );
         //...collect the contribution
-        m_cc.append( par4_0->getParameter<GSLibParDouble*>(1)->_value );
+        parameters.cc.append( par4_0->getParameter<GSLibParDouble*>(1)->_value );
         //...add the contribution to the Sill value
-        m_Sill += par4_0->getParameter<GSLibParDouble*>(1)->_value;
+        parameters.sill += par4_0->getParameter<GSLibParDouble*>(1)->_value;
         //...collect the angles
-        m_Azimuth.append( par4_0->getParameter<GSLibParDouble*>(2)->_value );
-        m_Dip.append( par4_0->getParameter<GSLibParDouble*>(3)->_value );
-        m_Roll.append( par4_0->getParameter<GSLibParDouble*>(4)->_value );
+        parameters.azimuth.append( par4_0->getParameter<GSLibParDouble*>(2)->_value );
+        parameters.dip.append( par4_0->getParameter<GSLibParDouble*>(3)->_value );
+        parameters.roll.append( par4_0->getParameter<GSLibParDouble*>(4)->_value );
         //...collect the ranges
         GSLibParMultiValuedFixed *par4_1 = par4->getParameter<GSLibParMultiValuedFixed*>(inst, 1);
-        m_a_hMax.append( par4_1->getParameter<GSLibParDouble*>(0)->_value );
-        m_a_hMin.append( par4_1->getParameter<GSLibParDouble*>(1)->_value );
-        m_a_vert.append( par4_1->getParameter<GSLibParDouble*>(2)->_value );
+        parameters.a_hMax.append( par4_1->getParameter<GSLibParDouble*>(0)->_value );
+        parameters.a_hMin.append( par4_1->getParameter<GSLibParDouble*>(1)->_value );
+        parameters.a_vert.append( par4_1->getParameter<GSLibParDouble*>(2)->_value );
     }
 }
-bool VariogramModel::forceReread() const
+
+void VariogramModel::refresh()
 {
-    return _forceReread;
+    QMutexLocker locker( &_readMutex );
+    //the flag is cleared before parsing, so a change notified during the parse is parsed again in the next access
+    //(another thread may also have parsed the parameters while this one waited)
+    if( ! _stale.exchange( false ) && std::atomic_load( &_parameters ) )
+        return;
+    //the snapshot is filled before being published, so other threads keep reading the previous one meanwhile
+    std::shared_ptr<Parameters> parameters( new Parameters() );
+    readParameters( *parameters );
+    parameters->version = ++lastVersion;
+    std::atomic_store( &_parameters, std::shared_ptr<const Parameters>( parameters ) );
+    //watch the current path (the file may have been renamed)
+    watch( this, getPath() );
 }
 
-void VariogramModel::setForceReread(bool forceReread)
+std::shared_ptr<const VariogramModel::Parameters> VariogramModel::getParameters()
 {
-    if( ! forceReread)
-        Application::instance()->logWarn("VariogramModel::setForceReread(): WARNING! Automatic reread disabled!");
-    else
-        Application::instance()->logInfo("VariogramModel::setForceReread(): Automatic reread restored.");
-    _forceReread = forceReread;
+    ensureCurrent();
+    std::shared_ptr<const Parameters> parameters = std::atomic_load( &_parameters );
+    //the first parse may still be under way in another thread: wait for it
+    if( ! parameters ){
+        refresh();
+        parameters = std::atomic_load( &_parameters );
+    }
+    return parameters;
 }
 
+void VariogramModel::setChanged()
+{
+    _stale = true;
+}
+
+uint VariogramModel::getVersion()
+{
+    return getParameters()->version;
+}
+
+void VariogramModel::readFromFS()
+{
+    setChanged();
+    ensureCurrent();
+}
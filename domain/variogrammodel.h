@@ -4,6 +4,9 @@
 #include "file.h"
 #include <QList>
 #include <QDateTime>
+#include <QMutex>
+#include <atomic>
+#include <memory>
 
 /*! Variogram structure types. */
 enum class VariogramStructureType : int {
@@ -17,11 +20,16 @@ enum class VariogramStructureType : int {
 /**
  * @brief The VariogramModel class represents a vmodel (GSLib progam) parameter file,
  *  which contains a variogram model, that was saved by the user in the project directory.
+ *  The parameters are parsed once and kept in memory, so the getters do no I/O.  They are parsed again in the
+ *  first access after the file changes, which is detected by a file watcher shared by all models or signaled
+ *  with setChanged().
+ *  Performance critical code running in several threads should use a CovarianceKernel made from the model.
  */
 class VariogramModel : public File
 {
 public:
     VariogramModel( const QString path );
+    ~VariogramModel();
 
     /**
      * Returns the total variance expressed by the variogram model.
@@ -96,18 +104,16 @@ public:
     /** Returns the highest vertical axis range amongst the nested structures. */
     double get_max_vert();
 
-    bool forceReread() const;
-
-    /** Sets whether the getters call readParameters() automatically.
-     * Setting true, getters ensture an updated read with respect to the file, but results in a slow execution.
-     * Setting false, getters only return the values in the member varaibles, which can be intersting in
-     * performance critical code, but at risk of outdated information if the file is expected to change.
-     * By default, _forceReread is true.
+    /** Marks the parameters as outdated, so they are parsed again in the next access.
+     * Call this after writing to the model file (changes made by other programs are detected automatically).
      */
-    void setForceReread(bool forceReread);
+    void setChanged();
 
-    /** Reads the variogram model parameters from file. */
-    void readParameters();
+    /** Returns a number that changes whenever the parameters are parsed again.  The numbers are never reused,
+     * even by other models, so caches of results computed with the model can use it as key (a model allocated
+     * where a deleted one was does not match the results of the deleted one).
+     */
+    uint getVersion();
 
 // File interface
 public:
@@ -115,6 +121,8 @@ public:
     virtual bool canHaveMetaData(){ return false; }
     virtual void updateMetaDataFile(){;}
     bool isDataFile(){ return false; }
+    /** Parses the parameters from the file now. */
+    void readFromFS();
 
 // ProjectComponent interface
 public:
@@ -123,33 +131,43 @@ public:
 
 private:
 
-    /** These variables are set by readParameters(). */
-    //@{
-    double m_Sill;
-    double m_Nugget;
-    uint m_nst; //number of structures, not counting the nugget effect.
-    QList<VariogramStructureType> m_it; //structure type (spherical, exponential, gaussian, etc.)
-    QList<double> m_cc; //structure variance contribution
-    QList<double> m_a_hMax;
-    QList<double> m_a_hMin;
-    QList<double> m_a_vert;
-    QList<double> m_Azimuth;
-    QList<double> m_Dip;
-    QList<double> m_Roll;
-    //@}
-
     /**
-     * Stores the file timestamp in the last call to readParameters().
-     * This time is used to detect whether there as a change in the file, to prevent
-     * unnecessary reads.
+     * The parameters of one parse of the file.  A parse makes a new snapshot that replaces the current one at
+     * once, so a thread reading the parameters never sees them partially parsed by another thread.
      */
-    QDateTime _lastModifiedDateTimeLastRead;
+    struct Parameters {
+        double sill;
+        double nugget;
+        uint nst; //number of structures, not counting the nugget effect.
+        QList<VariogramStructureType> it; //structure type (spherical, exponential, gaussian, etc.)
+        QList<double> cc; //structure variance contribution
+        QList<double> a_hMax;
+        QList<double> a_hMin;
+        QList<double> a_vert;
+        QList<double> azimuth;
+        QList<double> dip;
+        QList<double> roll;
+        /** Unique among all parses of all models of the process (see getVersion()). */
+        uint version;
+    };
+
+    /** The current parameters.  Accessed only with std::atomic_load() and std::atomic_store(). */
+    std::shared_ptr<const Parameters> _parameters;
+
+    /** Returns the current parameters, parsing the file first if they are outdated. */
+    std::shared_ptr<const Parameters> getParameters();
 
-    /** If true, each get*() method calls readParameters(), which assures updating, but is slow.
-     * If false, the getters only returns the values stores in the member variables, but is subject to return
-     * outdated values.  By default this variable is true.
-     */
-    bool _forceReread;
+    /** Reads the variogram model parameters from file. */
+    void readParameters( Parameters& parameters );
+
+    /** Parses the parameters if they are outdated. */
+    inline void ensureCurrent(){ if( _stale ) refresh(); }
+    void refresh();
+
+    /** Whether the parameters must be parsed again before the next access. */
+    std::atomic<bool> _stale;
+    /** Serializes the parsing of the parameters. */
+    QMutex _readMutex;
 };
 
 #endif // VARIOGRAMMODEL_H
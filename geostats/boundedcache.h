@@ -0,0 +1,98 @@
+#ifndef BOUNDEDCACHE_H
+#define BOUNDEDCACHE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+
+/**
+ * The BoundedCache class template keeps the results of expensive computations (covariance tables, search
+ * templates, transform tables, etc.) keyed by their inputs, for reuse by later or concurrent callers.
+ * The number of entries is bounded: the least recently used entries are evicted, so results keyed by
+ * outdated inputs (e.g. a previous version of an edited variogram model) do not pile up.
+ * Concurrent requests of the same key wait for a single computation, while other keys are computed in
+ * the meantime.  Key must be ordered by operator< (e.g. a std::tuple) and Value must be default
+ * constructible and cheap to copy (e.g. a std::shared_ptr or a number).
+ */
+template <typename Key, typename Value>
+class BoundedCache
+{
+public:
+    /** @param maxEntries The maximum number of entries (at least one). */
+    explicit BoundedCache( std::size_t maxEntries ) : _maxEntries( std::max<std::size_t>( 1, maxEntries ) ) {}
+
+    BoundedCache( const BoundedCache& ) = delete;
+    BoundedCache& operator=( const BoundedCache& ) = delete;
+
+    /** Returns the value for a key, calling build() (with no arguments) to make it if it is not cached. */
+    template <typename Builder>
+    Value get( const Key& key, Builder build );
+
+    /** Removes all entries.  The values already returned remain valid. */
+    void clear();
+
+private:
+    struct Entry {
+        Entry() : built( false ) {}
+        /** Held while the value is built. */
+        QMutex mutex;
+        bool built;
+        Value value;
+        /** The position of the key in the recently used keys list. */
+        typename std::list<Key>::iterator lruPosition;
+    };
+
+    std::size_t _maxEntries;
+    std::map< Key, std::shared_ptr<Entry> > _entries;
+    /** The keys, most recently used first. */
+    std::list<Key> _lru;
+    /** Serializes the accesses to the entries map and the keys list. */
+    QMutex _mutex;
+};
+
+/////////////////////////////////////////IMPLEMENTATIONS////////////////////////////////////
+
+template <typename Key, typename Value>
+template <typename Builder>
+Value BoundedCache<Key, Value>::get( const Key& key, Builder build )
+{
+    std::shared_ptr<Entry> entry;
+    {
+        QMutexLocker locker( &_mutex );
+        typename std::map< Key, std::shared_ptr<Entry> >::iterator it = _entries.find( key );
+        if( it != _entries.end() ){
+            entry = it->second;
+            _lru.splice( _lru.begin(), _lru, entry->lruPosition );
+        } else {
+            entry.reset( new Entry() );
+            _lru.push_front( key );
+            entry->lruPosition = _lru.begin();
+            _entries[ key ] = entry;
+            while( _entries.size() > _maxEntries ){
+                _entries.erase( _lru.back() );
+                _lru.pop_back();
+            }
+        }
+    }
+
+    //the entry is held by this caller, so it can be evicted meanwhile
+    QMutexLocker locker( &entry->mutex );
+    if( ! entry->built ){
+        entry->value = build();
+        entry->built = true;
+    }
+    return entry->value;
+}
+
+template <typename Key, typename Value>
+void BoundedCache<Key, Value>::clear()
+{
+    QMutexLocker locker( &_mutex );
+    _entries.clear();
+    _lru.clear();
+}
+
+#endif // BOUNDEDCACHE_H
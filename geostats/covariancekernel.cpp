@@ -0,0 +1,137 @@
+#include "covariancekernel.h"
+
+#include "geostatsutils.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+
+template <>
+double CovarianceKernel::unitGamma<VariogramStructureType::SPHERIC>( double h, double range )
+{
+    //min() instead of a branch keeps the batch loop vectorizable
+    double r = std::min( h / range, 1.0 );
+    return 1.5 * r - 0.5 * r * r * r;
+}
+
+template <>
+double CovarianceKernel::unitGamma<VariogramStructureType::EXPONENTIAL>( double h, double range )
+{
+    return 1.0 - std::exp( -3.0 * h / range );
+}
+
+template <>
+double CovarianceKernel::unitGamma<VariogramStructureType::GAUSSIAN>( double h, double range )
+{
+    double hOverA = h / range;
+    return 1.0 - std::exp( -9.0 * hOverA * hOverA );
+}
+
+template <>
+double CovarianceKernel::unitGamma<VariogramStructureType::POWER_LAW>( double h, double /*range*/ )
+{
+    //constant power, as in GeostatsUtils::getGamma()
+    return std::pow( h, 1.5 );
+}
+
+template <>
+double CovarianceKernel::unitGamma<VariogramStructureType::COSINE_HOLE_EFFECT>( double h, double range )
+{
+    return 1.0 - std::cos( h / range * (double)Util::PI );
+}
+
+template <VariogramStructureType T>
+void CovarianceKernel::addGammas(const Structure &structure, const double *dx, const double *dy, const double *dz,
+                                 unsigned int n, double *result)
+{
+    //copy the structure parameters to locals so the compiler knows they do not alias the result
+    const double t11 = structure.t[0], t12 = structure.t[1], t13 = structure.t[2];
+    const double t21 = structure.t[3], t22 = structure.t[4], t23 = structure.t[5];
+    const double t31 = structure.t[6], t32 = structure.t[7], t33 = structure.t[8];
+    const double range = structure.range;
+    const double contribution = structure.contribution;
+    for( unsigned int i = 0; i < n; ++i ){
+        double x = t11 * dx[i] + t12 * dy[i] + t13 * dz[i];
+        double y = t21 * dx[i] + t22 * dy[i] + t23 * dz[i];
+        double z = t31 * dx[i] + t32 * dy[i] + t33 * dz[i];
+        result[i] += contribution * unitGamma<T>( std::sqrt( x*x + y*y + z*z ), range );
+    }
+}
+
+template <VariogramStructureType T>
+void CovarianceKernel::setFunctions(Structure &structure)
+{
+    structure.unitGamma = &CovarianceKernel::unitGamma<T>;
+    structure.addGammas = &CovarianceKernel::addGammas<T>;
+}
+
+CovarianceKernel::CovarianceKernel(VariogramModel *model)
+{
+    _nugget = model->getNugget();
+    _sill = _nugget;
+    uint nst = model->getNst();
+    _structures.resize( nst );
+    for( uint ist = 0; ist < nst; ++ist ){
+        Structure& structure = _structures[ist];
+        Matrix3X3<double> t = GeostatsUtils::getAnisoTransform( model->get_a_hMax( ist ), model->get_a_hMin( ist ),
+                                                                model->get_a_vert( ist ), model->getAzimuth( ist ),
+                                                                model->getDip( ist ), model->getRoll( ist ) );
+        structure.t[0] = t._a11; structure.t[1] = t._a12; structure.t[2] = t._a13;
+        structure.t[3] = t._a21; structure.t[4] = t._a22; structure.t[5] = t._a23;
+        structure.t[6] = t._a31; structure.t[7] = t._a32; structure.t[8] = t._a33;
+        structure.range = model->get_a_hMax( ist );
+        structure.contribution = model->getCC( ist );
+        _sill += structure.contribution;
+        //resolve the structure type once
+        switch( model->getIt( ist ) ){
+        case VariogramStructureType::SPHERIC:
+            setFunctions<VariogramStructureType::SPHERIC>( structure ); break;
+        case VariogramStructureType::EXPONENTIAL:
+            setFunctions<VariogramStructureType::EXPONENTIAL>( structure ); break;
+        case VariogramStructureType::GAUSSIAN:
+            setFunctions<VariogramStructureType::GAUSSIAN>( structure ); break;
+        case VariogramStructureType::POWER_LAW:
+            Application::instance()->logWarn("CovarianceKernel::CovarianceKernel(): Power model using a constant power == 1.5");
+            setFunctions<VariogramStructureType::POWER_LAW>( structure ); break;
+        case VariogramStructureType::COSINE_HOLE_EFFECT:
+            setFunctions<VariogramStructureType::COSINE_HOLE_EFFECT>( structure ); break;
+        default:
+            Application::instance()->logError("CovarianceKernel::CovarianceKernel(): Unknown structure type.  Assuming spheric.");
+            setFunctions<VariogramStructureType::SPHERIC>( structure );
+        }
+    }
+}
+
+double CovarianceKernel::gamma(double dx, double dy, double dz) const
+{
+    //the variogram is zero at zero separation: the nugget effect is a discontinuity at the origin
+    if( dx == 0.0 && dy == 0.0 && dz == 0.0 )
+        return 0.0;
+    double result = _nugget;
+    for( const Structure& structure : _structures ){
+        const double* t = structure.t;
+        double x = t[0] * dx + t[1] * dy + t[2] * dz;
+        double y = t[3] * dx + t[4] * dy + t[5] * dz;
+        double z = t[6] * dx + t[7] * dy + t[8] * dz;
+        result += structure.contribution * structure.unitGamma( std::sqrt( x*x + y*y + z*z ), structure.range );
+    }
+    return result;
+}
+
+void CovarianceKernel::gammas(const double *dx, const double *dy, const double *dz, unsigned int n, double *result) const
+{
+    std::fill( result, result + n, _nugget );
+    for( const Structure& structure : _structures )
+        structure.addGammas( structure, dx, dy, dz, n, result );
+    //zero separations (e.g. the diagonal of a covariance matrix) get no nugget effect, as in gamma()
+    for( unsigned int i = 0; i < n; ++i )
+        if( dx[i] == 0.0 && dy[i] == 0.0 && dz[i] == 0.0 )
+            result[i] = 0.0;
+}
+
+void CovarianceKernel::covariances(const double *dx, const double *dy, const double *dz, unsigned int n, double *result) const
+{
+    gammas( dx, dy, dz, n, result );
+    for( unsigned int i = 0; i < n; ++i )
+        result[i] = _sill - result[i];
+}
@@ -0,0 +1,74 @@
+#ifndef COVARIANCEKERNEL_H
+#define COVARIANCEKERNEL_H
+
+#include <vector>
+#include "domain/variogrammodel.h"
+
+/**
+ * The CovarianceKernel class is an immutable, "compiled" form of a variogram model to evaluate it many times.
+ * The model parameters are read once on construction: the anisotropy transform of each nested structure is
+ * computed once and the structure type is resolved to a specialized function, so evaluating the model involves
+ * no file reads, no switch on the structure type and no shared state.  A kernel can then be used by
+ * many threads at once.  The batch functions take separation vectors as separate arrays of components and
+ * evaluate one structure for all of them in a loop the compiler can vectorize.
+ * A kernel does not follow later changes to the model: make a new one to use the new parameters.
+ */
+class CovarianceKernel
+{
+public:
+    /** Reads the variogram model parameters. */
+    explicit CovarianceKernel( VariogramModel* model );
+
+    /** Returns the sill of the model (the nugget effect plus the structure contributions). */
+    double getSill() const { return _sill; }
+
+    double getNugget() const { return _nugget; }
+
+    /**
+     * Returns the variogram value (nugget effect included) for a separation vector.  The value for a null separation
+     * is zero, so the covariance of a location with itself is the full sill, as in GSLib's cova3.
+     */
+    double gamma( double dx, double dy, double dz ) const;
+
+    /** Returns the covariance (sill minus variogram) for a separation vector. */
+    double covariance( double dx, double dy, double dz ) const { return _sill - gamma( dx, dy, dz ); }
+
+    /**
+     * Computes the variogram values for n separation vectors.
+     * @param dx, dy, dz The components of the separation vectors.
+     * @param result An array with room for n values.
+     */
+    void gammas( const double* dx, const double* dy, const double* dz, unsigned int n, double* result ) const;
+
+    /** Computes the covariances for n separation vectors (see gammas()). */
+    void covariances( const double* dx, const double* dy, const double* dz, unsigned int n, double* result ) const;
+
+private:
+    /** A nested structure with its type resolved to the functions evaluating it. */
+    struct Structure {
+        /** The anisotropy transform (see GeostatsUtils::getAnisoTransform()), row-major. */
+        double t[9];
+        double range;
+        double contribution;
+        /** Returns the variogram value of a unit contribution for a (transformed) separation. */
+        double (*unitGamma)( double h, double range );
+        /** Adds the variogram values of the structure for n separation vectors to result. */
+        void (*addGammas)( const Structure& structure, const double* dx, const double* dy, const double* dz,
+                           unsigned int n, double* result );
+    };
+
+    /** The specialized functions per structure type. */
+    template <VariogramStructureType T>
+    static double unitGamma( double h, double range );
+    template <VariogramStructureType T>
+    static void addGammas( const Structure& structure, const double* dx, const double* dy, const double* dz,
+                           unsigned int n, double* result );
+    template <VariogramStructureType T>
+    static void setFunctions( Structure& structure );
+
+    double _sill;
+    double _nugget;
+    std::vector<Structure> _structures;
+};
+
+#endif // COVARIANCEKERNEL_H
@@ -0,0 +1,67 @@
+#include "covariancetable.h"
+
+#include "boundedcache.h"
+#include "covariancekernel.h"
+#include "domain/variogrammodel.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+#include <tuple>
+
+//maximum number of tables kept for reuse
+#define COVARIANCE_TABLE_CACHE_SIZE 16
+
+namespace {
+
+    /** Key of the tables cache. */
+    typedef std::tuple< VariogramModel*, uint, double, double, double, int, int, int > CovarianceTableKey;
+
+    BoundedCache< CovarianceTableKey, std::shared_ptr<const CovarianceTable> > covarianceTables( COVARIANCE_TABLE_CACHE_SIZE );
+}
+
+std::shared_ptr<const CovarianceTable> CovarianceTable::getTable(VariogramModel *model,
+                                                                 double dx, double dy, double dz,
+                                                                 int maxDi, int maxDj, int maxDk)
+{
+    CovarianceTableKey key( model, model->getVersion(), dx, dy, dz, maxDi, maxDj, maxDk );
+    return covarianceTables.get( key, [&](){
+        return std::shared_ptr<const CovarianceTable>( new CovarianceTable( model, dx, dy, dz, maxDi, maxDj, maxDk ) );
+    });
+}
+
+void CovarianceTable::clearCache()
+{
+    covarianceTables.clear();
+}
+
+CovarianceTable::CovarianceTable(VariogramModel *model,
+                                 double dx, double dy, double dz,
+                                 int maxDi, int maxDj, int maxDk) :
+    _maxDi( std::max( 0, maxDi ) ),
+    _maxDj( std::max( 0, maxDj ) ),
+    _maxDk( std::max( 0, maxDk ) )
+{
+    _nI = 2 * _maxDi + 1;
+    _nJ = 2 * _maxDj + 1;
+    int nK = 2 * _maxDk + 1;
+    _values.resize( _nI * _nJ * nK );
+
+    //the model evaluations are independent, so the slices of the table are filled in parallel
+    const CovarianceKernel kernel( model );
+    _sill = kernel.getSill();
+    std::vector<int> slices( nK );
+    for( int k = 0; k < nK; ++k )
+        slices[k] = k;
+    QtConcurrent::blockingMap( slices, [&]( const int& k ){
+        //the separation vectors of a row of the table, evaluated at once
+        std::vector<double> sepX( _nI ), sepY( _nI ), sepZ( _nI );
+        for( int di = -_maxDi; di <= _maxDi; ++di )
+            sepX[ di + _maxDi ] = di * dx;
+        std::fill( sepZ.begin(), sepZ.end(), ( k - _maxDk ) * dz );
+        for( int dj = -_maxDj; dj <= _maxDj; ++dj ){
+            std::fill( sepY.begin(), sepY.end(), dj * dy );
+            kernel.covariances( sepX.data(), sepY.data(), sepZ.data(), _nI,
+                                &_values[ ( dj + _maxDj ) * _nI + k * _nI * _nJ ] );
+        }
+    });
+}
@@ -0,0 +1,61 @@
+#ifndef COVARIANCETABLE_H
+#define COVARIANCETABLE_H
+
+#include <memory>
+#include <vector>
+
+class VariogramModel;
+
+/**
+ * The CovarianceTable class holds the covariances of a variogram model for all integer offsets
+ * (di, dj, dk) between grid cells up to given extents, like the covtab array of GSLib's kt3d and sgsim.
+ * In a regular grid the separation between two cells is (di*dx, dj*dy, dk*dz), so the kriging matrices
+ * can be filled with table lookups instead of evaluating the variogram model for each pair of cells.
+ * The covariances are computed as the model sill minus the variogram value (nugget included, but for the null
+ * offset, whose covariance is the full sill), which is the convention of CovarianceKernel and of GSLib.
+ * Tables are shared: use getTable() to get one built once per grid geometry and variogram model.
+ */
+class CovarianceTable
+{
+public:
+
+    /**
+     * Returns a table for the given cell sizes and offset extents, building it (in parallel) if no
+     * table for the same model, cell sizes and extents exists.  The model version is part of the key,
+     * so editing the model invalidates the tables made with it.
+     * @param maxDi, maxDj, maxDk The maximum absolute offsets along each axis.
+     */
+    static std::shared_ptr<const CovarianceTable> getTable( VariogramModel* model,
+                                                            double dx, double dy, double dz,
+                                                            int maxDi, int maxDj, int maxDk );
+
+    /** Releases the shared tables. */
+    static void clearCache();
+
+    /** Returns whether the table has the covariance for the given offset. */
+    inline bool covers( int di, int dj, int dk ) const {
+        return di >= -_maxDi && di <= _maxDi &&
+               dj >= -_maxDj && dj <= _maxDj &&
+               dk >= -_maxDk && dk <= _maxDk;
+    }
+
+    /** Returns the covariance for the given offset.  It assumes covers() is true for it. */
+    inline double get( int di, int dj, int dk ) const {
+        return _values[ ( di + _maxDi ) + ( dj + _maxDj ) * _nI + ( dk + _maxDk ) * _nI * _nJ ];
+    }
+
+    /** Returns the variogram model sill used to compute the covariances. */
+    double getSill() const { return _sill; }
+
+private:
+    CovarianceTable( VariogramModel* model, double dx, double dy, double dz, int maxDi, int maxDj, int maxDk );
+
+    int _maxDi, _maxDj, _maxDk;
+    /** The table sizes along each axis (2*max+1). */
+    int _nI, _nJ;
+    double _sill;
+    /** The covariances with i varying fastest, as in the grid data. */
+    std::vector<double> _values;
+};
+
+#endif // COVARIANCETABLE_H
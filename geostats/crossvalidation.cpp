@@ -0,0 +1,374 @@
+#include "crossvalidation.h"
+
+#include "covariancekernel.h"
+#include "krigingsolver.h"
+#include "matrixmxn.h"
+#include "domain/application.h"
+#include "domain/pointset.h"
+#include "domain/variogrammodel.h"
+#include "spatialindex/spatialindexpoints.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+
+    /** The search and kriging buffers of a cross-validation thread, allocated once for all its samples. */
+    struct CrossValidationWorkspace {
+        CrossValidationWorkspace() : covMatrix( 0, 0 ) {}
+        std::vector<uint> neighbors;
+        std::vector<double> sepX, sepY, sepZ;
+        MatrixNXM<double> covMatrix;
+        KrigingSolver solver;
+        std::vector<double> covariances;
+        std::vector<double> weights;
+    };
+}
+
+CrossValidation::CrossValidation(PointSet *ps, uint column, VariogramModel *model, QObject *parent) :
+    QObject(parent),
+    _ps( ps ),
+    _column( column ),
+    _model( model ),
+    _tmin( -std::numeric_limits<double>::max() ),
+    _tmax( std::numeric_limits<double>::max() ),
+    _kType( KrigingType::OK ),
+    _meanSK( 0.0 ),
+    _minSamples( 4 ),
+    _search( 1e21, 1e21, 1e21, 0.0, 0.0, 0.0, 8 ), //GSLib's "infinite" radius
+    _globalNeighborhood( false )
+{
+    _statistics = CrossValidationStatistics{ 0, 0.0, 0.0, 0.0, 0.0 };
+}
+
+CrossValidation::~CrossValidation()
+{
+}
+
+void CrossValidation::setTrimmingLimits(double tmin, double tmax)
+{
+    _tmin = tmin;
+    _tmax = tmax;
+}
+
+void CrossValidation::setKrigingType(KrigingType kType, double meanSK)
+{
+    _kType = kType;
+    _meanSK = meanSK;
+}
+
+void CrossValidation::setSearch(uint minSamples, const SearchEllipsoid &search)
+{
+    _minSamples = std::max( 1u, minSamples );
+    _search = search;
+}
+
+bool CrossValidation::run()
+{
+    _lines.clear();
+    _x.clear(); _y.clear(); _z.clear(); _values.clear();
+    _estimates.clear();
+    _variances.clear();
+    _statistics = CrossValidationStatistics{ 0, 0.0, 0.0, 0.0, 0.0 };
+
+    //collect the valid samples once, so the estimation threads only read plain arrays
+    _ps->loadData();
+    int iX = _ps->getXindex() - 1;
+    int iY = _ps->getYindex() - 1;
+    int iZ = _ps->getZindex() - 1;
+    uint nLines = _ps->getDataLineCount();
+    for( uint iLine = 0; iLine < nLines; ++iLine ){
+        double value = _ps->data( iLine, _column );
+        if( value < _tmin || value > _tmax || std::isnan( value ) || _ps->isNDV( value ) )
+            continue;
+        _lines.push_back( iLine );
+        _x.push_back( _ps->data( iLine, iX ) );
+        _y.push_back( _ps->data( iLine, iY ) );
+        _z.push_back( iZ >= 0 ? _ps->data( iLine, iZ ) : 0.0 ); //put 2D data in the z==0.0 plane
+        _values.push_back( value );
+    }
+
+    uint nSamples = _lines.size();
+    if( nSamples < 2 ){
+        Application::instance()->logError("CrossValidation::run(): less than two valid samples.");
+        return false;
+    }
+    _estimates.assign( nSamples, getNoDataValue() );
+    _variances.assign( nSamples, getNoDataValue() );
+
+    const CovarianceKernel kernel( _model );
+    bool ok;
+    if( _globalNeighborhood )
+        ok = runGlobal( kernel );
+    else
+        ok = runLocal( kernel );
+    if( ok )
+        computeStatistics();
+    return ok;
+}
+
+bool CrossValidation::runGlobal(const CovarianceKernel &kernel)
+{
+    uint n = _lines.size();
+    emit setLabel("Cross-validating " + QString::number( n ) + " samples (global neighborhood)...");
+    emit progress( 0 );
+    QCoreApplication::processEvents();
+
+    //the covariance matrix between all samples, filled by rows in parallel
+    MatrixNXM<double> covMatrix( n, n );
+    std::vector<uint> rows( n );
+    for( uint i = 0; i < n; ++i )
+        rows[i] = i;
+    QtConcurrent::blockingMap( rows, [&]( const uint& i ){
+        std::vector<double> sepX( n ), sepY( n ), sepZ( n ), row( n );
+        for( uint j = 0; j < n; ++j ){
+            sepX[j] = _x[j] - _x[i];
+            sepY[j] = _y[j] - _y[i];
+            sepZ[j] = _z[j] - _z[i];
+        }
+        kernel.covariances( sepX.data(), sepY.data(), sepZ.data(), n, row.data() );
+        for( uint j = 0; j < n; ++j )
+            covMatrix( i, j ) = row[j];
+    });
+    emit progress( 30 );
+    QCoreApplication::processEvents();
+
+    KrigingSolver solver;
+    if( ! solver.factorize( covMatrix ) ){
+        Application::instance()->logError("CrossValidation::runGlobal(): the covariance matrix is not positive definite"
+                                          " (are there duplicate samples?).");
+        return false;
+    }
+    emit progress( 60 );
+    QCoreApplication::processEvents();
+
+    //the diagonal of C^-1
+    std::vector<double> invDiagonal;
+    solver.getInverseDiagonal( invDiagonal );
+    emit progress( 90 );
+
+    //the leave-one-out error of sample i is (K^-1 z)_i / (K^-1)_ii and its kriging variance is 1 / (K^-1)_ii,
+    //where K is the kriging matrix of all samples
+    std::vector<double> x( n );
+    if( _kType == KrigingType::SK ){
+        for( uint i = 0; i < n; ++i )
+            x[i] = _values[i] - _meanSK;
+        solver.solve( x );
+    } else {
+        //the bordered OK matrix is handled with the Schur complement of the border of ones:
+        //(K^-1 z)_i = (C^-1 z)_i - a_i (a^T z) / s and (K^-1)_ii = (C^-1)_ii - a_i^2 / s, with a = C^-1 1 and s = 1^T a
+        std::vector<double> a( n, 1.0 );
+        solver.solve( a );
+        x = _values;
+        solver.solve( x );
+        double s = 0.0;
+        double aTz = 0.0;
+        for( uint i = 0; i < n; ++i ){
+            s += a[i];
+            aTz += a[i] * _values[i];
+        }
+        for( uint i = 0; i < n; ++i ){
+            x[i] -= a[i] * aTz / s;
+            invDiagonal[i] -= a[i] * a[i] / s;
+        }
+    }
+    for( uint i = 0; i < n; ++i ){
+        if( invDiagonal[i] <= 0.0 )
+            continue;
+        _estimates[i] = _values[i] - x[i] / invDiagonal[i];
+        _variances[i] = 1.0 / invDiagonal[i];
+    }
+    emit progress( 100 );
+
+    return true;
+}
+
+bool CrossValidation::runLocal(const CovarianceKernel &kernel)
+{
+    uint n = _lines.size();
+    uint nLines = _ps->getDataLineCount();
+
+    //the spatial index has all data lines, so the search skips those without a valid value
+    std::vector<bool> isSample( nLines, false );
+    std::vector<int> sampleOfLine( nLines, -1 );
+    for( uint i = 0; i < n; ++i ){
+        isSample[ _lines[i] ] = true;
+        sampleOfLine[ _lines[i] ] = i;
+    }
+    std::shared_ptr<const SpatialIndexPoints> spatialIndex = _ps->getSpatialIndex();
+
+    //the nearest valid samples inside the search ellipsoid of each sample, but the sample itself
+    emit setLabel("Searching neighbors of " + QString::number( n ) + " samples...");
+    QCoreApplication::processEvents();
+    std::vector<int> excludedLines( _lines.begin(), _lines.end() );
+    SpatialIndexNeighborhoods neighborhoods;
+    spatialIndex->getNeighbors( _x.data(), _y.data(), _z.data(), n, _search, neighborhoods,
+                                excludedLines.data(), &isSample );
+    emit setLabel("Cross-validating " + QString::number( n ) + " samples...");
+
+    //each thread has its own buffers, allocated once for all the samples it estimates
+    int nThreads = std::max( 1, QThreadPool::globalInstance()->maxThreadCount() );
+    std::vector<CrossValidationWorkspace> workspaces( nThreads );
+
+    std::atomic<uint> nextSample( 0 );
+    std::atomic<uint> nDone( 0 );
+    std::atomic<uint> nFailed( 0 );
+    double sill = kernel.getSill();
+
+    QFuture<void> future = QtConcurrent::map( workspaces, [&]( CrossValidationWorkspace& workspace ){
+        for( uint iSample = nextSample++; iSample < n; iSample = nextSample++, ++nDone ){
+            workspace.neighbors.clear();
+            for( std::size_t i = neighborhoods.offsets[iSample]; i < neighborhoods.offsets[iSample+1]; ++i )
+                workspace.neighbors.push_back( sampleOfLine[ neighborhoods.indexes[i] ] );
+            uint nNeighbors = workspace.neighbors.size();
+            if( nNeighbors < _minSamples )
+                continue;
+
+            //the covariances between the neighbors and between them and the sample, one row at a time
+            if( workspace.sepX.size() < nNeighbors ){
+                workspace.sepX.resize( nNeighbors );
+                workspace.sepY.resize( nNeighbors );
+                workspace.sepZ.resize( nNeighbors );
+            }
+            workspace.covMatrix.resize( nNeighbors, nNeighbors );
+            workspace.covariances.resize( nNeighbors );
+            for( uint r = 0; r < nNeighbors; ++r ){
+                uint a = workspace.neighbors[r];
+                for( uint c = 0; c < nNeighbors; ++c ){
+                    uint b = workspace.neighbors[c];
+                    workspace.sepX[c] = _x[b] - _x[a];
+                    workspace.sepY[c] = _y[b] - _y[a];
+                    workspace.sepZ[c] = _z[b] - _z[a];
+                }
+                kernel.covariances( workspace.sepX.data(), workspace.sepY.data(), workspace.sepZ.data(),
+                                    nNeighbors, &workspace.covMatrix( r, 0 ) );
+                workspace.covariances[r] = kernel.covariance( _x[iSample] - _x[a],
+                                                              _y[iSample] - _y[a],
+                                                              _z[iSample] - _z[a] );
+            }
+            if( ! workspace.solver.factorize( workspace.covMatrix ) ){
+                ++nFailed;
+                continue;
+            }
+
+            double variance;
+            double estimate;
+            if( _kType == KrigingType::SK ){
+                workspace.solver.solveSK( workspace.covariances, sill, workspace.weights, variance );
+                estimate = _meanSK;
+                for( uint r = 0; r < nNeighbors; ++r )
+                    estimate += workspace.weights[r] * ( _values[ workspace.neighbors[r] ] - _meanSK );
+            } else {
+                double lagrangian;
+                workspace.solver.solveOK( workspace.covariances, sill, workspace.weights, lagrangian, variance );
+                estimate = 0.0;
+                for( uint r = 0; r < nNeighbors; ++r )
+                    estimate += workspace.weights[r] * _values[ workspace.neighbors[r] ];
+            }
+            //each sample is written by only one thread, so no locking is needed
+            _estimates[iSample] = estimate;
+            _variances[iSample] = variance;
+        }
+    });
+    while( ! future.isFinished() ){
+        emit progress( nDone * 100 / n );
+        QThread::msleep( 100 );
+        QCoreApplication::processEvents();
+    }
+    emit progress( 100 );
+
+    if( nFailed > 0 )
+        Application::instance()->logWarn("CrossValidation::runLocal(): " + QString::number( nFailed ) +
+                                         " samples not estimated due to singular kriging systems (duplicate samples?).");
+    return true;
+}
+
+void CrossValidation::computeStatistics()
+{
+    uint count = 0;
+    double sumError = 0.0, sumSquaredError = 0.0, sumStandardized = 0.0;
+    double sumTrue = 0.0, sumEstimate = 0.0;
+    for( std::size_t i = 0; i < _estimates.size(); ++i ){
+        if( _estimates[i] == getNoDataValue() )
+            continue;
+        ++count;
+        double error = _estimates[i] - _values[i];
+        sumError += error;
+        sumSquaredError += error * error;
+        if( _variances[i] > 0.0 )
+            sumStandardized += error * error / _variances[i];
+        sumTrue += _values[i];
+        sumEstimate += _estimates[i];
+    }
+    _statistics.count = count;
+    if( count == 0 )
+        return;
+    _statistics.meanError = sumError / count;
+    _statistics.meanSquaredError = sumSquaredError / count;
+    _statistics.meanStandardizedSquaredError = sumStandardized / count;
+
+    //the correlation needs the means, so it takes a second pass
+    double meanTrue = sumTrue / count;
+    double meanEstimate = sumEstimate / count;
+    double covariance = 0.0, varianceTrue = 0.0, varianceEstimate = 0.0;
+    for( std::size_t i = 0; i < _estimates.size(); ++i ){
+        if( _estimates[i] == getNoDataValue() )
+            continue;
+        double dTrue = _values[i] - meanTrue;
+        double dEstimate = _estimates[i] - meanEstimate;
+        covariance += dTrue * dEstimate;
+        varianceTrue += dTrue * dTrue;
+        varianceEstimate += dEstimate * dEstimate;
+    }
+    if( varianceTrue > 0.0 && varianceEstimate > 0.0 )
+        _statistics.correlation = covariance / std::sqrt( varianceTrue * varianceEstimate );
+}
+
+bool CrossValidation::writeToFile(const QString path) const
+{
+    QFile outputFile( path );
+    if( ! outputFile.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError("CrossValidation::writeToFile(): could not create " + path);
+        return false;
+    }
+    QTextStream out(&outputFile);
+    out << "Cross-validation" << endl;
+    out << 8 << endl;
+    out << "X" << endl;
+    out << "Y" << endl;
+    out << "Z" << endl;
+    out << "True" << endl;
+    out << "Estimate" << endl;
+    out << "Estimation variance" << endl;
+    out << "Error: est-true" << endl;
+    out << "Standardized error" << endl;
+    for( std::size_t i = 0; i < _lines.size(); ++i ){
+        //making sure the values are written in GSLib-like precision
+        std::stringstream ss;
+        ss << std::setprecision( 12 );
+        ss << _x[i] << '\t' << _y[i] << '\t' << _z[i] << '\t' << _values[i] << '\t';
+        if( _estimates[i] == getNoDataValue() ){
+            ss << getNoDataValue() << '\t' << getNoDataValue() << '\t' << getNoDataValue() << '\t' << getNoDataValue();
+        } else {
+            double error = _estimates[i] - _values[i];
+            ss << _estimates[i] << '\t' << _variances[i] << '\t' << error << '\t';
+            if( _variances[i] > 0.0 )
+                ss << error / std::sqrt( _variances[i] );
+            else
+                ss << getNoDataValue();
+        }
+        out << ss.str().c_str() << endl;
+    }
+    outputFile.close();
+    return true;
+}
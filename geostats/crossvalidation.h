@@ -0,0 +1,118 @@
+#ifndef CROSSVALIDATION_H
+#define CROSSVALIDATION_H
+
+#include <QObject>
+#include <QString>
+#include <vector>
+#include "geostats/geostatsutils.h"
+#include "spatialindex/searchellipsoid.h"
+
+class PointSet;
+class VariogramModel;
+class CovarianceKernel;
+
+/** Summary statistics of the cross-validation errors (estimate minus true value). */
+struct CrossValidationStatistics {
+    /** Number of samples with an estimate. */
+    uint count;
+    double meanError;
+    double meanSquaredError;
+    /** Mean of error^2/kriging variance.  Close to 1.0 if the kriging variances reflect the actual errors. */
+    double meanStandardizedSquaredError;
+    /** Correlation coefficient between the true and the estimated values. */
+    double correlation;
+};
+
+/**
+ * The CrossValidation class is an in-process replacement for the cross-validation mode of GSLib's kt3d.
+ * Each sample is estimated by simple or ordinary kriging from the other samples (leave-one-out).
+ * With a local neighborhood, the samples are estimated in parallel and their neighbors are found with
+ * the spatial index of the point set (see PointSet::getSpatialIndex()).  With a global neighborhood (all
+ * other samples), the whole cross-validation is obtained from a single factorization of the covariance
+ * matrix between all samples using the closed-form leave-one-out formulas (Dubrule, 1983), which costs
+ * about as much as one global kriging system instead of one per sample.
+ */
+class CrossValidation : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param column The data column index (first == 0) of the variable.
+     */
+    CrossValidation( PointSet* ps, uint column, VariogramModel* model, QObject *parent = nullptr );
+    ~CrossValidation();
+
+    /** Values outside the trimming limits are not used (as in kt3d).  Default is no trimming. */
+    void setTrimmingLimits( double tmin, double tmax );
+
+    /** Sets the kriging type.  The mean is used only by simple kriging.  Default is ordinary kriging. */
+    void setKrigingType( KrigingType kType, double meanSK = 0.0 );
+
+    /**
+     * Sets the local neighborhood search.  Samples with less than minSamples neighbors inside the search
+     * ellipsoid are not estimated.  Default is 4 to 8 samples at any distance.
+     */
+    void setSearch( uint minSamples, const SearchEllipsoid& search );
+
+    /** Sets whether all other samples are used for each estimate (the fast closed-form shortcut). */
+    void setGlobalNeighborhood( bool value ){ _globalNeighborhood = value; }
+
+    /** Runs the cross-validation.  Returns false if there are not enough samples or the kriging system fails. */
+    bool run();
+
+    /** Returns the data lines of the samples used (those with valid values), in the order of the results. */
+    const std::vector<uint>& getSampleLines() const { return _lines; }
+
+    /** Returns the estimates of the samples.  Samples not estimated get getNoDataValue(). */
+    const std::vector<double>& getEstimates() const { return _estimates; }
+
+    /** Returns the kriging variances of the samples.  Samples not estimated get getNoDataValue(). */
+    const std::vector<double>& getVariances() const { return _variances; }
+
+    /** Returns the statistics of the errors computed by run(). */
+    const CrossValidationStatistics& getStatistics() const { return _statistics; }
+
+    /** The value assigned to samples not estimated (-999.0, same as kt3d). */
+    static double getNoDataValue(){ return -999.0; }
+
+    /**
+     * Writes the results as a GEO-EAS file with the columns X, Y, Z, true value, estimate, kriging variance,
+     * error and standardized error, which is the layout of kt3d's cross-validation output plus the errors.
+     */
+    bool writeToFile( const QString path ) const;
+
+signals:
+    void progress(int);
+    void setLabel(QString);
+
+private:
+    PointSet* _ps;
+    uint _column;
+    VariogramModel* _model;
+    double _tmin;
+    double _tmax;
+    KrigingType _kType;
+    double _meanSK;
+    uint _minSamples;
+    SearchEllipsoid _search;
+    bool _globalNeighborhood;
+
+    /** The valid samples: their data lines, coordinates and values. */
+    std::vector<uint> _lines;
+    std::vector<double> _x, _y, _z, _values;
+
+    std::vector<double> _estimates;
+    std::vector<double> _variances;
+    CrossValidationStatistics _statistics;
+
+    /** Leave-one-out with all other samples as neighbors, from the inverse of the global system. */
+    bool runGlobal( const CovarianceKernel& kernel );
+
+    /** Leave-one-out with neighbors found by the spatial index, one kriging system per sample. */
+    bool runLocal( const CovarianceKernel& kernel );
+
+    void computeStatistics();
+};
+
+#endif // CROSSVALIDATION_H
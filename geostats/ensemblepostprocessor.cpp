@@ -0,0 +1,288 @@
+#include "ensemblepostprocessor.h"
+
+#include "normalscoretransform.h"
+#include "domain/application.h"
+#include "domain/cartesiangrid.h"
+#include "util.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+
+//number of cells processed by each parallel task
+#define ENSEMBLE_BLOCK_SIZE 4096
+
+namespace {
+
+    /** The state of a P² quantile estimator: five marker heights and positions. */
+    struct P2Estimator {
+        double q[5];
+        int n[5];
+    };
+
+    /** Feeds a new observation to a P² estimator.  count is the number of observations including x. */
+    inline void p2Add( P2Estimator& e, double p, int count, double x ){
+        //the first five observations are kept sorted
+        if( count <= 5 ){
+            int i = count - 1;
+            for( ; i > 0 && e.q[i-1] > x; --i )
+                e.q[i] = e.q[i-1];
+            e.q[i] = x;
+            if( count == 5 )
+                for( int m = 0; m < 5; ++m )
+                    e.n[m] = m + 1;
+            return;
+        }
+
+        //find the cell k such that q[k] <= x < q[k+1], adjusting the extremes if necessary
+        int k;
+        if( x < e.q[0] ){
+            e.q[0] = x;
+            k = 0;
+        } else if( x >= e.q[4] ){
+            e.q[4] = x;
+            k = 3;
+        } else {
+            k = 0;
+            while( k < 3 && x >= e.q[k+1] )
+                ++k;
+        }
+        for( int m = k + 1; m < 5; ++m )
+            ++e.n[m];
+
+        //adjust the heights of the three middle markers if necessary
+        double np[5] = { 1.0,
+                         1.0 + ( count - 1 ) * p / 2.0,
+                         1.0 + ( count - 1 ) * p,
+                         1.0 + ( count - 1 ) * ( 1.0 + p ) / 2.0,
+                         (double)count };
+        for( int m = 1; m < 4; ++m ){
+            double d = np[m] - e.n[m];
+            if( ( d >= 1.0 && e.n[m+1] - e.n[m] > 1 ) || ( d <= -1.0 && e.n[m-1] - e.n[m] < -1 ) ){
+                int ds = d > 0.0 ? 1 : -1;
+                //try the piecewise-parabolic formula
+                double qp = e.q[m] + ds / (double)( e.n[m+1] - e.n[m-1] ) *
+                        ( ( e.n[m] - e.n[m-1] + ds ) * ( e.q[m+1] - e.q[m] ) / ( e.n[m+1] - e.n[m] ) +
+                          ( e.n[m+1] - e.n[m] - ds ) * ( e.q[m] - e.q[m-1] ) / ( e.n[m] - e.n[m-1] ) );
+                //use linear interpolation if the parabolic prediction is out of order
+                if( e.q[m-1] < qp && qp < e.q[m+1] )
+                    e.q[m] = qp;
+                else
+                    e.q[m] = e.q[m] + ds * ( e.q[m+ds] - e.q[m] ) / ( e.n[m+ds] - e.n[m] );
+                e.n[m] += ds;
+            }
+        }
+    }
+
+    /** Returns the current quantile estimate. */
+    inline double p2Get( const P2Estimator& e, double p, int count ){
+        //up to five observations, the sorted values are all kept, so interpolate them exactly
+        if( count <= 5 ){
+            double position = p * ( count - 1 );
+            int i = std::min( (int)position, count - 1 );
+            if( i + 1 >= count )
+                return e.q[i];
+            return e.q[i] + ( position - i ) * ( e.q[i+1] - e.q[i] );
+        }
+        //the middle marker estimates the p-quantile once it has reached its desired position.  Until then
+        //(it starts at the median and moves one position per observation), interpolate the markers there.
+        double desired = 1.0 + ( count - 1 ) * p;
+        if( std::abs( desired - e.n[2] ) < 1.0 )
+            return e.q[2];
+        int m = 0;
+        while( m < 3 && desired >= e.n[m+1] )
+            ++m;
+        return e.q[m] + ( desired - e.n[m] ) * ( e.q[m+1] - e.q[m] ) / ( e.n[m+1] - e.n[m] );
+    }
+}
+
+EnsemblePostProcessor::EnsemblePostProcessor(CartesianGrid *realizations, uint column, QObject *parent) :
+    QObject(parent),
+    _cg( realizations ),
+    _column( column ),
+    _tmin( -std::numeric_limits<double>::max() ),
+    _tmax( std::numeric_limits<double>::max() ),
+    _computeMoments( false )
+{
+}
+
+void EnsemblePostProcessor::setTrimmingLimits(double tmin, double tmax)
+{
+    _tmin = tmin;
+    _tmax = tmax;
+}
+
+void EnsemblePostProcessor::addThreshold(double threshold)
+{
+    _thresholds.push_back( threshold );
+}
+
+void EnsemblePostProcessor::addQuantile(double p)
+{
+    _quantiles.push_back( std::min( 1.0, std::max( 0.0, p ) ) );
+}
+
+bool EnsemblePostProcessor::run()
+{
+    _results.clear();
+    _resultNames.clear();
+
+    if( ! _computeMoments && _thresholds.empty() && _quantiles.empty() ){
+        Application::instance()->logError("EnsemblePostProcessor::run(): no post-processing product requested.");
+        return false;
+    }
+
+    //the whole realization set must be in memory
+    _cg->setDataPageToAll();
+    _cg->loadData();
+
+    uint nCells = _cg->getNX() * _cg->getNY() * _cg->getNZ();
+    if( nCells == 0 || _cg->getDataLineCount() < nCells * _cg->getNReal() ){
+        Application::instance()->logError("EnsemblePostProcessor::run(): grid geometry does not match the realization data.");
+        return false;
+    }
+
+    //allocate the result maps
+    if( _computeMoments ){
+        _resultNames.push_back( "mean" );
+        _resultNames.push_back( "variance" );
+    }
+    for( double threshold : _thresholds ){
+        _resultNames.push_back( "prob > " + QString::number( threshold ) );
+        _resultNames.push_back( "mean > " + QString::number( threshold ) );
+    }
+    for( double p : _quantiles )
+        _resultNames.push_back( "P" + QString::number( p * 100.0 ) );
+    _results.assign( _resultNames.size(), std::vector<double>( nCells, getNoDataValue() ) );
+
+    //make the blocks of cells
+    std::vector< std::pair<uint, uint> > blocks;
+    for( uint first = 0; first < nCells; first += ENSEMBLE_BLOCK_SIZE )
+        blocks.push_back( { first, std::min( nCells, first + ENSEMBLE_BLOCK_SIZE ) } );
+
+    //process the blocks in parallel
+    emit setLabel("Post-processing " + QString::number( _cg->getNReal() ) + " realizations...");
+    QFuture<void> future = QtConcurrent::map( blocks, [this]( const std::pair<uint, uint>& block ){
+        processBlock( block.first, block.second );
+    });
+    while( ! future.isFinished() ){
+        emit progress( future.progressValue() * 100 / std::max<std::size_t>( 1, blocks.size() ) );
+        QThread::msleep( 100 );
+        QCoreApplication::processEvents();
+    }
+    emit progress( 100 );
+
+    return true;
+}
+
+void EnsemblePostProcessor::processBlock(uint firstCell, uint lastCell)
+{
+    uint nCells = _cg->getNX() * _cg->getNY() * _cg->getNZ();
+    uint nReal = _cg->getNReal();
+    uint nBlockCells = lastCell - firstCell;
+    uint nThresholds = _thresholds.size();
+    uint nQuantiles = _quantiles.size();
+    bool hasNDV = _cg->hasNoDataValue();
+    double NDV = _cg->getNoDataValueAsDouble();
+
+    //the per-cell accumulators of this block
+    std::vector<int> count( nBlockCells, 0 );
+    std::vector<double> mean( nBlockCells, 0.0 );
+    std::vector<double> m2( nBlockCells, 0.0 );
+    std::vector<int> countAbove( nBlockCells * nThresholds, 0 );
+    std::vector<double> sumAbove( nBlockCells * nThresholds, 0.0 );
+    std::vector<P2Estimator> estimators( nBlockCells * nQuantiles );
+
+    //the values of a realization in the block
+    std::vector<double> values( nBlockCells );
+    std::vector<double> normalScores;
+
+    //visit all realizations once, cell by cell
+    for( uint iReal = 0; iReal < nReal; ++iReal ){
+        uint firstLine = iReal * nCells + firstCell;
+        for( uint iCell = 0; iCell < nBlockCells; ++iCell )
+            values[iCell] = _cg->data( firstLine + iCell, _column );
+        //the block of a realization is back transformed at once (the no-data values are kept)
+        if( _backTransform ){
+            normalScores.swap( values );
+            _backTransform->fromNormal( normalScores, values, hasNDV, NDV );
+        }
+        for( uint iCell = 0; iCell < nBlockCells; ++iCell ){
+            double value = values[iCell];
+            if( value < _tmin || value >= _tmax || std::isnan( value ) )
+                continue;
+            if( hasNDV && Util::almostEqual2sComplement( NDV, value, 1 ) )
+                continue;
+            int n = ++count[iCell];
+            //running moments
+            double delta = value - mean[iCell];
+            mean[iCell] += delta / n;
+            m2[iCell] += delta * ( value - mean[iCell] );
+            //exceedance counters
+            for( uint t = 0; t < nThresholds; ++t )
+                if( value > _thresholds[t] ){
+                    ++countAbove[ iCell * nThresholds + t ];
+                    sumAbove[ iCell * nThresholds + t ] += value;
+                }
+            //quantile estimators
+            for( uint q = 0; q < nQuantiles; ++q )
+                p2Add( estimators[ iCell * nQuantiles + q ], _quantiles[q], n, value );
+        }
+    }
+
+    //write the block's results (the blocks do not overlap, so no locking is needed)
+    for( uint iCell = 0; iCell < nBlockCells; ++iCell ){
+        int n = count[iCell];
+        if( n == 0 )
+            continue;
+        uint cell = firstCell + iCell;
+        uint iResult = 0;
+        if( _computeMoments ){
+            _results[iResult++][cell] = mean[iCell];
+            _results[iResult++][cell] = m2[iCell] / n;
+        }
+        for( uint t = 0; t < nThresholds; ++t ){
+            int nAbove = countAbove[ iCell * nThresholds + t ];
+            _results[iResult++][cell] = nAbove / (double)n;
+            if( nAbove > 0 )
+                _results[iResult][cell] = sumAbove[ iCell * nThresholds + t ] / nAbove;
+            ++iResult;
+        }
+        for( uint q = 0; q < nQuantiles; ++q )
+            _results[iResult++][cell] = p2Get( estimators[ iCell * nQuantiles + q ], _quantiles[q], n );
+    }
+}
+
+bool EnsemblePostProcessor::writeToFile(const QString path) const
+{
+    QFile outputFile( path );
+    if( ! outputFile.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError("EnsemblePostProcessor::writeToFile(): could not create " + path);
+        return false;
+    }
+    QTextStream out(&outputFile);
+    out << "Post-processed realizations" << endl;
+    out << _results.size() << endl;
+    for( const QString& name : _resultNames )
+        out << name << endl;
+    std::size_t nCells = _results.empty() ? 0 : _results[0].size();
+    for( std::size_t cell = 0; cell < nCells; ++cell ){
+        //making sure the values are written in GSLib-like precision
+        std::stringstream ss;
+        ss << std::setprecision( 12 );
+        for( std::size_t iResult = 0; iResult < _results.size(); ++iResult ){
+            if( iResult > 0 )
+                ss << '\t';
+            ss << _results[iResult][cell];
+        }
+        out << ss.str().c_str() << endl;
+    }
+    outputFile.close();
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef ENSEMBLEPOSTPROCESSOR_H
+#define ENSEMBLEPOSTPROCESSOR_H
+
+#include <QObject>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class CartesianGrid;
+class NormalScoreTransform;
+
+/**
+ * The EnsemblePostProcessor class is an in-process replacement for GSLib's postsim.  It traverses
+ * all realizations stored in a Cartesian grid once, updating per-cell accumulators: running mean and
+ * variance (Welford's method), exceedance counters and sums for thresholds and P² quantile estimators
+ * (Jain and Chlamtac, 1985) for percentiles.  Memory is bounded by the number of cells and requested
+ * products, not by the number of realizations.  The cells are split into blocks which are processed
+ * in parallel.  All requested summary maps are produced by a single run.
+ */
+class EnsemblePostProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param realizations The grid with realizations, one after the other, as written by sgsim, sisim, etc.
+     * @param column The data column index (first == 0) of the simulated variable.
+     */
+    EnsemblePostProcessor( CartesianGrid* realizations, uint column, QObject *parent = nullptr );
+
+    /** Values below tmin or not below tmax are ignored (as in postsim).  Default is no trimming. */
+    void setTrimmingLimits( double tmin, double tmax );
+
+    /**
+     * Sets a transform to back transform the realization values before they are summarized, as running backtr
+     * on each realization before postsim (e.g. sgsim realizations simulated in normal scores).  The trimming
+     * limits apply to the back transformed values.  Default is no back transform.
+     */
+    void setBackTransform( std::shared_ptr<const NormalScoreTransform> transform ){ _backTransform = transform; }
+
+    /** Enables the output of the E-type (mean) and conditional variance maps. */
+    void setComputeMoments( bool value ){ _computeMoments = value; }
+
+    /** Adds a threshold for the probability and mean above threshold maps. */
+    void addThreshold( double threshold );
+
+    /** Adds a cumulative probability (0.0 to 1.0) for a quantile map. */
+    void addQuantile( double p );
+
+    /** Runs the post-processing.  Returns false if there is nothing to compute or no data. */
+    bool run();
+
+    /** Returns the number of computed maps. */
+    uint getResultCount() const { return _results.size(); }
+
+    /** Returns the name of a computed map.  The order is: mean, variance, then probability and mean
+     * above for each threshold, then one map per quantile, following the order the products were added. */
+    QString getResultName( uint index ) const { return _resultNames[index]; }
+
+    /** Returns the values of a computed map.  Cells without valid realization values get getNoDataValue(). */
+    const std::vector<double>& getResult( uint index ) const { return _results[index]; }
+
+    /** The value assigned to cells without valid values (-999.0, same as postsim). */
+    static double getNoDataValue(){ return -999.0; }
+
+    /** Writes all computed maps as columns of a GEO-EAS file. */
+    bool writeToFile( const QString path ) const;
+
+signals:
+    void progress(int);
+    void setLabel(QString);
+
+private:
+    CartesianGrid* _cg;
+    uint _column;
+    double _tmin;
+    double _tmax;
+    bool _computeMoments;
+    std::shared_ptr<const NormalScoreTransform> _backTransform;
+    std::vector<double> _thresholds;
+    std::vector<double> _quantiles;
+    std::vector< std::vector<double> > _results;
+    std::vector< QString > _resultNames;
+
+    /** Processes the cells in [firstCell, lastCell) of all realizations. */
+    void processBlock( uint firstCell, uint lastCell );
+};
+
+#endif // ENSEMBLEPOSTPROCESSOR_H
@@ -0,0 +1,79 @@
+#include "gammabar.h"
+
+#include "boundedcache.h"
+#include "covariancekernel.h"
+#include "domain/variogrammodel.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <tuple>
+
+//maximum number of results kept for reuse
+#define GAMMA_BAR_CACHE_SIZE 1024
+
+namespace {
+
+    /** Key of the results cache. */
+    typedef std::tuple< VariogramModel*, uint, double, double, double, int, int, int > GammaBarCacheKey;
+
+    BoundedCache< GammaBarCacheKey, double > gammaBarCache( GAMMA_BAR_CACHE_SIZE );
+
+    /** Computes the average variogram between the discretization points of a block (see GammaBar::compute()). */
+    double computeGammaBar( VariogramModel *model, double dx, double dy, double dz, int nx, int ny, int nz ){
+        //read the model parameters once
+        CovarianceKernel kernel( model );
+
+        //spacing between the discretization points
+        double sx = dx / nx;
+        double sy = dy / ny;
+        double sz = dz / nz;
+
+        //the separations for each possible offset between two discretization points
+        //and the number of point pairs with that offset
+        unsigned int nOffsets = (unsigned int)( 2*nx-1 ) * ( 2*ny-1 ) * ( 2*nz-1 );
+        std::vector<double> hx, hy, hz, nPairs;
+        hx.reserve( nOffsets );
+        hy.reserve( nOffsets );
+        hz.reserve( nOffsets );
+        nPairs.reserve( nOffsets );
+        for( int dk = -(nz-1); dk <= nz-1; ++dk ){
+            for( int dj = -(ny-1); dj <= ny-1; ++dj ){
+                for( int di = -(nx-1); di <= nx-1; ++di ){
+                    hx.push_back( di * sx );
+                    hy.push_back( dj * sy );
+                    hz.push_back( dk * sz );
+                    nPairs.push_back( (double)( nx - std::abs( di ) ) * ( ny - std::abs( dj ) ) * ( nz - std::abs( dk ) ) );
+                }
+            }
+        }
+
+        //evaluate the variogram for all offsets at once (zero separation has zero variogram)
+        std::vector<double> gammas( nOffsets );
+        kernel.gammas( hx.data(), hy.data(), hz.data(), nOffsets, gammas.data() );
+
+        double sumOfGammas = 0.0;
+        for( unsigned int i = 0; i < nOffsets; ++i )
+            sumOfGammas += nPairs[i] * gammas[i];
+        double nPoints = (double)nx * ny * nz;
+        return sumOfGammas / ( nPoints * nPoints );
+    }
+}
+
+double GammaBar::compute(VariogramModel *model, double dx, double dy, double dz, int nx, int ny, int nz)
+{
+    nx = std::max( 1, nx );
+    ny = std::max( 1, ny );
+    nz = std::max( 1, nz );
+
+    //the model version is part of the key, so editing the model invalidates the cached results
+    GammaBarCacheKey key( model, model->getVersion(), dx, dy, dz, nx, ny, nz );
+    return gammaBarCache.get( key, [&](){
+        return computeGammaBar( model, dx, dy, dz, nx, ny, nz );
+    });
+}
+
+void GammaBar::clearCache()
+{
+    gammaBarCache.clear();
+}
@@ -0,0 +1,30 @@
+#ifndef GAMMABAR_H
+#define GAMMABAR_H
+
+class VariogramModel;
+
+/**
+ * The GammaBar class computes the average variogram value within a block (gamma-bar(V,V)), as GSLib's
+ * gammabar program does, but in-process.  The block is discretized into nx*ny*nz points and the variogram
+ * is averaged over all pairs of points.  Since the separation between two discretization points depends only on
+ * their integer offset, the variogram is evaluated once per offset and weighted by the number of pairs with
+ * that offset, which reduces the cost from (nx*ny*nz)^2 to (2nx-1)*(2ny-1)*(2nz-1) evaluations.  Results are
+ * cached per block size, discretization and variogram model (the cache is invalidated if the model changes).
+ */
+class GammaBar
+{
+public:
+    /**
+     * Returns the average variogram value in a block.
+     * @param dx, dy, dz Block sizes (normally the grid cell sizes).
+     * @param nx, ny, nz Block discretization (number of points along each axis).
+     */
+    static double compute( VariogramModel* model,
+                           double dx, double dy, double dz,
+                           int nx, int ny, int nz );
+
+    /** Clears the results cache. */
+    static void clearCache();
+};
+
+#endif // GAMMABAR_H
@@ -3,19 +3,13 @@
 #include "gridcell.h"
 #include "domain/cartesiangrid.h"
 #include "spatiallocation.h"
-#include "ijkdelta.h"
 #include "util.h"
-#include "ijkdeltascache.h"
+#include "covariancekernel.h"
+#include "covariancetable.h"
 
 #include <cmath>
 #include <limits>
 
-//the aniso transforms only change if variogram model changes
-struct AnisoCache{
-    VariogramModel* vModel;
-    std::vector<Matrix3X3<double>> anisoTransforms;
-} anisoCache;
-
 GeostatsUtils::GeostatsUtils()
 {
 }
@@ -105,47 +99,11 @@ double GeostatsUtils::getGamma(VariogramStructureType permissiveModel, double h,
     return std::numeric_limits<double>::quiet_NaN();
 }
 
-double GeostatsUtils::getGamma(VariogramModel *model, SpatialLocation &locA, SpatialLocation &locB)
-{
-    //lesser bottleneck
-    double result = model->getNugget();
-    int nst = model->getNst();
-
-    for( int i = 0; i < nst; ++i){
-        Matrix3X3<double> anisoTransform;
-        //improving performance by saving the aniso transforms in a cache, assuming the anisotropy
-        //      is the same in all locations.
-        if( anisoCache.vModel != model){
-            anisoTransform = GeostatsUtils::getAnisoTransform(
-                        model->get_a_hMax(i), model->get_a_hMin(i), model->get_a_vert(i),
-                        model->getAzimuth(i), model->getDip(i), model->getRoll(i));
-            anisoCache.anisoTransforms.push_back( anisoTransform );
-        } else {
-            anisoTransform = anisoCache.anisoTransforms[i];
-        }
-
-        //get the separation corrected by anisotropy
-        double h = GeostatsUtils::getH( locA._x, locA._y, locA._z,
-                                        locB._x, locB._y, locB._z,
-                                        anisoTransform );
-
-        result += GeostatsUtils::getGamma( model->getIt(i),
-                                           h,
-                                           model->get_a_hMax(i),
-                                           model->getCC(i) );
-    }
-
-    //sets the cache's key (variogram model pointer) so we know whether we can reuse the aniso transforms
-    //saved in the cache
-    anisoCache.vModel = model;
-
-    return result;
-}
-
-MatrixNXM<double> GeostatsUtils::makeCovMatrix(std::multiset<GridCell> &samples,
-                                               VariogramModel *variogramModel,
-                                               double variogramSill,
-                                               KrigingType kType)
+void GeostatsUtils::makeCovMatrix(const NeighborBuffer &samples,
+                                  const CovarianceKernel &covKernel,
+                                  MatrixNXM<double> &covMatrix,
+                                  KrigingType kType,
+                                  const CovarianceTable *covTable)
 {
     //Define the dimension of cov matrix, which depends on kriging type
     int append = 0;
@@ -156,28 +114,29 @@ MatrixNXM<double> GeostatsUtils::makeCovMatrix(std::multiset<GridCell> &samples,
         append = 1; break;
     }
 
-    //Create the cov matrix.
-    MatrixNXM<double> covMatrix( samples.size() + append, samples.size() + append );
-
-    //convert the std::multiset into a std::vector for faster traversal
-    //(memory locality and less pointer chasing)
-    std::vector<GridCell> samplesV;
-    samplesV.reserve( samples.size() );
-    std::copy(samples.begin(), samples.end(), std::back_inserter(samplesV));
+    //Size the cov matrix (reuses its storage).
+    const unsigned int dim = samples.size();
+    covMatrix.resize( dim + append, dim + append );
 
     //For each sample.
-    std::vector<GridCell>::iterator rowsIt = samplesV.begin();
-    for( int i = 0; rowsIt != samplesV.end(); ++rowsIt, ++i ){
-        GridCell rowCell = *rowsIt;
+    for( unsigned int i = 0; i < dim; ++i ){
+        const NeighborCell& rowCell = samples[i];
         //For each sample.
-        std::vector<GridCell>::iterator colsIt = samplesV.begin();
-        for( int j = 0; colsIt != samplesV.end(); ++colsIt, ++j ){
-            GridCell colCell = *colsIt;
-            //get semi-variance value from the separation between two samples in a pair
-            double gamma = GeostatsUtils::getGamma( variogramModel, rowCell._center, colCell._center );
+        for( unsigned int j = 0; j < dim; ++j ){
+            const NeighborCell& colCell = samples[j];
+            //the covariance between cells depends only on their offset, so try the table first
+            int di = colCell._indexIJK._i - rowCell._indexIJK._i;
+            int dj = colCell._indexIJK._j - rowCell._indexIJK._j;
+            int dk = colCell._indexIJK._k - rowCell._indexIJK._k;
+            if( covTable && covTable->covers( di, dj, dk ) ){
+                covMatrix(i, j) = covTable->get( di, dj, dk );
+                continue;
+            }
             //get covariance for the sample pair and assign it the corresponding element in the
             //cov matrix
-            covMatrix(i, j) = variogramSill - gamma;
+            covMatrix(i, j) = covKernel.covariance( colCell._center._x - rowCell._center._x,
+                                                    colCell._center._y - rowCell._center._y,
+                                                    colCell._center._z - rowCell._center._z );
         }
     }
 
@@ -185,20 +144,20 @@ MatrixNXM<double> GeostatsUtils::makeCovMatrix(std::multiset<GridCell> &samples,
     switch( kType ){
     case KrigingType::SK: break;
     case KrigingType::OK:
-        int dim = samples.size();
-        for( int i = 0; i < dim; ++i ){
+        for( unsigned int i = 0; i < dim; ++i ){
             covMatrix( dim, i ) = 1.0; //last row with ones
             covMatrix( i, dim ) = 1.0; //last columns with ones
         }
         covMatrix( dim, dim ) = 0.0; //last element is zero
     }
-
-    return covMatrix;
 }
 
-MatrixNXM<double> GeostatsUtils::makeGammaMatrix(std::multiset<GridCell> &samples,
-                                                 GridCell &estimationLocation,
-                                                 VariogramModel *variogramModel, KrigingType kType)
+void GeostatsUtils::makeGammaMatrix(const NeighborBuffer &samples,
+                                    const GridCell &estimationLocation,
+                                    const CovarianceKernel &covKernel,
+                                    MatrixNXM<double> &gammaMatrix,
+                                    KrigingType kType,
+                                    const CovarianceTable *covTable)
 {
     int append = 0;
     switch( kType ){
@@ -208,118 +167,28 @@ MatrixNXM<double> GeostatsUtils::makeGammaMatrix(std::multiset<GridCell> &sample
         append = 1; break;
     }
 
-    MatrixNXM<double> result( samples.size()+append, 1 );
-
-    std::multiset<GridCell>::iterator rowsIt = samples.begin();
-
-    for( int i = 0; rowsIt != samples.end(); ++rowsIt, ++i ){
-        GridCell rowCell = *rowsIt;
-        //get semi-variance value
-        double gamma = GeostatsUtils::getGamma( variogramModel, rowCell._center, estimationLocation._center );
+    const unsigned int dim = samples.size();
+    gammaMatrix.resize( dim + append, 1 );
+
+    for( unsigned int i = 0; i < dim; ++i ){
+        const NeighborCell& rowCell = samples[i];
+        int di = estimationLocation._indexIJK._i - rowCell._indexIJK._i;
+        int dj = estimationLocation._indexIJK._j - rowCell._indexIJK._j;
+        int dk = estimationLocation._indexIJK._k - rowCell._indexIJK._k;
+        if( covTable && covTable->covers( di, dj, dk ) ){
+            gammaMatrix(i, 0) = covTable->get( di, dj, dk );
+            continue;
+        }
         //get covariance
-        result(i, 0) = variogramModel->getSill() - gamma;
+        gammaMatrix(i, 0) = covKernel.covariance( estimationLocation._center._x - rowCell._center._x,
+                                                  estimationLocation._center._y - rowCell._center._y,
+                                                  estimationLocation._center._z - rowCell._center._z );
     }
 
     //prepare the matrix for an OK system, if this is the case.
     switch( kType ){
     case KrigingType::SK: break;
     case KrigingType::OK:
-        result( samples.size(), 0 ) = 1.0; //last element is one
-    }
-
-    return result;
-}
-
-void GeostatsUtils::getValuedNeighborsTopoOrdered(GridCell &cell,
-                                                        int numberOfSamples,
-                                                        int nColsAround,
-                                                        int nRowsAround,
-                                                        int nSlicesAround,
-                                                        bool hasNDV,
-                                                        double NDV,
-                                                        std::multiset<GridCell> &list)
-{
-    CartesianGrid* cg = cell._grid;
-    if( ! cg ){
-        Application::instance()->logError("GeostatsUtils::getValuedNeighborsTopoOrdered(): null grid.  Returning empty list.");
-    }
-
-    //get the grid limits
-    int row_limit = cg->getNY();
-    int column_limit = cg->getNX();
-    int slice_limit = cg->getNZ();
-
-    //generate all possible ijk deltas up to the neighborhood limits
-    //the list of deltas is ordered by resulting distance with respect to a target cell
-    //////////the block of code below is considered optimal (speed)
-    std::vector<IJKDelta> *deltasV = nullptr;
-    //try to reuse a list from the cache since making one anew is costly and the neighborhood does not change
-    IJKDeltasCacheMap::iterator itcache =
-            IJKDeltasCache::cache.find( IJKDeltasCacheKey( nColsAround, nRowsAround, nSlicesAround ) );
-    if( itcache != IJKDeltasCache::cache.end() ){ //cache hit
-        deltasV = itcache->second;
-    } else { //cache miss, have to build the list
-        //build the list as a set to get free ordering
-        std::set<IJKDelta> *deltas = new std::set<IJKDelta>();
-        for( int dk = 0; dk <= nSlicesAround/2; ++dk){
-            for( int dj = 0; dj <= nColsAround/2; ++dj ){
-                for( int di = 0; di <= nRowsAround/2; ++di){
-                    deltas->insert( IJKDelta( di, dj, dk) );
-                }
-            }
-        }
-        //the first element is always delta 0,0,0 (target cell itself)
-        deltas->erase( deltas->begin() );
-        //now that std::set assured an ordered collection, transform it into an std::vector
-        //which is faster to iterate because there is no pointer chasing and std::vector elements
-        //are stored in continuous blocks of memory (memory locality increases cache hits)
-        deltasV = new std::vector<IJKDelta>();
-        deltasV->reserve( deltas->size() );
-        std::copy(deltas->begin(), deltas->end(), std::back_inserter(*deltasV));
-        //store the list in the cache for later reuse.
-        IJKDeltasCache::cache.emplace( IJKDeltasCacheKey( nColsAround,
-                                                         nRowsAround,
-                                                         nSlicesAround ), deltasV );
-        //we don't need the std::set anymore
-        delete deltas;
-    }
-
-    if( !deltasV || deltasV->empty() ){ //hope the second is not evaluated if deltas == nullptr
-        Application::instance()->logError("GeostatsUtils::getValuedNeighborsTopoOrdered(): null neighborhood.  Returning empty list.");
-    }
-    //////////////////////////////////////////////////
-
-    //for each delta...
-    std::vector<IJKDelta>::const_iterator it = deltasV->cbegin();
-    IJKIndex indexes[8]; //eight indexes is the most possible (3 degrees of freedom)
-    for(; it != deltasV->end(); ++it){
-        const IJKDelta &delta = (*it);
-        //...get all the indexes from a delta (can yield 2, 4 or 8 coordinates, depending on the delta's degrees of freedom).
-        // TODO: Performance: that getIndexes() function has improved, but maybe there is still some room for improvement
-        int countIndexes = delta.getIndexes( cell._indexIJK, indexes );
-        //for each topological coordinate (IJK index)...
-        for( int iIndex = 0; iIndex < countIndexes; ++iIndex){
-            int ii = indexes[iIndex]._i;
-            int jj = indexes[iIndex]._j;
-            int kk = indexes[iIndex]._k;
-            //...if the index is within the grid limits...
-            if( ii >= 0 && ii < row_limit &&
-                jj >= 0 && jj < column_limit &&
-                kk >= 0 && kk < slice_limit ){
-                //...get the value corresponding to the cell index.
-                double value = cg->dataIJK( cell._dataIndex, ii, jj, kk );
-                //if the cell is valued... DataFile::hasNDV() is slow.
-                if( !hasNDV || !Util::almostEqual2sComplement( NDV, value, 1 ) ){
-                    //...it is a valid neighbor.
-                    GridCell currentCell( cg, cell._dataIndex, ii, jj, kk );
-                    currentCell.computeTopoDistance( cell );
-                    list.insert( currentCell );
-                    //if the number of neighbors is reached...
-                    if( list.size() == (unsigned)numberOfSamples )
-                        //...interrupt the search
-                        return;
-                }
-            }
-        }
+        gammaMatrix( dim, 0 ) = 1.0; //last element is one
     }
 }
@@ -4,10 +4,11 @@
 #include "matrix3x3.h"
 #include "matrixmxn.h"
 #include "domain/variogrammodel.h"
-#include <set>
+#include "neighborbuffer.h"
 
+class CovarianceKernel;
+class CovarianceTable;
 class GridCell;
-class SpatialLocation;
 
 /*! Kriging type. */
 enum class KrigingType : unsigned {
@@ -56,44 +57,35 @@ public:
     static double getGamma( VariogramStructureType permissiveModel, double h, double range, double contribution );
 
     /**
-     * Returns the total covariance according to a variogram model between two locations.
-     * Includes the nugget effet contribution, if any.
-     */
-    static double getGamma(VariogramModel* model, SpatialLocation &locA, SpatialLocation &locB );
-
-    /**
-     * Creates a covariance matrix for the given set of samples.
+     * Fills a covariance matrix for the given set of samples.  The matrix is resized as needed, so the same matrix
+     * can be reused for many estimations without allocating memory.
+     * @param covKernel The variogram model to compute the covariances with.
      * @param kType Kriging type.  If SK, then the matrix has only the covariances between
      *        the samples.  If OK, the matrix has an extra row and column with 1.0s, except
      *        for the last element of both (the last element of matrix), with is zero.
+     * @param covTable Optional table of covariances by IJK offset (see CovarianceTable).  If given, the
+     *        covariances between cells whose offset is in the table are read from it instead of computed.
      */
-    static MatrixNXM<double> makeCovMatrix(std::multiset<GridCell>& samples,
-                                           VariogramModel *variogramModel,
-                                           double variogramSill,
-                                           KrigingType kType = KrigingType::SK
-                                           );
+    static void makeCovMatrix(const NeighborBuffer& samples,
+                              const CovarianceKernel& covKernel,
+                              MatrixNXM<double>& covMatrix,
+                              KrigingType kType = KrigingType::SK,
+                              const CovarianceTable* covTable = nullptr
+                              );
 
     /**
-     * Creates a gamma matrix of the given set of samples against the estimation location cell.
+     * Fills a gamma matrix of the given set of samples against the estimation location cell.
+     * The matrix is resized as needed (see makeCovMatrix()).
      * @param kType Kriging type.  If SK, then the matrix has only the covariances between
      *        the samples and the estimation location.  If OK, the matrix has an extra element == 1.0.
+     * @param covTable Optional table of covariances by IJK offset (see makeCovMatrix()).
      */
-    static MatrixNXM<double> makeGammaMatrix(std::multiset<GridCell>& samples,
-                                             GridCell& estimationLocation,
-                                             VariogramModel *variogramModel,
-                                             KrigingType kType = KrigingType::SK);
-
-    /**
-     *  Returns a list of valued grid cells, ordered by topological proximity to the target cell.
-     */
-    static void getValuedNeighborsTopoOrdered(GridCell &cell,
-                                                            int numberOfSamples,
-                                                            int nColsAround,
-                                                            int nRowsAround,
-                                                            int nSlicesAround,
-                                                            bool hasNDV,
-                                                            double NDV,
-                                                            std::multiset<GridCell>& list);
+    static void makeGammaMatrix(const NeighborBuffer& samples,
+                                const GridCell& estimationLocation,
+                                const CovarianceKernel& covKernel,
+                                MatrixNXM<double>& gammaMatrix,
+                                KrigingType kType = KrigingType::SK,
+                                const CovarianceTable* covTable = nullptr);
 };
 
 #endif // GEOSTATSUTILS_H
@@ -0,0 +1,150 @@
+#include "gridsearchtemplate.h"
+
+#include "boundedcache.h"
+#include "covariancekernel.h"
+#include "gridcell.h"
+#include "neighborbuffer.h"
+#include "domain/variogrammodel.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <tuple>
+
+//maximum number of templates kept for reuse
+#define GRID_SEARCH_TEMPLATE_CACHE_SIZE 16
+
+namespace {
+
+    /** Key of the templates cache. */
+    typedef std::tuple< VariogramModel*, uint, double, double, double, uint, uint, uint, int, int, int > GridSearchTemplateKey;
+
+    BoundedCache< GridSearchTemplateKey, std::shared_ptr<const GridSearchTemplate> > gridSearchTemplates( GRID_SEARCH_TEMPLATE_CACHE_SIZE );
+}
+
+std::shared_ptr<const GridSearchTemplate> GridSearchTemplate::getTemplate(VariogramModel *model,
+                                                                          double dx, double dy, double dz,
+                                                                          uint nI, uint nJ, uint nK,
+                                                                          int maxDi, int maxDj, int maxDk)
+{
+    GridSearchTemplateKey key( model, model->getVersion(), dx, dy, dz, nI, nJ, nK, maxDi, maxDj, maxDk );
+
+    return gridSearchTemplates.get( key, [&](){
+        return std::shared_ptr<const GridSearchTemplate>( new GridSearchTemplate( model, dx, dy, dz,
+                                                                                  nI, nJ, nK,
+                                                                                  maxDi, maxDj, maxDk ) );
+    });
+}
+
+void GridSearchTemplate::clearCache()
+{
+    gridSearchTemplates.clear();
+}
+
+GridSearchTemplate::GridSearchTemplate(VariogramModel *model,
+                                       double dx, double dy, double dz,
+                                       uint nI, uint nJ, uint nK,
+                                       int maxDi, int maxDj, int maxDk) :
+    _dx( dx ), _dy( dy ), _dz( dz ),
+    _nI( nI ), _nJ( nJ ), _nK( nK ),
+    _maxDi( std::max( 0, maxDi ) ),
+    _maxDj( std::max( 0, maxDj ) ),
+    _maxDk( std::max( 0, maxDk ) )
+{
+    //all offsets in the box but the target cell itself
+    std::vector<int> di, dj, dk;
+    std::vector<double> sepX, sepY, sepZ;
+    for( int k = -_maxDk; k <= _maxDk; ++k )
+        for( int j = -_maxDj; j <= _maxDj; ++j )
+            for( int i = -_maxDi; i <= _maxDi; ++i ){
+                if( i == 0 && j == 0 && k == 0 )
+                    continue;
+                di.push_back( i );
+                dj.push_back( j );
+                dk.push_back( k );
+                sepX.push_back( i * dx );
+                sepY.push_back( j * dy );
+                sepZ.push_back( k * dz );
+            }
+    uint n = di.size();
+
+    //the covariances between the target cell and the offsets, evaluated at once
+    std::vector<double> covariances( n );
+    const CovarianceKernel kernel( model );
+    kernel.covariances( sepX.data(), sepY.data(), sepZ.data(), n, covariances.data() );
+
+    //order the offsets by decreasing covariance.  The cells beyond the range of the model have the same
+    //covariance, so they are ordered by distance, then by position for a deterministic template.
+    std::vector<uint> order( n );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), [&]( uint a, uint b ){
+        if( covariances[a] != covariances[b] )
+            return covariances[a] > covariances[b];
+        double distance2a = sepX[a] * sepX[a] + sepY[a] * sepY[a] + sepZ[a] * sepZ[a];
+        double distance2b = sepX[b] * sepX[b] + sepY[b] * sepY[b] + sepZ[b] * sepZ[b];
+        if( distance2a != distance2b )
+            return distance2a < distance2b;
+        return a < b;
+    });
+
+    _di.reserve( n );
+    _dj.reserve( n );
+    _dk.reserve( n );
+    _offsets.reserve( n );
+    _covariances.reserve( n );
+    for( uint index : order ){
+        _di.push_back( di[index] );
+        _dj.push_back( dj[index] );
+        _dk.push_back( dk[index] );
+        _offsets.push_back( di[index] + (std::ptrdiff_t)dj[index] * nI + (std::ptrdiff_t)dk[index] * nI * nJ );
+        _covariances.push_back( covariances[index] );
+    }
+}
+
+void GridSearchTemplate::getValuedNeighbors(const double *values, const GridCell &cell,
+                                            bool hasNDV, double NDV, NeighborBuffer &neighbors) const
+{
+    neighbors.clear();
+    if( neighbors.getCapacity() == 0 )
+        return;
+
+    int i = cell._indexIJK._i;
+    int j = cell._indexIJK._j;
+    int k = cell._indexIJK._k;
+    std::ptrdiff_t centerLine = i + (std::ptrdiff_t)j * _nI + (std::ptrdiff_t)k * _nI * _nJ;
+    const double* center = values + centerLine;
+    bool interior = isInterior( i, j, k );
+
+    uint n = _offsets.size();
+    for( uint iOffset = 0; iOffset < n; ++iOffset ){
+        //only the cells near the grid borders need the bounds check
+        if( ! interior ){
+            int ii = i + _di[iOffset];
+            int jj = j + _dj[iOffset];
+            int kk = k + _dk[iOffset];
+            if( ii < 0 || ii >= (int)_nI || jj < 0 || jj >= (int)_nJ || kk < 0 || kk >= (int)_nK )
+                continue;
+        }
+        double value = center[ _offsets[iOffset] ];
+        //if the cell is valued...
+        if( !hasNDV || !Util::almostEqual2sComplement( NDV, value, 1 ) ){
+            //...it is a valid neighbor.  The offsets are in search order, so the records are appended
+            //already ordered by proximity.
+            NeighborCell& neighbor = neighbors.append();
+            neighbor._indexIJK._i = i + _di[iOffset];
+            neighbor._indexIJK._j = j + _dj[iOffset];
+            neighbor._indexIJK._k = k + _dk[iOffset];
+            neighbor._center._x = cell._center._x + _di[iOffset] * _dx;
+            neighbor._center._y = cell._center._y + _dj[iOffset] * _dy;
+            neighbor._center._z = cell._center._z + _dk[iOffset] * _dz;
+            neighbor._dataLine = centerLine + _offsets[iOffset];
+            neighbor._value = value;
+            neighbor._topoDistance = std::abs( _di[iOffset] ) + std::abs( _dj[iOffset] ) + std::abs( _dk[iOffset] );
+            //if the number of neighbors is reached...
+            if( neighbors.isFull() )
+                //...interrupt the search
+                return;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef GRIDSEARCHTEMPLATE_H
+#define GRIDSEARCHTEMPLATE_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class VariogramModel;
+class GridCell;
+class NeighborBuffer;
+
+/**
+ * The GridSearchTemplate class is a precomputed neighborhood search for the cells of a Cartesian grid, like the
+ * ordered list of cell offsets (ixnode, iynode, iznode) of GSLib's sgsim.  It holds all cell offsets inside a box
+ * of +/-maxDi, +/-maxDj and +/-maxDk cells around a target cell, ordered by decreasing covariance with the target
+ * cell according to a variogram model (ties by increasing distance), so an anisotropic model makes the search
+ * prefer the cells along its major axis.  Each offset is also kept as a linear offset in the grid data array,
+ * thus the search of a cell farther from the grid borders than the box half sizes (see isInterior()) needs
+ * neither bounds checks nor index arithmetic.
+ * Templates are shared: use getTemplate() to get one built once per grid geometry, search box and variogram model.
+ */
+class GridSearchTemplate
+{
+public:
+
+    /**
+     * Returns a template for the given grid and search box, building it if no template for the same model,
+     * grid and box exists.  The model version is part of the key, so editing the model invalidates the
+     * templates made with it.
+     * @param nI, nJ, nK The grid dimensions, which define the linear offsets and the interior cells.
+     * @param maxDi, maxDj, maxDk The half sizes of the search box, in cells.
+     */
+    static std::shared_ptr<const GridSearchTemplate> getTemplate( VariogramModel* model,
+                                                                  double dx, double dy, double dz,
+                                                                  uint nI, uint nJ, uint nK,
+                                                                  int maxDi, int maxDj, int maxDk );
+
+    /** Releases the shared templates. */
+    static void clearCache();
+
+    /** Returns the number of offsets (the cells in the search box but the target cell). */
+    uint size() const { return _offsets.size(); }
+
+    int getDi( uint n ) const { return _di[n]; }
+    int getDj( uint n ) const { return _dj[n]; }
+    int getDk( uint n ) const { return _dk[n]; }
+
+    /** Returns the covariance between the target cell and the cell of an offset. */
+    double getCovariance( uint n ) const { return _covariances[n]; }
+
+    /** Returns whether the whole search box around a cell is inside the grid. */
+    inline bool isInterior( uint i, uint j, uint k ) const {
+        return (int)i >= _maxDi && i + _maxDi < _nI &&
+               (int)j >= _maxDj && j + _maxDj < _nJ &&
+               (int)k >= _maxDk && k + _maxDk < _nK;
+    }
+
+    /**
+     * Fills the given buffer with the valued cells around a cell, in the order of the template.
+     * The search stops when the buffer is full, so its capacity is the maximum number of samples.
+     * @param values The values of the grid cells, with i varying fastest, as in the grid data.
+     */
+    void getValuedNeighbors( const double* values, const GridCell& cell, bool hasNDV, double NDV,
+                             NeighborBuffer& neighbors ) const;
+
+private:
+    GridSearchTemplate( VariogramModel* model, double dx, double dy, double dz,
+                        uint nI, uint nJ, uint nK, int maxDi, int maxDj, int maxDk );
+
+    double _dx, _dy, _dz;
+    uint _nI, _nJ, _nK;
+    int _maxDi, _maxDj, _maxDk;
+
+    /** The offsets in search order, as separate arrays of components. */
+    std::vector<int> _di, _dj, _dk;
+    /** The offsets in the grid data array (di + dj*nI + dk*nI*nJ). */
+    std::vector<std::ptrdiff_t> _offsets;
+    std::vector<double> _covariances;
+};
+
+#endif // GRIDSEARCHTEMPLATE_H
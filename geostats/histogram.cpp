@@ -0,0 +1,329 @@
+#include "histogram.h"
+
+#include "domain/application.h"
+#include "domain/datafile.h"
+#include "util.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//number of fine bins used to derive the histograms, the cdf and the quantiles
+#define HISTOGRAM_FINE_BIN_COUNT 8192
+
+//below this number of values, the data are scanned serially
+#define HISTOGRAM_PARALLEL_THRESHOLD 50000
+
+namespace {
+
+    /** Partial results of the first pass over a chunk of values. */
+    struct MomentsChunk {
+        std::size_t count;
+        double sumOfWeights;
+        double mean;
+        double m2;
+        double min;
+        double max;
+    };
+
+    /** Merges two partial results (Chan et al. pairwise update for weighted moments). */
+    void mergeMoments( MomentsChunk& a, const MomentsChunk& b ){
+        if( b.sumOfWeights <= 0.0 )
+            return;
+        if( a.sumOfWeights <= 0.0 ){
+            a = b;
+            return;
+        }
+        double sumOfWeights = a.sumOfWeights + b.sumOfWeights;
+        double delta = b.mean - a.mean;
+        a.mean += delta * b.sumOfWeights / sumOfWeights;
+        a.m2 += b.m2 + delta * delta * a.sumOfWeights * b.sumOfWeights / sumOfWeights;
+        a.sumOfWeights = sumOfWeights;
+        a.count += b.count;
+        a.min = std::min( a.min, b.min );
+        a.max = std::max( a.max, b.max );
+    }
+
+    /** A [first, last) range of values scanned by one task and its partial results. */
+    struct HistogramChunk {
+        std::size_t first;
+        std::size_t last;
+        MomentsChunk moments;
+        std::vector<double> bins;
+    };
+
+    /** Splits n values among the threads. */
+    std::vector<HistogramChunk> makeChunks( std::size_t n ){
+        std::vector<HistogramChunk> chunks;
+        std::size_t nChunks = 1;
+        if( n >= HISTOGRAM_PARALLEL_THRESHOLD )
+            nChunks = std::max( 1, QThread::idealThreadCount() ) * 2;
+        std::size_t chunkSize = std::max<std::size_t>( 1, ( n + nChunks - 1 ) / nChunks );
+        for( std::size_t first = 0; first < n; first += chunkSize ){
+            HistogramChunk chunk;
+            chunk.first = first;
+            chunk.last = std::min( n, first + chunkSize );
+            chunks.push_back( chunk );
+        }
+        return chunks;
+    }
+}
+
+double HistogramSummary::coefficientOfVariation() const
+{
+    if( Util::almostEqual2sComplement( mean, 0.0, 1 ) )
+        return std::numeric_limits<double>::quiet_NaN();
+    return std::sqrt( variance ) / mean;
+}
+
+Histogram::Histogram() :
+    _binningMin( 0.0 ),
+    _fineBinWidth( 0.0 )
+{
+    _summary = HistogramSummary();
+    _summary.count = 0;
+    _summary.sumOfWeights = 0.0;
+}
+
+/** The getter has the signature bool getter( std::size_t i, double& value, double& weight ) and returns
+ * false for values that must be ignored (no-data, trimmed, non-positive weight, etc.).  It must be
+ * callable from several threads at the same time.
+ */
+template<typename Getter>
+bool Histogram::computeFromGetter(std::size_t n, Getter getter)
+{
+    _summary = HistogramSummary();
+    _summary.count = 0;
+    _summary.sumOfWeights = 0.0;
+    _fineBins.clear();
+
+    std::vector<HistogramChunk> chunks = makeChunks( n );
+
+    //------first pass: extremes and weighted moments (West's incremental algorithm per chunk)------
+    QtConcurrent::blockingMap( chunks, [&getter]( HistogramChunk& chunk ){
+        MomentsChunk& result = chunk.moments;
+        result = { 0, 0.0, 0.0, 0.0,
+                   std::numeric_limits<double>::max(),
+                   -std::numeric_limits<double>::max() };
+        double value, weight;
+        for( std::size_t i = chunk.first; i < chunk.last; ++i ){
+            if( ! getter( i, value, weight ) )
+                continue;
+            ++result.count;
+            result.sumOfWeights += weight;
+            double delta = value - result.mean;
+            result.mean += ( weight / result.sumOfWeights ) * delta;
+            result.m2 += weight * delta * ( value - result.mean );
+            result.min = std::min( result.min, value );
+            result.max = std::max( result.max, value );
+        }
+    });
+    MomentsChunk total = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    for( const HistogramChunk& chunk : chunks )
+        mergeMoments( total, chunk.moments );
+    if( total.count == 0 || total.sumOfWeights <= 0.0 ){
+        Application::instance()->logWarn("Histogram::compute(): no valid data.");
+        return false;
+    }
+
+    //set the fine binning, making sure the range is not empty
+    _binningMin = total.min;
+    double binningMax = total.max;
+    if( binningMax - _binningMin <= 0.0 ){
+        double halfWindow = Util::almostEqual2sComplement( total.min, 0.0, 1 ) ? 0.5 : std::abs( total.min ) / 200.0;
+        _binningMin -= halfWindow;
+        binningMax += halfWindow;
+    }
+    _fineBinWidth = ( binningMax - _binningMin ) / HISTOGRAM_FINE_BIN_COUNT;
+
+    //-------------second pass: accumulate the weights in the fine bins (one set of bins per chunk)-------------
+    double binningMin = _binningMin;
+    double fineBinWidth = _fineBinWidth;
+    QtConcurrent::blockingMap( chunks, [&getter, binningMin, fineBinWidth]( HistogramChunk& chunk ){
+        chunk.bins.assign( HISTOGRAM_FINE_BIN_COUNT, 0.0 );
+        double value, weight;
+        for( std::size_t i = chunk.first; i < chunk.last; ++i ){
+            if( ! getter( i, value, weight ) )
+                continue;
+            long iBin = (long)( ( value - binningMin ) / fineBinWidth );
+            iBin = std::min<long>( HISTOGRAM_FINE_BIN_COUNT - 1, std::max<long>( 0, iBin ) );
+            chunk.bins[iBin] += weight;
+        }
+    });
+    _fineBins.assign( HISTOGRAM_FINE_BIN_COUNT, 0.0 );
+    for( const HistogramChunk& chunk : chunks )
+        for( std::size_t iBin = 0; iBin < HISTOGRAM_FINE_BIN_COUNT; ++iBin )
+            _fineBins[iBin] += chunk.bins[iBin];
+
+    //fill the summary
+    _summary.count = total.count;
+    _summary.sumOfWeights = total.sumOfWeights;
+    _summary.min = total.min;
+    _summary.max = total.max;
+    _summary.mean = total.mean;
+    _summary.variance = total.m2 / total.sumOfWeights;
+    _summary.p10 = getQuantile( 0.10 );
+    _summary.lowerQuartile = getQuantile( 0.25 );
+    _summary.median = getQuantile( 0.50 );
+    _summary.upperQuartile = getQuantile( 0.75 );
+    _summary.p90 = getQuantile( 0.90 );
+    return true;
+}
+
+bool Histogram::compute(const std::vector<double> &values, const std::vector<double> &weights,
+                        double tmin, double tmax, bool hasNDV, double NDV)
+{
+    bool useWeights = ! weights.empty();
+    if( useWeights && weights.size() != values.size() ){
+        Application::instance()->logError("Histogram::compute(): number of weights differs from number of values.");
+        return false;
+    }
+    const double* pValues = values.data();
+    const double* pWeights = weights.data();
+    return computeFromGetter( values.size(),
+        [=]( std::size_t i, double& value, double& weight ){
+            value = pValues[i];
+            if( value < tmin || value > tmax || std::isnan( value ) )
+                return false;
+            if( hasNDV && Util::almostEqual2sComplement( value, NDV, 1 ) )
+                return false;
+            weight = useWeights ? pWeights[i] : 1.0;
+            return weight > 0.0;
+        });
+}
+
+bool Histogram::compute(DataFile *dataFile, uint column, int weightColumn, double tmin, double tmax,
+                        long firstLine, long lastLine)
+{
+    //the data must be in memory before the parallel scan (the lazy load in data() is not thread-safe)
+    dataFile->loadData();
+    long nLines = dataFile->getDataLineCount();
+    if( lastLine < 0 || lastLine >= nLines )
+        lastLine = nLines - 1;
+    if( firstLine > lastLine ){
+        Application::instance()->logError("Histogram::compute(): empty data line interval.");
+        return false;
+    }
+    bool hasNDV = dataFile->hasNoDataValue();
+    double NDV = dataFile->getNoDataValueAsDouble();
+    return computeFromGetter( lastLine - firstLine + 1,
+        [=]( std::size_t i, double& value, double& weight ){
+            long line = firstLine + i;
+            value = dataFile->data( line, column );
+            if( value < tmin || value > tmax || std::isnan( value ) || ( hasNDV && Util::almostEqual2sComplement( value, NDV, 1 ) ) )
+                return false;
+            weight = 1.0;
+            if( weightColumn >= 0 ){
+                weight = dataFile->data( line, weightColumn );
+                if( hasNDV && Util::almostEqual2sComplement( weight, NDV, 1 ) )
+                    return false;
+            }
+            return weight > 0.0;
+        });
+}
+
+bool Histogram::computeFromGEOEASFile(const QString path, uint varIndex, uint wgtIndex, double tmin, double tmax)
+{
+    QFile file( path );
+    if( varIndex == 0 || ! file.open( QFile::ReadOnly | QFile::Text ) ){
+        Application::instance()->logError("Histogram::computeFromGEOEASFile(): could not read " + path);
+        return false;
+    }
+    uint headerLineCount = Util::getHeaderLineCount( path );
+    std::vector<double> values;
+    std::vector<double> weights;
+    QTextStream in( &file );
+    for( uint i = 0; ! in.atEnd(); ++i ){
+        QString line = in.readLine();
+        if( i < headerLineCount )
+            continue;
+        QStringList tokens = Util::fastSplit( line );
+        if( (uint)tokens.size() < std::max( varIndex, wgtIndex ) )
+            continue;
+        values.push_back( tokens[varIndex-1].toDouble() );
+        if( wgtIndex > 0 )
+            weights.push_back( tokens[wgtIndex-1].toDouble() );
+    }
+    file.close();
+    return compute( values, weights, tmin, tmax );
+}
+
+void Histogram::getClasses(uint nClasses, std::vector<double> &classStarts, double &classWidth,
+                           std::vector<double> &frequencies) const
+{
+    classStarts.clear();
+    frequencies.clear();
+    classWidth = 0.0;
+    if( isEmpty() || nClasses == 0 )
+        return;
+    classWidth = _fineBinWidth * HISTOGRAM_FINE_BIN_COUNT / nClasses;
+    classStarts.reserve( nClasses );
+    for( uint iClass = 0; iClass < nClasses; ++iClass )
+        classStarts.push_back( _binningMin + iClass * classWidth );
+    //each fine bin goes to the class containing its center
+    frequencies.assign( nClasses, 0.0 );
+    for( std::size_t iBin = 0; iBin < _fineBins.size(); ++iBin ){
+        if( _fineBins[iBin] <= 0.0 )
+            continue;
+        double center = ( iBin + 0.5 ) * _fineBinWidth;
+        uint iClass = std::min<uint>( nClasses - 1, (uint)( center / classWidth ) );
+        frequencies[iClass] += _fineBins[iBin] / _summary.sumOfWeights;
+    }
+}
+
+void Histogram::getCDF(std::vector<double> &values, std::vector<double> &probabilities) const
+{
+    values.clear();
+    probabilities.clear();
+    double cumulative = 0.0;
+    for( std::size_t iBin = 0; iBin < _fineBins.size(); ++iBin ){
+        if( _fineBins[iBin] <= 0.0 )
+            continue;
+        cumulative += _fineBins[iBin];
+        values.push_back( std::min( _summary.max, _binningMin + ( iBin + 1 ) * _fineBinWidth ) );
+        probabilities.push_back( cumulative / _summary.sumOfWeights );
+    }
+}
+
+double Histogram::getQuantile(double p) const
+{
+    if( isEmpty() )
+        return std::numeric_limits<double>::quiet_NaN();
+    double target = std::min( 1.0, std::max( 0.0, p ) ) * _summary.sumOfWeights;
+    double cumulative = 0.0;
+    for( std::size_t iBin = 0; iBin < _fineBins.size(); ++iBin ){
+        double binWeight = _fineBins[iBin];
+        if( binWeight > 0.0 && cumulative + binWeight >= target ){
+            //interpolate linearly within the bin
+            double fraction = ( target - cumulative ) / binWeight;
+            double value = _binningMin + ( iBin + fraction ) * _fineBinWidth;
+            return std::min( _summary.max, std::max( _summary.min, value ) );
+        }
+        cumulative += binWeight;
+    }
+    return _summary.max;
+}
+
+QString Histogram::getSummaryText() const
+{
+    if( isEmpty() )
+        return "No data.";
+    QString text;
+    text += "Number of data: " + QString::number( _summary.count ) + "\n";
+    text += "Sum of weights: " + QString::number( _summary.sumOfWeights ) + "\n";
+    text += "Mean: " + QString::number( _summary.mean ) + "\n";
+    text += "Std. dev.: " + QString::number( std::sqrt( _summary.variance ) ) + "\n";
+    text += "Coef. of var.: " + QString::number( _summary.coefficientOfVariation() ) + "\n";
+    text += "Maximum: " + QString::number( _summary.max ) + "\n";
+    text += "P90: " + QString::number( _summary.p90 ) + "\n";
+    text += "Upper quartile: " + QString::number( _summary.upperQuartile ) + "\n";
+    text += "Median: " + QString::number( _summary.median ) + "\n";
+    text += "Lower quartile: " + QString::number( _summary.lowerQuartile ) + "\n";
+    text += "P10: " + QString::number( _summary.p10 ) + "\n";
+    text += "Minimum: " + QString::number( _summary.min );
+    return text;
+}
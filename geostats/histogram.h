@@ -0,0 +1,107 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <vector>
+#include <cstddef>
+#include <QString>
+
+class DataFile;
+
+/** Summary statistics of a weighted univariate distribution. */
+struct HistogramSummary {
+    std::size_t count;   //!< Number of values within the trimming limits.
+    double sumOfWeights; //!< Sum of the weights of the values within the trimming limits.
+    double min;
+    double max;
+    double mean;         //!< Weighted mean.
+    double variance;     //!< Weighted variance.
+    double p10;          //!< Quantiles are interpolated from the fine bins (see Histogram).
+    double lowerQuartile;
+    double median;
+    double upperQuartile;
+    double p90;
+    /** Returns the coefficient of variation (standard deviation over mean). */
+    double coefficientOfVariation() const;
+};
+
+/**
+ * The Histogram class computes weighted histograms, cumulative distributions and summary statistics
+ * in-process, as a replacement of histplt runs.  The values are scanned in parallel chunks: a first
+ * pass gets the extremes and moments and a second pass counts the weights into a large number of fine
+ * bins.  The histograms with any number of classes, the cdf and the quantiles are then derived from the
+ * fine bins without touching the data again, so changing the number of classes is instantaneous.
+ */
+class Histogram
+{
+public:
+    Histogram();
+
+    /**
+     * Computes the histogram.
+     * @param weights Declustering weights.  If empty, all values have the same weight.
+     * @param hasNDV If true, values equal to NDV are ignored.
+     */
+    bool compute( const std::vector<double>& values,
+                  const std::vector<double>& weights,
+                  double tmin, double tmax,
+                  bool hasNDV = false, double NDV = -999.0 );
+
+    /**
+     * Computes the histogram of a data column of a data file (the data are loaded with loadData() if necessary).
+     * @param column Data column index (first == 0).
+     * @param weightColumn Weight column index (first == 0) or -1 for no weights.
+     * @param tmin, tmax Trimming limits: values outside them are ignored, as in histplt.
+     * @param firstLine First data line to consider.
+     * @param lastLine Last data line to consider (inclusive) or -1 for all lines.
+     */
+    bool compute( DataFile* dataFile, uint column, int weightColumn,
+                  double tmin, double tmax,
+                  long firstLine = 0, long lastLine = -1 );
+
+    /**
+     * Computes the histogram of columns read directly from a GEO-EAS file (e.g. a reference distribution).
+     * @param varIndex GEO-EAS index (first == 1) of the variable.
+     * @param wgtIndex GEO-EAS index (first == 1) of the weight or zero for no weights.
+     */
+    bool computeFromGEOEASFile( const QString path, uint varIndex, uint wgtIndex,
+                                double tmin, double tmax );
+
+    /** Returns whether there are data in the histogram. */
+    bool isEmpty() const { return _summary.count == 0; }
+
+    /** Returns the summary statistics. */
+    const HistogramSummary& getSummary() const { return _summary; }
+
+    /**
+     * Makes a histogram with the given number of classes spanning the data range.
+     * @param classStarts Returns the lower limit of each class.
+     * @param classWidth Returns the width of the classes.
+     * @param frequencies Returns the relative frequency (weight fraction) of each class.
+     */
+    void getClasses( uint nClasses, std::vector<double>& classStarts, double& classWidth,
+                     std::vector<double>& frequencies ) const;
+
+    /** Returns the cdf as pairs of values and cumulative probabilities (one pair per non-empty fine bin). */
+    void getCDF( std::vector<double>& values, std::vector<double>& probabilities ) const;
+
+    /** Returns the quantile for the given cumulative probability (0.0 to 1.0). */
+    double getQuantile( double p ) const;
+
+    /** Returns a text with the summary statistics (similar to the histplt summary). */
+    QString getSummaryText() const;
+
+private:
+    HistogramSummary _summary;
+    /** The weights accumulated in the fine bins. */
+    std::vector<double> _fineBins;
+    /** Lower limit of the first fine bin. */
+    double _binningMin;
+    /** Width of the fine bins. */
+    double _fineBinWidth;
+
+    /** Sets the summary and fine bins from the values returned by the getter.  See the .cpp for details. */
+    template<typename Getter>
+    bool computeFromGetter( std::size_t n, Getter getter );
+};
+
+#endif // HISTOGRAM_H
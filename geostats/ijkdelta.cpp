@@ -1,9 +0,0 @@
-#include "ijkdelta.h"
-#include "ijkindex.h"
-
-IJKDelta::IJKDelta(int di, int dj, int dk) :
-    _di(di), _dj(dj), _dk(dk)
-{
-}
-
-
@@ -0,0 +1,190 @@
+#include "krigingsolver.h"
+
+namespace {
+
+    /** Dot product of two arrays of n elements.  The four partial sums break the dependency chain of the
+     * additions, so the compiler can vectorize the loop. */
+    inline double dot( const double* a, const double* b, unsigned int n ){
+        double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+        unsigned int k = 0;
+        for( ; k + 4 <= n; k += 4 ){
+            sum0 += a[k] * b[k];
+            sum1 += a[k+1] * b[k+1];
+            sum2 += a[k+2] * b[k+2];
+            sum3 += a[k+3] * b[k+3];
+        }
+        for( ; k < n; ++k )
+            sum0 += a[k] * b[k];
+        return ( sum0 + sum1 ) + ( sum2 + sum3 );
+    }
+}
+
+KrigingSolver::KrigingSolver() :
+    _n( 0 ),
+    _sumInvCOnes( 0.0 ),
+    _hasInvCOnes( false )
+{
+}
+
+bool KrigingSolver::factorize(const MatrixNXM<double> &covMatrix)
+{
+    const unsigned int n = covMatrix.getN();
+    _n = n;
+    _L.assign( n * n, 0.0 );
+    _D.assign( n, 0.0 );
+    _hasInvCOnes = false;
+    //work vector with L(j,k)*D(k) of the current column j (its storage is kept between factorizations)
+    _work.resize( n );
+
+    switch( n ){
+    case 8:  return factorize<8>( covMatrix );
+    case 16: return factorize<16>( covMatrix );
+    case 32: return factorize<32>( covMatrix );
+    case 64: return factorize<64>( covMatrix );
+    default: return factorize<0>( covMatrix );
+    }
+}
+
+template <unsigned int N>
+bool KrigingSolver::factorize(const MatrixNXM<double> &covMatrix)
+{
+    const unsigned int n = N ? N : _n;
+    double* L = _L.data();
+    double* D = _D.data();
+    double* ld = _work.data();
+    for( unsigned int j = 0; j < n; ++j ){
+        const double* Lj = L + j * n;
+        for( unsigned int k = 0; k < j; ++k )
+            ld[k] = Lj[k] * D[k];
+        double d = covMatrix( j, j ) - dot( Lj, ld, j );
+        //a non-positive pivot means the matrix is not positive definite (or is numerically singular)
+        if( ! ( d > 1.0e-12 * covMatrix( j, j ) ) || ! ( d > 0.0 ) ){
+            _n = 0;
+            return false;
+        }
+        D[j] = d;
+        L[ j * n + j ] = 1.0;
+        for( unsigned int i = j + 1; i < n; ++i ){
+            double* Li = L + i * n;
+            Li[j] = ( covMatrix( i, j ) - dot( Li, ld, j ) ) / d;
+        }
+    }
+    return true;
+}
+
+void KrigingSolver::solve(std::vector<double> &b) const
+{
+    switch( _n ){
+    case 8:  solve<8>( b.data() ); break;
+    case 16: solve<16>( b.data() ); break;
+    case 32: solve<32>( b.data() ); break;
+    case 64: solve<64>( b.data() ); break;
+    default: solve<0>( b.data() );
+    }
+}
+
+template <unsigned int N>
+void KrigingSolver::solve(double *b) const
+{
+    const unsigned int n = N ? N : _n;
+    const double* L = _L.data();
+    //forward substitution: L y = b
+    for( unsigned int i = 1; i < n; ++i )
+        b[i] -= dot( L + i * n, b, i );
+    //diagonal: D z = y
+    for( unsigned int i = 0; i < n; ++i )
+        b[i] /= _D[i];
+    //backward substitution: L^T x = z.  Each x(i) is final once the rows below are done, so it is taken
+    //out of the rows above with row i of L, which is contiguous (column i of L is not).
+    for( unsigned int i = n; i-- > 1; ){
+        const double* Li = L + i * n;
+        const double xi = b[i];
+        for( unsigned int k = 0; k < i; ++k )
+            b[k] -= Li[k] * xi;
+    }
+}
+
+void KrigingSolver::solve(MatrixNXM<double> &b) const
+{
+    const unsigned int n = _n;
+    const unsigned int m = b.getM();
+    //same as the single right-hand side version, with the inner loops over the columns of b
+    for( unsigned int i = 1; i < n; ++i )
+        for( unsigned int k = 0; k < i; ++k ){
+            double Lik = _L[ i * n + k ];
+            for( unsigned int c = 0; c < m; ++c )
+                b( i, c ) -= Lik * b( k, c );
+        }
+    for( unsigned int i = 0; i < n; ++i ){
+        double invD = 1.0 / _D[i];
+        for( unsigned int c = 0; c < m; ++c )
+            b( i, c ) *= invD;
+    }
+    for( int i = (int)n - 1; i >= 0; --i )
+        for( unsigned int k = i + 1; k < n; ++k ){
+            double Lki = _L[ k * n + i ];
+            for( unsigned int c = 0; c < m; ++c )
+                b( i, c ) -= Lki * b( k, c );
+        }
+}
+
+void KrigingSolver::getInverseDiagonal(std::vector<double> &diagonal) const
+{
+    const unsigned int n = _n;
+    diagonal.assign( n, 0.0 );
+    //C^-1 = L^-T D^-1 L^-1, so (C^-1)_ii = sum_k (L^-1)_ki^2 / D_k, where column i of L^-1 is the solution
+    //of L y = e_i, which is zero above row i
+    std::vector<double> y( n );
+    for( unsigned int i = 0; i < n; ++i ){
+        y[i] = 1.0;
+        double sum = 1.0 / _D[i];
+        for( unsigned int k = i + 1; k < n; ++k ){
+            double value = - dot( &_L[ k * n + i ], &y[i], k - i );
+            y[k] = value;
+            sum += value * value / _D[k];
+        }
+        diagonal[i] = sum;
+    }
+}
+
+void KrigingSolver::solveSK(const std::vector<double> &covariances, double sill,
+                            std::vector<double> &weights, double &variance) const
+{
+    weights = covariances;
+    solve( weights );
+    //the SK variance: C(0) - w^T c
+    variance = sill;
+    for( unsigned int i = 0; i < _n; ++i )
+        variance -= weights[i] * covariances[i];
+}
+
+void KrigingSolver::solveOK(const std::vector<double> &covariances, double sill,
+                            std::vector<double> &weights, double &lagrangian, double &variance)
+{
+    if( ! _hasInvCOnes ){
+        _invCOnes.assign( _n, 1.0 );
+        solve( _invCOnes );
+        _sumInvCOnes = 0.0;
+        for( unsigned int i = 0; i < _n; ++i )
+            _sumInvCOnes += _invCOnes[i];
+        _hasInvCOnes = true;
+    }
+
+    //the SK weights
+    weights = covariances;
+    solve( weights );
+    double sumWeightsSK = 0.0;
+    for( unsigned int i = 0; i < _n; ++i )
+        sumWeightsSK += weights[i];
+
+    //the OK system is C w + mu 1 = c with sum(w) = 1, so w = C^-1 c - mu C^-1 1
+    //and mu = ( 1^T C^-1 c - 1 ) / ( 1^T C^-1 1 )
+    lagrangian = ( sumWeightsSK - 1.0 ) / _sumInvCOnes;
+    for( unsigned int i = 0; i < _n; ++i )
+        weights[i] -= lagrangian * _invCOnes[i];
+
+    //the OK variance: C(0) - w^T c - mu
+    variance = sill - lagrangian;
+    for( unsigned int i = 0; i < _n; ++i )
+        variance -= weights[i] * covariances[i];
+}
@@ -0,0 +1,83 @@
+#ifndef KRIGINGSOLVER_H
+#define KRIGINGSOLVER_H
+
+#include <vector>
+#include "matrixmxn.h"
+
+/**
+ * The KrigingSolver class solves kriging systems by factorizing the (symmetric positive definite) covariance
+ * matrix between the samples once, as C = LDL^T, instead of inverting it.  The factorization costs about n^3/6
+ * multiply-adds against the n^3 of a Gauss-Jordan inversion and each right-hand side then costs only 2n^2.
+ * Ordinary kriging does not need a second (bordered) matrix: its weights are obtained from the SK system
+ * via the Schur complement of the border of ones, w_OK = C^-1 c - mu * C^-1 1, where C^-1 1 is solved once
+ * per factorization and shared by all right-hand sides.  The storage is reused by the next factorizations,
+ * so a solver kept for many estimations does not allocate memory unless the systems grow.
+ * The factorization and the substitutions run over contiguous rows of the factor (dot products and
+ * row updates the compiler can vectorize) and are compiled separately for the common kriging neighborhood
+ * sizes (8, 16, 32 and 64 samples), so their loop bounds and row strides are constants.
+ */
+class KrigingSolver
+{
+public:
+    KrigingSolver();
+
+    /**
+     * Factorizes the covariance matrix between the samples.
+     * Returns false if the matrix is not positive definite (e.g. there are duplicate samples).
+     */
+    bool factorize( const MatrixNXM<double>& covMatrix );
+
+    /** Returns the number of samples of the factorized system. */
+    unsigned int getSize() const { return _n; }
+
+    /** Solves C x = b, overwriting b with x. */
+    void solve( std::vector<double>& b ) const;
+
+    /** Solves C X = B for all columns of B at once, overwriting B with X. */
+    void solve( MatrixNXM<double>& b ) const;
+
+    /**
+     * Computes the diagonal of the inverse of the factorized matrix without forming the inverse.
+     * Used by the leave-one-out cross-validation shortcut (see CrossValidation).
+     */
+    void getInverseDiagonal( std::vector<double>& diagonal ) const;
+
+    /**
+     * Computes simple kriging weights and variance.
+     * @param covariances The covariances between the samples and the estimation location.
+     * @param sill The variance (covariance at the origin) of the variable.
+     */
+    void solveSK( const std::vector<double>& covariances, double sill,
+                  std::vector<double>& weights, double& variance ) const;
+
+    /**
+     * Computes ordinary kriging weights, Lagrange multiplier and variance.
+     * @param covariances The covariances between the samples and the estimation location.
+     * @param sill The variance (covariance at the origin) of the variable.
+     */
+    void solveOK( const std::vector<double>& covariances, double sill,
+                  std::vector<double>& weights, double& lagrangian, double& variance );
+
+private:
+    /** The factorization and the substitutions of a system of N samples.  N == 0 means a size only known at run time. */
+    //@{
+    template <unsigned int N>
+    bool factorize( const MatrixNXM<double>& covMatrix );
+    template <unsigned int N>
+    void solve( double* b ) const;
+    //@}
+
+    unsigned int _n;
+    /** The unit lower triangular factor (row-major, only the lower triangle is used). */
+    std::vector<double> _L;
+    /** The diagonal factor. */
+    std::vector<double> _D;
+    /** Work vector of factorize(). */
+    std::vector<double> _work;
+    /** C^-1 1 and its sum, used by ordinary kriging.  They are computed on demand once per factorization. */
+    std::vector<double> _invCOnes;
+    double _sumInvCOnes;
+    bool _hasInvCOnes;
+};
+
+#endif // KRIGINGSOLVER_H
@@ -15,10 +15,19 @@ public:
     MatrixNXM(unsigned int n, unsigned int m, T initValue = 0.0 );
 
     /** Returns the number of rows. */
-    T getN(){ return _n; }
+    unsigned int getN() const { return _n; }
 
     /** Returns the number of columns. */
-    T getM(){ return _m; }
+    unsigned int getM() const { return _m; }
+
+    /** Changes the matrix dimensions and sets all elements to a value.
+     * The storage is reused, so no memory is allocated unless the matrix grows.
+     */
+    void resize( unsigned int n, unsigned int m, T initValue = 0.0 ){
+        _n = n;
+        _m = m;
+        _values.assign( n*m, initValue );
+    }
 
     /** Operator () for l-value element access: e.g.: a(1,2) = 20.0; .
      * Due to performance concern, no range check is performed.
@@ -35,7 +44,7 @@ public:
     }
 
     /** Matrix multiplication operator. It is assumed the operands are compatible (this._m == b._n).*/
-    MatrixNXM<T> operator*(const MatrixNXM<T>& b);
+    MatrixNXM<T> operator*(const MatrixNXM<T>& b) const;
 
     /** Inverts this matrix. It is assumed that the matrix is square, no check in this regard is performed, though
      * there is a check for singularity (prints a message and aborts calculation.)
@@ -119,8 +128,8 @@ void MatrixNXM<T>::invert(){
 
 //TODO: naive matrix multiplication, improve performance (e.g. parallel)
 template <typename T>
-MatrixNXM<T> MatrixNXM<T>::operator*(const MatrixNXM<T>& b) {
-   MatrixNXM<T>& a = *this;
+MatrixNXM<T> MatrixNXM<T>::operator*(const MatrixNXM<T>& b) const {
+   const MatrixNXM<T>& a = *this;
    MatrixNXM<T> result( a._n, b._m );
    for(uint i = 0; i < a._n; ++i)
        for(uint j = 0; j < b._m; ++j)
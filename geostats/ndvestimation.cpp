@@ -4,12 +4,14 @@
 #include "domain/attribute.h"
 #include "gridcell.h"
 #include "ndvestimationrunner.h"
+#include "util.h"
 #include <limits>
+#include <memory>
 #include <QProgressDialog>
 #include <QtConcurrent/QtConcurrent>
 
 NDVEstimation::NDVEstimation(Attribute *at) :
-    _at(at),
+    _ats(1, at),
     _searchMaxNumSamples(16),
     _searchNumCols(10),
     _searchNumRows(10),
@@ -31,8 +33,15 @@ std::vector<double> NDVEstimation::run()
         _vmodel->readFromFS();
     }
 
+    _results.clear();
+
     //Assumes the partent file of the selected attribut is a Cartesian grid
-    CartesianGrid *cg = (CartesianGrid*)_at->getContainingFile();
+    CartesianGrid *cg = (CartesianGrid*)_ats[0]->getContainingFile();
+    for( Attribute* at : _ats )
+        if( at->getContainingFile() != cg ){
+            Application::instance()->logError("NDVEstimation::run(): all variables must belong to the same grid. Aborted.");
+            return std::vector<double>();
+        }
 
     if( ! cg->hasNoDataValue() ){
         Application::instance()->logError("NDVEstimation::run(): No-data-value not set for the grid. Aborted.");
@@ -61,20 +70,26 @@ std::vector<double> NDVEstimation::run()
     Application::instance()->logErrorOff();
 
     //estimation takes place in another thread, so we can show and update a progress bar
+    //(there is no progress bar in headless mode)
     //////////////////////////////////
-    QProgressDialog progressDialog;
-    progressDialog.show();
-    progressDialog.setLabelText("Running estimation...");
-    progressDialog.setMinimum( 0 );
-    progressDialog.setValue( 0 );
-    progressDialog.setMaximum( nI * nJ * nK );
+    std::unique_ptr<QProgressDialog> progressDialog;
+    if( ! Application::instance()->isHeadless() ){
+        progressDialog.reset( new QProgressDialog() );
+        progressDialog->show();
+        progressDialog->setLabelText("Running estimation...");
+        progressDialog->setMinimum( 0 );
+        progressDialog->setValue( 0 );
+        progressDialog->setMaximum( nI * nJ * nK );
+    }
     QThread* thread = new QThread();
-    NDVEstimationRunner* runner = new NDVEstimationRunner( this, _at ); // Do not set a parent. The object cannot be moved if it has a parent.
+    NDVEstimationRunner* runner = new NDVEstimationRunner( this, _ats ); // Do not set a parent. The object cannot be moved if it has a parent.
     runner->moveToThread(thread);
     runner->connect(thread, SIGNAL(finished()), runner, SLOT(deleteLater()));
     runner->connect(thread, SIGNAL(started()), runner, SLOT(doRun()));
-    runner->connect(runner, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)));
-    runner->connect(runner, SIGNAL(setLabel(QString)), &progressDialog, SLOT(setLabelText(QString)));
+    if( progressDialog ){
+        runner->connect(runner, SIGNAL(progress(int)), progressDialog.get(), SLOT(setValue(int)));
+        runner->connect(runner, SIGNAL(setLabel(QString)), progressDialog.get(), SLOT(setLabelText(QString)));
+    }
     thread->start();
     /////////////////////////////////
 
@@ -88,13 +103,51 @@ std::vector<double> NDVEstimation::run()
     Application::instance()->logWarningOn();
     Application::instance()->logErrorOn();
 
-    std::vector<double> results = runner->getResults();
+    _results = runner->getResults();
+
+    //the kriging failures are reported here, once, instead of by the estimation threads
+    if( runner->getFailedCount() > 0 )
+        Application::instance()->logError("NDVEstimation::run(): " + QString::number( runner->getFailedCount() ) +
+                                          " cells not estimated because their covariance matrices are not positive definite."
+                                          "  Check the variogram model.");
+
+    //report how many kriging systems were spared by reusing the weights of cells with the same neighbor offsets
+    uint nKriging = runner->getKrigingCount();
+    uint nReused = runner->getReusedWeightsCount();
+    double reusedPercent = nKriging > 0 ? 100.0 * nReused / nKriging : 0.0;
+    Application::instance()->logInfo("NDV Estimation: " + QString::number( nKriging ) + " cells kriged, " +
+                                     QString::number( nReused ) + " (" + QString::number( reusedPercent, 'f', 1 ) +
+                                     "%) with reused kriging weights.");
 
     delete runner;
 
     Application::instance()->logInfo("NDV Estimation completed.");
 
-    return results;
+    return _results[0];
+}
+
+bool NDVEstimation::writeToFile(const QString path)
+{
+    if( _results.empty() ){
+        Application::instance()->logError("NDVEstimation::writeToFile(): there are no results to write.");
+        return false;
+    }
+
+    if( _results.size() == 1 ){
+        Util::createGEOEASGrid( _ats[0]->getName(), _results[0], path );
+        return true;
+    }
+
+    //the grid file has one data line per cell with the estimates of all attributes
+    std::vector<QString> columnNames;
+    for( Attribute* at : _ats )
+        columnNames.push_back( at->getName() );
+    std::vector< std::vector<double> > array( _results[0].size(), std::vector<double>( _results.size() ) );
+    for( uint iAttribute = 0; iAttribute < _results.size(); ++iAttribute )
+        for( uint cellIndex = 0; cellIndex < _results[iAttribute].size(); ++cellIndex )
+            array[cellIndex][iAttribute] = _results[iAttribute][cellIndex];
+    Util::createGEOEASGridFile( "Grid file", columnNames, array, path );
+    return true;
 }
 
 void NDVEstimation::setSearchParameters(int searchMaxNumSamples,
@@ -1,6 +1,7 @@
 #ifndef NDVESTIMATION_H
 #define NDVESTIMATION_H
 
+#include <QString>
 #include <vector>
 #include "geostatsutils.h"
 
@@ -10,15 +11,37 @@ class VariogramModel;
 
 /** This class encpsulates the estimation of unvalued cells of an Attribute in a Cartesian grid,
  * a tailored kriging operation.
+ * Other attributes of the same grid can be estimated in the same run with the same parameters (see addAttribute()).
+ * The attributes valued in the same cells (e.g. co-located assays) share the neighborhood searches and the
+ * kriging systems: the weights are computed once per cell and applied to all of them.
  */
 class NDVEstimation
 {
 public:
     NDVEstimation( Attribute* at );
 
-    /** Preforms the kriging. Make sure all parameters have been set properly .*/
+    /**
+     * Adds another attribute of the same grid to be estimated in the same run.  The search parameters,
+     * the variogram model, the SK mean and the default value apply to all attributes, so simple kriging of
+     * several attributes makes sense only if they have the same mean (ordinary kriging does not need it).
+     */
+    void addAttribute( Attribute* at ){ _ats.push_back( at ); }
+
+    /** Returns the attributes to estimate, the one given in the constructor first. */
+    const std::vector<Attribute*>& getAttributes() const { return _ats; }
+
+    /** Preforms the kriging. Make sure all parameters have been set properly.
+     * Returns the estimates of the first attribute (see getResults() for the others) or an empty
+     * vector if the estimation failed.
+     */
     std::vector<double> run();
 
+    /** Returns the estimates of all attributes of the last run, in the order of getAttributes(). */
+    const std::vector< std::vector<double> >& getResults() const { return _results; }
+
+    /** Writes the estimates of the last run as a GEO-EAS grid file with one column per attribute. */
+    bool writeToFile( const QString path );
+
     void setSearchParameters(int searchMaxNumSamples,
                              int searchNumCols,
                              int searchNumRows,
@@ -54,7 +77,7 @@ public:
     void setKtype(const KrigingType &ktype);
 
 private:
-    Attribute *_at;
+    std::vector<Attribute*> _ats;
     int _searchMaxNumSamples;
     int _searchNumCols;
     int _searchNumRows;
@@ -71,6 +94,8 @@ private:
     double _ndv;
 
     KrigingType _ktype;
+
+    std::vector< std::vector<double> > _results;
 };
 
 #endif // NDVESTIMATION_H
@@ -5,110 +5,249 @@
 #include "gridcell.h"
 #include "geostatsutils.h"
 #include "ndvestimation.h"
+#include "krigingsolver.h"
+#include "covariancekernel.h"
+#include "covariancetable.h"
+#include "gridsearchtemplate.h"
 #include "util.h"
 
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <atomic>
+#include <functional>
+
+/** Number of cells in a block of the parallel estimation. */
+#define NDV_BLOCK_SIZE 1024
+
+/** Maximum number of kriging weights kept by each estimation thread for reuse. */
+#define NDV_WEIGHTS_CACHE_SIZE 4096
+
 enum class FlagState : char {
     NOT_SET = 0,
-    TO_SET,
     SET
 };
 
+namespace {
+
+    /** Returns whether a cell value is not the no-data-value. */
+    inline bool isValued( double value, bool hasNDV, double NDV ){
+        return !hasNDV || !Util::almostEqual2sComplement( NDV, value, 1 );
+    }
+
+    /**
+     * Dilates the flags of a line of cells (first, first + stride, ...): a cell is flagged if there is a flagged cell
+     * at most radius cells away in the line.  Two scans find the distances to the nearest flagged cell before and
+     * after each cell, so the cost does not depend on the radius.
+     * @param work A work vector with room for n elements.
+     */
+    void dilateLine( FlagState* first, uint stride, uint n, int radius, std::vector<FlagState>& work ){
+        //the nearest flagged cell before or at each cell
+        int lastSet = - radius - 1;
+        for( uint x = 0; x < n; ++x ){
+            if( first[ x * stride ] == FlagState::SET )
+                lastSet = x;
+            work[x] = ( (int)x - lastSet <= radius ) ? FlagState::SET : FlagState::NOT_SET;
+        }
+        //the nearest flagged cell after or at each cell
+        int nextSet = (int)n + radius + 1;
+        for( int x = (int)n - 1; x >= 0; --x ){
+            if( first[ x * stride ] == FlagState::SET )
+                nextSet = x;
+            if( nextSet - x <= radius )
+                work[x] = FlagState::SET;
+        }
+        for( uint x = 0; x < n; ++x )
+            first[ x * stride ] = work[x];
+    }
+}
+
 
-NDVEstimationRunner::NDVEstimationRunner(NDVEstimation *ndvEstimation, Attribute *at, QObject *parent) :
+NDVEstimationRunner::NDVEstimationRunner(NDVEstimation *ndvEstimation, const std::vector<Attribute *> &ats, QObject *parent) :
     QObject(parent),
     _finished( false ),
-    _at(at),
-    _ndvEstimation(ndvEstimation)
+    _ats(ats),
+    _ndvEstimation(ndvEstimation),
+    _nKriging( 0 ),
+    _nReused( 0 ),
+    _nFailed( 0 )
 {
 }
 
 void NDVEstimationRunner::doRun()
 {
-    //gets the Attribute's column in its Cartesian grid's data array (GEO-EAS index - 1)
-    uint atIndex = _at->getAttributeGEOEASgivenIndex() - 1;
+    //Assumes the partent file of the selected attributes is a Cartesian grid
+    CartesianGrid *cg = (CartesianGrid*)_ats[0]->getContainingFile();
+
+    //get the grid dimensions
+    uint nI = cg->getNX();
+    uint nJ = cg->getNY();
+    uint nK = cg->getNZ();
+    uint nCells = nI * nJ * nK;
+
+    //get the no-data-value configuration
+    bool hasNDV = cg->hasNoDataValue();
+    double NDV = -999.0;
+    if( hasNDV )
+        NDV = cg->getNoDataValueAsDouble();
+
+    //the values are copied to flat arrays, so the neighborhood searches read them with
+    //the linear offsets of the search template
+    uint nAttributes = _ats.size();
+    _values.assign( nAttributes, std::vector<double>() );
+    for( uint iAttribute = 0; iAttribute < nAttributes; ++iAttribute ){
+        //gets the Attribute's column in its Cartesian grid's data array (GEO-EAS index - 1)
+        uint atIndex = _ats[iAttribute]->getAttributeGEOEASgivenIndex() - 1;
+        std::vector<double>& values = _values[iAttribute];
+        values.reserve( nCells );
+        for( uint k = 0; k <nK; ++k)
+            for( uint j = 0; j <nJ; ++j)
+                for( uint i = 0; i <nI; ++i)
+                    values.push_back( cg->dataIJK( atIndex, i, j, k ) );
+    }
+
+    //group the attributes valued in the same cells (e.g. co-located assays).  The attributes of a group
+    //have the same neighbors for every cell, hence the same kriging weights, so they are estimated together.
+    emit setLabel("Grouping variables by valued cells...");
+    std::vector< std::vector<uint> > groups;
+    for( uint iAttribute = 0; iAttribute < nAttributes; ++iAttribute ){
+        std::vector< std::vector<uint> >::iterator itGroup = groups.begin();
+        for( ; itGroup != groups.end(); ++itGroup ){
+            const std::vector<double>& first = _values[ itGroup->front() ];
+            const std::vector<double>& values = _values[ iAttribute ];
+            uint cellIndex = 0;
+            for( ; cellIndex < nCells; ++cellIndex )
+                if( isValued( first[cellIndex], hasNDV, NDV ) != isValued( values[cellIndex], hasNDV, NDV ) )
+                    break;
+            if( cellIndex == nCells )
+                break;
+        }
+        if( itGroup != groups.end() )
+            itGroup->push_back( iAttribute );
+        else
+            groups.push_back( std::vector<uint>( 1, iAttribute ) );
+    }
+
+    //prepare the vectors with the results (to not overwrite the original data)
+    //they are allocated up front because the blocks of cells are estimated out of order
+    _results.assign( nAttributes, std::vector<double>( nCells, 0.0 ) );
+
+    //reads the variogram parameters once into a kernel shared by the estimation threads
+    _covKernel.reset( new CovarianceKernel( _ndvEstimation->vmodel() ) );
+
+    //tabulate the covariances for all cell offsets possible within the search neighborhood:
+    //up to n/2 cells between a sample and the estimation cell and up to twice that between two samples
+    emit setLabel("Computing covariance table...");
+    _covTable = CovarianceTable::getTable( _ndvEstimation->vmodel(),
+                                          cg->getDX(), cg->getDY(), cg->getDZ(),
+                                          2 * ( _ndvEstimation->searchNumRows() / 2 ),
+                                          2 * ( _ndvEstimation->searchNumCols() / 2 ),
+                                          2 * ( _ndvEstimation->searchNumSlices() / 2 ) );
+
+    //order the cell offsets of the search neighborhood by covariance with the estimation cell once for all cells
+    emit setLabel("Computing search template...");
+    _searchTemplate = GridSearchTemplate::getTemplate( _ndvEstimation->vmodel(),
+                                                       cg->getDX(), cg->getDY(), cg->getDZ(),
+                                                       nI, nJ, nK,
+                                                       _ndvEstimation->searchNumRows() / 2,
+                                                       _ndvEstimation->searchNumCols() / 2,
+                                                       _ndvEstimation->searchNumSlices() / 2 );
+
+    //each thread has its own search and kriging buffers, allocated once for all the cells it estimates
+    int nThreads = std::max( 1, QThreadPool::globalInstance()->maxThreadCount() );
+    std::vector<NDVEstimationWorkspace> workspaces( nThreads );
+    for( NDVEstimationWorkspace& workspace : workspaces )
+        workspace.neighbors.setCapacity( _ndvEstimation->searchMaxNumSamples() );
+
+    //one search and kriging pass per group of attributes.  The cached weights of the threads remain valid
+    //from one pass to the next, since they depend only on the neighbor offsets.
+    _nKriging = 0;
+    _nReused = 0;
+    _nFailed = 0;
+    for( uint iGroup = 0; iGroup < groups.size(); ++iGroup ){
+        QString title = "Running estimation";
+        if( groups.size() > 1 )
+            title += " (group " + QString::number( iGroup + 1 ) + " of " + QString::number( groups.size() ) + ")";
+        estimateGroup( groups[iGroup], title, hasNDV, NDV, workspaces );
+    }
+    for( const NDVEstimationWorkspace& workspace : workspaces ){
+        _nReused += workspace.nReused;
+        _nFailed += workspace.nFailed;
+    }
 
-    //Assumes the partent file of the selected attribut is a Cartesian grid
-    CartesianGrid *cg = (CartesianGrid*)_at->getContainingFile();
+    _covKernel.reset();
+    _covTable.reset();
+    _searchTemplate.reset();
+    std::vector< std::vector<double> >().swap( _values );
+
+    //inform the calling thread computation has finished
+    _finished = true;
+}
+
+void NDVEstimationRunner::estimateGroup(const std::vector<uint> &group, const QString title, bool hasNDV, double NDV,
+                                        std::vector<NDVEstimationWorkspace> &workspaces)
+{
+    //Assumes the partent file of the selected attributes is a Cartesian grid
+    CartesianGrid *cg = (CartesianGrid*)_ats[0]->getContainingFile();
 
     //get the grid dimensions
     uint nI = cg->getNX();
     uint nJ = cg->getNY();
     uint nK = cg->getNZ();
+    uint nCells = nI * nJ * nK;
+
+    //the attributes of the group are valued in the same cells, so the first one is used for the searches
+    const std::vector<double>& values = _values[ group.front() ];
 
     //create a neighborhood flag volume.
     //the flag signals that there is at least one valued cell in the search
     //neighborhood.  This flag saves unnecessary calls to krige() for vast voids
     //in the grid.
     std::vector<FlagState> mask;
-    mask.reserve(nI * nJ * nK);
+    mask.reserve( nCells );
 
     //sets the flags for valued cells
-    for( uint k = 0; k <nK; ++k){
-        for( uint j = 0; j <nJ; ++j){
-            for( uint i = 0; i <nI; ++i){
-                double value = cg->dataIJK( atIndex, i, j, k );
-                if( cg->isNDV( value ) )
-                    mask.push_back( FlagState::NOT_SET );
-                else
-                    mask.push_back( FlagState::SET );
-            }
-        }
+    for( uint cellIndex = 0; cellIndex < nCells; ++cellIndex ){
+        if( cg->isNDV( values[cellIndex] ) )
+            mask.push_back( FlagState::NOT_SET );
+        else
+            mask.push_back( FlagState::SET );
     }
 
-    //apply dilation algorithm on current flags, so we flag cells
-    //which will require a call to krige().  The dilation must be enough
-    //to cover the search neighborhood.
-    int maskExpansion = std::max({ _ndvEstimation->searchNumCols()/2,
-                                   _ndvEstimation->searchNumRows()/2,
-                                   _ndvEstimation->searchNumSlices()/2});
-    //for each dilation step
+    //dilate the flags so we flag cells which will require a call to krige().  The dilation is a box with the
+    //extents of the search neighborhood (see GridSearchTemplate), so a cell is flagged
+    //if and only if its search finds a valued cell.  The box is separable: it is applied as three passes of
+    //one-dimensional dilations, each costing O(cells) regardless of the search size.
+    int radiusI = _ndvEstimation->searchNumRows()/2;
+    int radiusJ = _ndvEstimation->searchNumCols()/2;
+    int radiusK = _ndvEstimation->searchNumSlices()/2;
     emit setLabel("Creating neighborhood values mask...");
-    for( int step = 0; step < maskExpansion; ++step){
-        emit progress(  (step/(float)maskExpansion) * nI * nJ * nK );
-        //for each cell
-        for( uint k = 0; k <nK; ++k){
-            for( uint j = 0; j <nJ; ++j){
-                for( uint i = 0; i <nI; ++i){
-                    //if the flag is not set
-                    if( mask[ i + j*nI + k*nJ*nI ] == FlagState::NOT_SET ){
-                        FlagState flagToSet = FlagState::NOT_SET; //assumes no value will be found
-                        //for each immediate neighbor
-                        for( uint kk = std::max(0, (int)k-1); kk < std::min(nK, k+2); ++kk ){
-                            for( uint jj = std::max(0, (int)j-1); jj < std::min(nJ, j+2); ++jj ){
-                                for( uint ii = std::max(0, (int)i-1); ii < std::min(nI, i+2); ++ii ){
-                                    //if the immediate neighbor has a flag set
-                                    if( mask[ ii + jj*nI + kk*nJ*nI ] == FlagState::SET ){
-                                        //set the flag of the target cell to be set before the next dilation step
-                                        flagToSet = FlagState::TO_SET;
-                                        //interrupt the immediate neighbor search because the flag is already known
-                                        goto set_flag;
-                                    }
-                                }
-                            }
-                        }
-set_flag:               mask[ i + j*nI + k*nJ*nI ] = flagToSet;
-                    }
-                }
-            }
-        }
-        //change the TO_SET flags to SET flags for the next dilation step
-        for( uint k = 0; k <nK; ++k)
-            for( uint j = 0; j <nJ; ++j)
-                for( uint i = 0; i <nI; ++i)
-                    if( mask[ i + j*nI + k*nJ*nI ] == FlagState::TO_SET )
-                        mask[ i + j*nI + k*nJ*nI ] = FlagState::SET;
+    //the passes along I and J work on whole slices, so the slices are processed in parallel
+    std::vector<uint> slices( nK );
+    for( uint k = 0; k < nK; ++k )
+        slices[k] = k;
+    QtConcurrent::blockingMap( slices, [&]( const uint& k ){
+        std::vector<FlagState> work( std::max( nI, nJ ) );
+        FlagState* slice = &mask[ k*nJ*nI ];
+        if( radiusI > 0 )
+            for( uint j = 0; j < nJ; ++j )
+                dilateLine( slice + j*nI, 1, nI, radiusI, work );
+        if( radiusJ > 0 )
+            for( uint i = 0; i < nI; ++i )
+                dilateLine( slice + i, nI, nJ, radiusJ, work );
+    });
+    //the pass along K works on the lines of each row of slices
+    if( radiusK > 0 && nK > 1 ){
+        std::vector<uint> rows( nJ );
+        for( uint j = 0; j < nJ; ++j )
+            rows[j] = j;
+        QtConcurrent::blockingMap( rows, [&]( const uint& j ){
+            std::vector<FlagState> work( nK );
+            for( uint i = 0; i < nI; ++i )
+                dilateLine( &mask[ i + j*nI ], nI*nJ, nK, radiusK, work );
+        });
     }
 
-    //prepare the vector with the results (to not overwrite the original data)
-    _results.clear();
-    _results.reserve( nI * nJ * nK );
-
-    //get the no-data-value configuration
-    bool hasNDV = cg->hasNoDataValue();
-    double NDV = -999.0;
-    if( hasNDV )
-        NDV = cg->getNoDataValueAsDouble();
-
     //define what value to assign to an estimated cell in absence of values in the search neighborhood
     double valueForNoValuesInNeighborhood;
     if( _ndvEstimation->useDefaultValue() )
@@ -118,133 +257,168 @@ set_flag:               mask[ i + j*nI + k*nJ*nI ] = flagToSet;
         //...or assign a no-data-value.
         valueForNoValuesInNeighborhood = _ndvEstimation->ndv();
 
-    //get the sill in a separate variable because VariogramModel::getSill() is slow.
-    double variogramSill = _ndvEstimation->vmodel()->getSill();
+    //the counters are updated by the threads and read here to report progress
+    std::atomic<int> nCopies( 0 );
+    std::atomic<int> nTrivial( 0 );
+    std::atomic<int> nKriging( 0 );
+    std::atomic<int> nReused( 0 );
 
-    //reads variogram parameters from file
-    _ndvEstimation->vmodel()->readParameters();
-
-    //disable reread in model's getters to improve performance
-    _ndvEstimation->vmodel()->setForceReread( false );
+    //the blocks of consecutive cells are handed out to the threads in order
+    uint nBlocks = ( nCells + NDV_BLOCK_SIZE - 1 ) / NDV_BLOCK_SIZE;
+    std::atomic<uint> nextBlock( 0 );
+    double meanSK = _ndvEstimation->meanForSK();
+    double variogramSill = _covKernel->getSill();
+    uint atIndex = _ats[ group.front() ]->getAttributeGEOEASgivenIndex() - 1;
 
     //for all grid cells
-    int nCopies = 0;
-    int nTrivial = 0;
-    int nKriging = 0;
-    for( uint k = 0; k <nK; ++k)
-        for( uint j = 0; j <nJ; ++j){
-            emit setLabel("Running estimation:\n" + QString::number(nCopies) + " copies of values\n" +
-                          QString::number(nTrivial) + " trivial cases\n" +
-                          QString::number(nKriging) + " actual kriging operations. ");
-            emit progress( j * nI + k * nI * nJ );
-            for( uint i = 0; i <nI; ++i){
-                double value = cg->dataIJK( atIndex, i, j, k );
-                if( cg->isNDV( value ) ){
+    QFuture<void> future = QtConcurrent::map( workspaces, [&]( NDVEstimationWorkspace& workspace ){
+        for( uint iBlock = nextBlock++; iBlock < nBlocks; iBlock = nextBlock++ ){
+            uint lastCell = std::min( nCells, ( iBlock + 1 ) * NDV_BLOCK_SIZE );
+            int nBlockCopies = 0;
+            int nBlockTrivial = 0;
+            int nBlockKriging = 0;
+            uint nReusedBefore = workspace.nReused;
+            for( uint cellIndex = iBlock * NDV_BLOCK_SIZE; cellIndex < lastCell; ++cellIndex ){
+                uint i = cellIndex % nI;
+                uint j = ( cellIndex / nI ) % nJ;
+                uint k = cellIndex / ( nI * nJ );
+                if( ! isValued( values[ cellIndex ], hasNDV, NDV ) ){
                     //found an unvalued cell, call krige() only if we're sure we have at least one valued
                     //cell in the neighborhood.
-                    if( mask[ i + j*nI + k*nJ*nI ] == FlagState::SET ){
+                    if( mask[ cellIndex ] == FlagState::SET ){
                         GridCell cell(cg, atIndex, i,j,k);
                         //estimate if at least one value exists in the neighborhood
-                        ++nKriging;
-                        _results.push_back( krige( cell , _ndvEstimation->meanForSK(), hasNDV, NDV, variogramSill ) );
-                    } else {
-                        ++nTrivial;
-                        _results.push_back( valueForNoValuesInNeighborhood );
-                    }
+                        ++nBlockKriging;
+                        if( krige( cell, cellIndex, group, meanSK, hasNDV, NDV, variogramSill, workspace ) )
+                            continue;
+                    } else
+                        ++nBlockTrivial;
+                    for( uint iAttribute : group )
+                        _results[ iAttribute ][ cellIndex ] = valueForNoValuesInNeighborhood;
                 }
                 else{
-                    ++nCopies;
-                    _results.push_back( value ); //simple copy from valued cells
+                    ++nBlockCopies;
+                    for( uint iAttribute : group )
+                        _results[ iAttribute ][ cellIndex ] = _values[ iAttribute ][ cellIndex ]; //simple copy from valued cells
                 }
             }
+            nCopies += nBlockCopies;
+            nTrivial += nBlockTrivial;
+            nKriging += nBlockKriging;
+            nReused += workspace.nReused - nReusedBefore;
         }
+    });
 
-    //restore automatic reread in model's getters
-    _ndvEstimation->vmodel()->setForceReread( true );
+    //the names of the attributes estimated in this pass
+    QString names;
+    for( uint iAttribute : group )
+        names += ( names.isEmpty() ? "" : ", " ) + _ats[ iAttribute ]->getName();
 
-    //inform the calling thread computation has finished
-    _finished = true;
+    //report progress until all blocks are done
+    while( ! future.isFinished() ){
+        int copies = nCopies;
+        int trivial = nTrivial;
+        int kriging = nKriging;
+        int reused = nReused;
+        emit setLabel(title + " of " + names + ":\n" + QString::number(copies) + " copies of values\n" +
+                      QString::number(trivial) + " trivial cases\n" +
+                      QString::number(kriging) + " actual kriging operations\n" +
+                      "(" + QString::number(reused) + " with reused weights). ");
+        emit progress( copies + trivial + kriging );
+        QThread::msleep( 200 );
+    }
+    emit progress( nCells );
+    _nKriging += nKriging;
 }
 
-double NDVEstimationRunner::krige(GridCell cell, double meanSK, bool hasNDV, double NDV, double variogramSill )
+bool NDVEstimationRunner::krige(const GridCell &cell, uint cellIndex, const std::vector<uint> &group,
+                                double meanSK, bool hasNDV, double NDV, double variogramSill,
+                                NDVEstimationWorkspace &workspace )
 {
-    double result = std::numeric_limits<double>::quiet_NaN();
-
-    //collects valued n-neighbors ordered by their topological distance with respect
-    //to the target cell
-    std::multiset<GridCell> vCells;
-
-    GeostatsUtils::getValuedNeighborsTopoOrdered( cell,
-                                                           _ndvEstimation->searchMaxNumSamples(),
-                                                           _ndvEstimation->searchNumCols(),
-                                                           _ndvEstimation->searchNumRows(),
-                                                           _ndvEstimation->searchNumSlices(),
-                                                           hasNDV,
-                                                           NDV,
-                                                           vCells);
-
-    //if no sample was found, either...
-    if( vCells.empty() ){
-        if( _ndvEstimation->useDefaultValue() )
-            //...return a default value (e.g. a global mean or expected value).
-            return _ndvEstimation->defaultValue();
-        else
-            //...or return a no-data-value.
-            return _ndvEstimation->ndv();
-    }
-
-    //get the covariance matrix for the neighbors cell.
-    MatrixNXM<double> covMat = GeostatsUtils::makeCovMatrix( vCells,
-                                                             _ndvEstimation->vmodel(),
-                                                             variogramSill );
+    //collects valued n-neighbors in the order of the search template (decreasing covariance
+    //with respect to the target cell)
+    NeighborBuffer& vCells = workspace.neighbors;
+    _searchTemplate->getValuedNeighbors( _values[ group.front() ].data(), cell, hasNDV, NDV, vCells );
 
-    //invert the covariance matrix.
-    covMat.invert();
+    //if no sample was found, the caller assigns the value for no estimate
+    if( vCells.empty() )
+        return false;
 
-    //get the gamma matrix (covariances between sample and estimation locations)
-    MatrixNXM<double> gammaMat = GeostatsUtils::makeGammaMatrix( vCells, cell, _ndvEstimation->vmodel() );
-
-    //get the kriging weights vector: [w] = [Cov]^-1 * [gamma]
-    MatrixNXM<double> weightsSK = covMat * gammaMat;  //covMat is inverted
+    //the offsets of the neighbors to the cell determine the kriging system (the covariances depend only
+    //on the offsets in a regular grid), so a cell whose neighbors have the same offsets as a previous cell's
+    //reuses its weights
+    std::vector<int>& signature = workspace.signature;
+    signature.resize( 3 * vCells.size() );
+    std::size_t hash = vCells.size();
+    for( uint i = 0; i < vCells.size(); ++i ){
+        signature[3*i]   = vCells[i]._indexIJK._i - cell._indexIJK._i;
+        signature[3*i+1] = vCells[i]._indexIJK._j - cell._indexIJK._j;
+        signature[3*i+2] = vCells[i]._indexIJK._k - cell._indexIJK._k;
+        for( uint c = 3*i; c < 3*i+3; ++c )
+            hash ^= std::hash<int>()( signature[c] ) + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 );
+    }
+    if( workspace.weightsCache.size() >= NDV_WEIGHTS_CACHE_SIZE && ! workspace.weightsCache.count( hash ) )
+        workspace.weightsCache.clear();
+    NDVCachedWeights& cached = workspace.weightsCache[ hash ];
 
-    //finally, compute the kriging
-    if( _ndvEstimation->ktype() == KrigingType::SK ){
-        //for SK mode
-        result = meanSK;
-        std::multiset<GridCell>::iterator itSamples = vCells.begin();
-        for( uint i = 0; i < vCells.size(); ++i, ++itSamples){
-            result += weightsSK(i,0) * ( (*itSamples).readValueFromGrid() - meanSK );
-        }
+    std::vector<double>& weights = workspace.weights;
+    if( cached.signature == signature ){
+        ++workspace.nReused;
+        weights = cached.weights;
     } else {
-        //for OK mode
-        //compute the OK weights (follows the same rationale of SK)
-        //TODO: improve performance.  Just expand SK matrices with the 1.0s and 0.0s instead of computing new ones.
-        MatrixNXM<double> covMatOK = GeostatsUtils::makeCovMatrix( vCells,
-                                                                   _ndvEstimation->vmodel(),
-                                                                   variogramSill,
-                                                                   KrigingType::OK );
-        covMatOK.invert();
-        MatrixNXM<double> gammaMatOK = GeostatsUtils::makeGammaMatrix( vCells, cell, _ndvEstimation->vmodel(), KrigingType::OK );
-        MatrixNXM<double> weightsOK = covMatOK * gammaMatOK;  //covMat is inverted
-        //Estimate the OK local mean (use OK weights)
-        double mOK = 0.0;
-        std::multiset<GridCell>::iterator itSamples = vCells.begin();
-        for( int i = 0; i < weightsOK.getN()-1; ++i, ++itSamples){ //the last element in weightsOK is the Lagrangian (mu)
-            mOK += weightsOK(i,0) * (*itSamples).readValueFromGrid();
+        //get the covariance matrix for the neighbors cell.
+        GeostatsUtils::makeCovMatrix( vCells,
+                                      *_covKernel,
+                                      workspace.covMatrix,
+                                      KrigingType::SK,
+                                      _covTable.get() );
+
+        //factorize the covariance matrix (it is not inverted)
+        KrigingSolver& solver = workspace.solver;
+        if( ! solver.factorize( workspace.covMatrix ) ){
+            //counted and reported once after the run, since this runs in the thread pool
+            ++workspace.nFailed;
+            return false;
         }
-        //compute the kriging weight for the local OK mean (use SK weights)
-        double wmOK = 1.0;
-        for( int i = 0; i < weightsSK.getN(); ++i){
-            wmOK -= weightsSK(i,0);
+
+        //get the gamma matrix (covariances between sample and estimation locations)
+        GeostatsUtils::makeGammaMatrix( vCells, cell, *_covKernel, workspace.gammaMatrix,
+                                        KrigingType::SK, _covTable.get() );
+        std::vector<double>& covariances = workspace.covariances;
+        covariances.resize( vCells.size() );
+        for( uint i = 0; i < vCells.size(); ++i )
+            covariances[i] = workspace.gammaMatrix(i,0);
+
+        //get the kriging weights
+        double variance;
+        if( _ndvEstimation->ktype() == KrigingType::SK )
+            solver.solveSK( covariances, variogramSill, weights, variance );
+        else {
+            //the OK weights are derived from the same factorization (no bordered matrix is built)
+            double lagrangian;
+            solver.solveOK( covariances, variogramSill, weights, lagrangian, variance );
         }
-        //krige (with SK weights plus the OK mean (with OK mean weight))
-        result = 0.0;
-        itSamples = vCells.begin();
-        for( uint i = 0; i < vCells.size(); ++i, ++itSamples){
-            result += weightsSK(i,0) * ( (*itSamples).readValueFromGrid() );
+
+        //keep the weights for the next cells with the same signature
+        cached.signature = signature;
+        cached.weights = weights;
+    }
+
+    //the attributes of the group have the same neighbors, so the weights apply to all of them
+    for( uint iAttribute : group ){
+        const std::vector<double>& values = _values[ iAttribute ];
+        double result;
+        if( _ndvEstimation->ktype() == KrigingType::SK ){
+            result = meanSK;
+            for( uint i = 0; i < vCells.size(); ++i )
+                result += weights[i] * ( values[ vCells[i]._dataLine ] - meanSK );
+        } else {
+            result = 0.0;
+            for( uint i = 0; i < vCells.size(); ++i )
+                result += weights[i] * values[ vCells[i]._dataLine ];
         }
-        result += wmOK * mOK;
+        _results[ iAttribute ][ cellIndex ] = result;
     }
 
-    return result;
+    return true;
 }
@@ -2,13 +2,54 @@
 #define NDVESTIMATIONRUNNER_H
 
 #include <QObject>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "krigingsolver.h"
+#include "matrixmxn.h"
+#include "neighborbuffer.h"
 
 class Attribute;
+class CovarianceKernel;
+class CovarianceTable;
+class GridSearchTemplate;
 class GridCell;
 class NDVEstimation;
 
+/** Kriging weights kept for reuse by the cells whose neighbors have the same offsets (see NDVEstimationWorkspace). */
+struct NDVCachedWeights {
+    /** The offsets (di, dj, dk) of the neighbors to the estimated cell, in search order. */
+    std::vector<int> signature;
+    std::vector<double> weights;
+};
+
+/** The buffers used to estimate a cell.  They are allocated once and reused for all estimated cells. */
+struct NDVEstimationWorkspace {
+    NDVEstimationWorkspace() : covMatrix( 0, 0 ), gammaMatrix( 0, 0 ), nReused( 0 ), nFailed( 0 ) {}
+    NeighborBuffer neighbors;
+    KrigingSolver solver;
+    MatrixNXM<double> covMatrix;
+    MatrixNXM<double> gammaMatrix;
+    std::vector<double> covariances;
+    std::vector<double> weights;
+    /** The signature of the current cell (see NDVCachedWeights). */
+    std::vector<int> signature;
+    /**
+     * The weights of the last kriging systems, by hash of their signatures.  In a regular grid the kriging system
+     * depends only on the offsets of the neighbors, so the cells with the same neighbor configuration (e.g. along
+     * a void in a regularly sampled grid) reuse the weights instead of factorizing the same matrix again.
+     */
+    std::unordered_map<std::size_t, NDVCachedWeights> weightsCache;
+    /** The number of cells estimated with cached weights. */
+    uint nReused;
+    /** The number of cells not estimated because their covariance matrix is not positive definite. */
+    uint nFailed;
+};
+
 /** This is an auxiliary class used in NDVEstimation::run() to enable the progress dialog.
  * The estimation takes place in a separate thread, so the progress bar updates.
+ * The attributes valued in the same cells are estimated in the same pass: the neighbors and the kriging weights
+ * of a cell are computed once and applied to all of them.
  */
 class NDVEstimationRunner : public QObject
 {
@@ -16,11 +57,24 @@ class NDVEstimationRunner : public QObject
     Q_OBJECT
 
 public:
-    explicit NDVEstimationRunner(NDVEstimation* ndvEstimation, Attribute* at, QObject *parent = 0);
+    /**
+     * @param ats The attributes to estimate.  They must belong to the same Cartesian grid.
+     */
+    explicit NDVEstimationRunner(NDVEstimation* ndvEstimation, const std::vector<Attribute*>& ats, QObject *parent = 0);
 
     bool isFinished(){ return _finished; }
 
-    std::vector<double> getResults(){ return _results; }
+    /** Returns the number of cells estimated by kriging in the last run. */
+    uint getKrigingCount(){ return _nKriging; }
+
+    /** Returns the number of cells of getKrigingCount() that reused the weights of a previous cell. */
+    uint getReusedWeightsCount(){ return _nReused; }
+
+    /** Returns the number of cells not estimated in the last run because their kriging systems failed. */
+    uint getFailedCount(){ return _nFailed; }
+
+    /** Returns the estimates, one vector per attribute, in the order of the attributes. */
+    const std::vector< std::vector<double> >& getResults(){ return _results; }
 
 signals:
     void progress(int);
@@ -31,12 +85,35 @@ public slots:
 
 private:
     bool _finished;
-    Attribute* _at;
+    std::vector<Attribute*> _ats;
     NDVEstimation* _ndvEstimation;
-    std::vector<double> _results;
+    std::vector< std::vector<double> > _results;
+    uint _nKriging;
+    uint _nReused;
+    uint _nFailed;
+    /** The variogram model of the current run, read once and shared by the estimation threads. */
+    std::shared_ptr<const CovarianceKernel> _covKernel;
+    /** The covariances by cell offset for the grid and variogram model of the current run. */
+    std::shared_ptr<const CovarianceTable> _covTable;
+    /** The ordered cell offsets of the search neighborhood for the grid and variogram model of the current run. */
+    std::shared_ptr<const GridSearchTemplate> _searchTemplate;
+    /** The values of the estimated attributes during the run, with i varying fastest. */
+    std::vector< std::vector<double> > _values;
+
+    /**
+     * Estimates the unvalued cells of a group of attributes valued in the same cells.
+     * @param title The beginning of the progress messages.
+     */
+    void estimateGroup(const std::vector<uint>& group, const QString title, bool hasNDV, double NDV,
+                       std::vector<NDVEstimationWorkspace>& workspaces);
 
-    /** Estimate, by kriging, a single cell. */
-    double krige(GridCell cell , double meanSK, bool hasNDV, double NDV, double variogramSill);
+    /**
+     * Estimate, by kriging, a single cell for all attributes of a group.  Returns false if the cell was
+     * not estimated (no valued neighbor or kriging failure).
+     */
+    bool krige(const GridCell& cell, uint cellIndex, const std::vector<uint>& group,
+               double meanSK, bool hasNDV, double NDV, double variogramSill,
+               NDVEstimationWorkspace& workspace);
 };
 
 #endif // NDVESTIMATIONRUNNER_H
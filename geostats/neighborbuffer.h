@@ -0,0 +1,59 @@
+#ifndef NEIGHBORBUFFER_H
+#define NEIGHBORBUFFER_H
+
+#include <vector>
+#include "geostats/ijkindex.h"
+#include "geostats/spatiallocation.h"
+
+/** Compact record of a valued grid cell found by a neighborhood search. */
+struct NeighborCell {
+    /** Topological coordinates (i,j,k). */
+    IJKIndex _indexIJK;
+    /** Spatial coordinates of the cell center. */
+    SpatialLocation _center;
+    /** The cell position in the grid data (i + j*nI + k*nI*nJ). */
+    unsigned int _dataLine;
+    /** The cell value, read during the search. */
+    double _value;
+    /** Topological distance to the target cell of the search. */
+    int _topoDistance;
+};
+
+/**
+ * The NeighborBuffer class is a fixed-capacity sequence of neighbor cell records.  Its storage is allocated
+ * once by setCapacity(), so a buffer kept by each estimation thread can be cleared and refilled for every
+ * target cell without allocating memory.  The capacity is the maximum number of samples of the search.
+ */
+class NeighborBuffer
+{
+public:
+    NeighborBuffer() : _size( 0 ) {}
+
+    /** Sets the maximum number of records and empties the buffer. */
+    void setCapacity( unsigned int capacity ){
+        _cells.resize( capacity );
+        _size = 0;
+    }
+
+    unsigned int getCapacity() const { return _cells.size(); }
+
+    unsigned int size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    bool isFull() const { return _size == _cells.size(); }
+
+    /** Empties the buffer keeping its storage. */
+    void clear(){ _size = 0; }
+
+    /** Returns the next free record to be filled by the caller.  It assumes the buffer is not full. */
+    inline NeighborCell& append(){ return _cells[ _size++ ]; }
+
+    inline const NeighborCell& operator[]( unsigned int i ) const { return _cells[i]; }
+
+private:
+    std::vector<NeighborCell> _cells;
+    unsigned int _size;
+};
+
+#endif // NEIGHBORBUFFER_H
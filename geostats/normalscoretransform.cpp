@@ -0,0 +1,338 @@
+#include "normalscoretransform.h"
+
+#include "boundedcache.h"
+#include "domain/application.h"
+#include "util.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTextStream>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+//below this number of values, the batch transforms run serially
+#define NSCORE_PARALLEL_THRESHOLD 100000
+
+//maximum number of tables read from .trn files kept for reuse
+#define NSCORE_TRN_CACHE_SIZE 32
+
+namespace {
+
+    /** Same as GSLib's powint(): power interpolation between (xlow,ylow) and (xhigh,yhigh). */
+    inline double powint( double xlow, double xhigh, double ylow, double yhigh, double xval, double power ){
+        if( std::abs( xhigh - xlow ) < 1.0e-20 )
+            return ( yhigh + ylow ) / 2.0;
+        return ylow + ( yhigh - ylow ) * std::pow( ( xval - xlow ) / ( xhigh - xlow ), power );
+    }
+
+    /** Applies a functor to all elements of a range, in parallel chunks if the range is large. */
+    template<typename F>
+    void forEachIndex( std::size_t n, F f ){
+        if( n < NSCORE_PARALLEL_THRESHOLD ){
+            for( std::size_t i = 0; i < n; ++i )
+                f( i );
+            return;
+        }
+        std::size_t nChunks = std::max( 1, QThread::idealThreadCount() ) * 4;
+        std::size_t chunkSize = ( n + nChunks - 1 ) / nChunks;
+        std::vector< std::pair<std::size_t, std::size_t> > chunks;
+        for( std::size_t start = 0; start < n; start += chunkSize )
+            chunks.push_back( { start, std::min( n, start + chunkSize ) } );
+        QtConcurrent::blockingMap( chunks, [&f]( const std::pair<std::size_t, std::size_t>& chunk ){
+            for( std::size_t i = chunk.first; i < chunk.second; ++i )
+                f( i );
+        });
+    }
+
+    /** Key of the shared tables read from .trn files: the file path and its modification time. */
+    typedef std::tuple< QString, qint64 > TrnCacheKey;
+
+    BoundedCache< TrnCacheKey, std::shared_ptr<const NormalScoreTransform> > trnCache( NSCORE_TRN_CACHE_SIZE );
+}
+
+NormalScoreTransform::NormalScoreTransform() :
+    _zmin( 0.0 ),
+    _zmax( 0.0 ),
+    _lowerTail( NScoreTailModel::LINEAR ),
+    _upperTail( NScoreTailModel::LINEAR ),
+    _lowerTailParameter( 1.0 ),
+    _upperTailParameter( 1.0 )
+{
+}
+
+bool NormalScoreTransform::build(const std::vector<double> &values,
+                                 const std::vector<double> &weights,
+                                 double trimMin, double trimMax)
+{
+    _z.clear();
+    _y.clear();
+
+    //collect the (value, weight) pairs within the trimming limits
+    bool useWeights = ! weights.empty();
+    std::vector< std::pair<double, double> > data;
+    data.reserve( values.size() );
+    for( std::size_t i = 0; i < values.size(); ++i ){
+        double value = values[i];
+        if( value < trimMin || value >= trimMax || std::isnan( value ) )
+            continue;
+        double weight = useWeights ? weights[i] : 1.0;
+        if( weight <= 0.0 )
+            continue;
+        data.push_back( { value, weight } );
+    }
+    if( data.empty() ){
+        Application::instance()->logError("NormalScoreTransform::build(): no data within the trimming limits.");
+        return false;
+    }
+
+    //sort by value
+    std::sort( data.begin(), data.end() );
+
+    double totalWeight = 0.0;
+    for( const std::pair<double, double>& datum : data )
+        totalWeight += datum.second;
+
+    //each distinct value gets the normal score at the middle of its cumulative probability interval
+    _z.reserve( data.size() );
+    _y.reserve( data.size() );
+    double cumulative = 0.0;
+    for( std::size_t i = 0; i < data.size(); ){
+        double value = data[i].first;
+        double tieWeight = 0.0;
+        for( ; i < data.size() && data[i].first == value; ++i )
+            tieWeight += data[i].second;
+        double cpLow = cumulative / totalWeight;
+        cumulative += tieWeight;
+        double cpHigh = cumulative / totalWeight;
+        _z.push_back( value );
+        _y.push_back( gaussianInverse( ( cpLow + cpHigh ) / 2.0 ) );
+    }
+
+    //default tails are the data extremes
+    _zmin = _z.front();
+    _zmax = _z.back();
+
+    updateSlopes();
+    return true;
+}
+
+bool NormalScoreTransform::loadTable(const QString trnFilePath)
+{
+    QFile file( trnFilePath );
+    if( ! file.open( QFile::ReadOnly | QFile::Text ) ){
+        Application::instance()->logError("NormalScoreTransform::loadTable(): could not open " + trnFilePath );
+        return false;
+    }
+    std::vector< std::pair<double, double> > table;
+    QTextStream in( &file );
+    while( ! in.atEnd() ){
+        QStringList values = Util::fastSplit( in.readLine() );
+        if( values.size() < 2 )
+            continue;
+        table.push_back( { values[0].toDouble(), values[1].toDouble() } );
+    }
+    file.close();
+    if( table.empty() ){
+        Application::instance()->logError("NormalScoreTransform::loadTable(): empty transform table: " + trnFilePath );
+        return false;
+    }
+    std::sort( table.begin(), table.end() );
+    _z.clear();
+    _y.clear();
+    _z.reserve( table.size() );
+    _y.reserve( table.size() );
+    for( const std::pair<double, double>& entry : table ){
+        _z.push_back( entry.first );
+        _y.push_back( entry.second );
+    }
+    _zmin = _z.front();
+    _zmax = _z.back();
+    updateSlopes();
+    return true;
+}
+
+bool NormalScoreTransform::saveTable(const QString trnFilePath) const
+{
+    QFile file( trnFilePath );
+    if( ! file.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logError("NormalScoreTransform::saveTable(): could not create " + trnFilePath );
+        return false;
+    }
+    QTextStream out( &file );
+    out.setRealNumberPrecision( 12 );
+    for( std::size_t i = 0; i < _z.size(); ++i )
+        out << _z[i] << ' ' << _y[i] << '\n';
+    file.close();
+    return true;
+}
+
+void NormalScoreTransform::setTails(double zmin, NScoreTailModel lowerTail, double lowerTailParameter,
+                                    double zmax, NScoreTailModel upperTail, double upperTailParameter)
+{
+    _zmin = zmin;
+    _zmax = zmax;
+    _lowerTail = lowerTail;
+    _upperTail = upperTail;
+    _lowerTailParameter = lowerTailParameter;
+    _upperTailParameter = upperTailParameter;
+}
+
+double NormalScoreTransform::toNormal(double value) const
+{
+    if( _z.empty() )
+        return std::numeric_limits<double>::quiet_NaN();
+
+    //values beyond the table are clamped to the extreme normal scores, as there is no
+    //sensible Gaussian extrapolation (the tails only matter to the back transform)
+    if( value <= _z.front() )
+        return _y.front();
+    if( value >= _z.back() )
+        return _y.back();
+
+    //within the table
+    std::size_t j = std::upper_bound( _z.begin(), _z.end(), value ) - _z.begin() - 1;
+    return _y[j] + ( value - _z[j] ) * _dydz[j];
+}
+
+double NormalScoreTransform::fromNormal(double normalScore) const
+{
+    if( _z.empty() )
+        return std::numeric_limits<double>::quiet_NaN();
+
+    //lower tail
+    if( normalScore <= _y.front() ){
+        double cdflo = gaussianCDF( _y.front() );
+        double cdfbt = gaussianCDF( normalScore );
+        switch( _lowerTail ){
+        case NScoreTailModel::LINEAR:
+            return powint( 0.0, cdflo, _zmin, _z.front(), cdfbt, 1.0 );
+        case NScoreTailModel::POWER:
+            return powint( 0.0, cdflo, _zmin, _z.front(), cdfbt, 1.0 / _lowerTailParameter );
+        default:
+            return _z.front();
+        }
+    }
+
+    //upper tail
+    if( normalScore >= _y.back() ){
+        double cdfhi = gaussianCDF( _y.back() );
+        double cdfbt = gaussianCDF( normalScore );
+        switch( _upperTail ){
+        case NScoreTailModel::LINEAR:
+            return powint( cdfhi, 1.0, _z.back(), _zmax, cdfbt, 1.0 );
+        case NScoreTailModel::POWER:
+            return powint( cdfhi, 1.0, _z.back(), _zmax, cdfbt, 1.0 / _upperTailParameter );
+        case NScoreTailModel::HYPERBOLIC:
+        {
+            double lambda = std::pow( _z.back(), _upperTailParameter ) * ( 1.0 - cdfhi );
+            return std::pow( lambda / ( 1.0 - cdfbt ), 1.0 / _upperTailParameter );
+        }
+        }
+        return _z.back();
+    }
+
+    //within the table
+    std::size_t j = std::upper_bound( _y.begin(), _y.end(), normalScore ) - _y.begin() - 1;
+    return _z[j] + ( normalScore - _y[j] ) * _dzdy[j];
+}
+
+void NormalScoreTransform::toNormal(const std::vector<double> &values, std::vector<double> &result,
+                                    bool hasNDV, double NDV) const
+{
+    result.resize( values.size() );
+    forEachIndex( values.size(), [&]( std::size_t i ){
+        double value = values[i];
+        if( hasNDV && Util::almostEqual2sComplement( value, NDV, 1 ) )
+            result[i] = value;
+        else
+            result[i] = toNormal( value );
+    });
+}
+
+void NormalScoreTransform::fromNormal(const std::vector<double> &normalScores, std::vector<double> &result,
+                                      bool hasNDV, double NDV) const
+{
+    result.resize( normalScores.size() );
+    forEachIndex( normalScores.size(), [&]( std::size_t i ){
+        double normalScore = normalScores[i];
+        if( hasNDV && Util::almostEqual2sComplement( normalScore, NDV, 1 ) )
+            result[i] = normalScore;
+        else
+            result[i] = fromNormal( normalScore );
+    });
+}
+
+std::shared_ptr<const NormalScoreTransform> NormalScoreTransform::fromTrnFile(const QString trnFilePath)
+{
+    QFileInfo fileInfo( trnFilePath );
+    if( ! fileInfo.exists() ){
+        Application::instance()->logError("NormalScoreTransform::fromTrnFile(): file not found: " + trnFilePath );
+        return nullptr;
+    }
+    //a changed file has a new key, so it is read again (the outdated table is evicted eventually)
+    QString path = fileInfo.absoluteFilePath();
+    TrnCacheKey key( path, fileInfo.lastModified().toMSecsSinceEpoch() );
+    return trnCache.get( key, [&](){
+        std::shared_ptr<NormalScoreTransform> transform( new NormalScoreTransform() );
+        if( ! transform->loadTable( path ) )
+            transform.reset();
+        return std::shared_ptr<const NormalScoreTransform>( transform );
+    });
+}
+
+double NormalScoreTransform::gaussianInverse(double p)
+{
+    //coefficients of the rational approximation (Kennedy and Gentle, 1980), as in GSLib's gauinv
+    const double lim = 1.0e-10;
+    const double p0 = -0.322232431088;
+    const double p1 = -1.0;
+    const double p2 = -0.342242088547;
+    const double p3 = -0.0204231210245;
+    const double p4 = -0.453642210148e-04;
+    const double q0 =  0.0993484626060;
+    const double q1 =  0.588581570495;
+    const double q2 =  0.531103462366;
+    const double q3 =  0.103537752850;
+    const double q4 =  0.38560700634e-02;
+
+    if( p < lim )
+        return -1.0e10;
+    if( p > 1.0 - lim )
+        return 1.0e10;
+
+    double pp = p;
+    if( p > 0.5 )
+        pp = 1.0 - pp;
+    if( p == 0.5 )
+        return 0.0;
+
+    double y = std::sqrt( std::log( 1.0 / ( pp * pp ) ) );
+    double xp = y + ((((y*p4+p3)*y+p2)*y+p1)*y+p0) / ((((y*q4+q3)*y+q2)*y+q1)*y+q0);
+    if( p == pp )
+        xp = -xp;
+    return xp;
+}
+
+double NormalScoreTransform::gaussianCDF(double y)
+{
+    return 0.5 * std::erfc( -y / std::sqrt( 2.0 ) );
+}
+
+void NormalScoreTransform::updateSlopes()
+{
+    std::size_t n = _z.size();
+    _dzdy.assign( n, 0.0 );
+    _dydz.assign( n, 0.0 );
+    for( std::size_t i = 0; i + 1 < n; ++i ){
+        double dz = _z[i+1] - _z[i];
+        double dy = _y[i+1] - _y[i];
+        if( std::abs( dy ) > 1.0e-20 )
+            _dzdy[i] = dz / dy;
+        if( std::abs( dz ) > 1.0e-20 )
+            _dydz[i] = dy / dz;
+    }
+}
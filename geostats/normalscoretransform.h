@@ -0,0 +1,107 @@
+#ifndef NORMALSCORETRANSFORM_H
+#define NORMALSCORETRANSFORM_H
+
+#include <vector>
+#include <memory>
+#include <QString>
+
+/*! Tail extrapolation models used in the back transform (same codes as in GSLib's backtr). */
+enum class NScoreTailModel : int {
+    LINEAR = 1,    /*!< Linear interpolation in the cdf up to/from the tail limit. */
+    POWER = 2,     /*!< Power model (parameter is the power). Lower tail only in GSLib, but accepted for both. */
+    HYPERBOLIC = 4 /*!< Hyperbolic model (parameter is the power).  Upper tail only. */
+};
+
+/**
+ * The NormalScoreTransform class is an in-process equivalent of GSLib's nscore and backtr programs.
+ * It holds a sorted table of (original value, normal score) pairs built from weighted data or read
+ * from a transform table (.trn) file.  Once built, the object is immutable for the transforms, so the
+ * same table can be shared by simulation and post-processing code and across threads without having
+ * to re-read the .trn file from disk.
+ */
+class NormalScoreTransform
+{
+public:
+    NormalScoreTransform();
+
+    /**
+     * Builds the transform table from the given data.  Values outside the trimming limits are ignored.
+     * Ties are given the same normal score (the one at the middle of their cumulative probability interval),
+     * so the transform is a function.
+     * @param weights Declustering weights.  If empty, all data are given the same weight.
+     * @return False if there are no data within the trimming limits.
+     */
+    bool build( const std::vector<double>& values,
+                const std::vector<double>& weights,
+                double trimMin, double trimMax );
+
+    /** Reads a transform table from a GSLib .trn file (two columns: value and normal score, no header). */
+    bool loadTable( const QString trnFilePath );
+
+    /** Writes the transform table as a GSLib .trn file, which can be used by backtr, sgsim, etc. */
+    bool saveTable( const QString trnFilePath ) const;
+
+    /** Sets the tail models used in the back transform.  Default is linear tails to the table extremes. */
+    void setTails( double zmin, NScoreTailModel lowerTail, double lowerTailParameter,
+                   double zmax, NScoreTailModel upperTail, double upperTailParameter );
+
+    /** Returns the normal score of a value by interpolating the table. */
+    double toNormal( double value ) const;
+
+    /** Returns the value in the original distribution that corresponds to the given normal score. */
+    double fromNormal( double normalScore ) const;
+
+    /** Transforms many values at once.  Values equal to the no-data value are passed unchanged. */
+    void toNormal( const std::vector<double>& values, std::vector<double>& result,
+                   bool hasNDV = false, double NDV = -999.0 ) const;
+
+    /** Back transforms many normal scores at once.  Values equal to the no-data value are passed unchanged. */
+    void fromNormal( const std::vector<double>& normalScores, std::vector<double>& result,
+                     bool hasNDV = false, double NDV = -999.0 ) const;
+
+    /** Returns whether there is no table (neither built nor loaded). */
+    bool isEmpty() const { return _z.empty(); }
+
+    /** Returns the number of entries in the transform table. */
+    std::size_t size() const { return _z.size(); }
+
+    /** Returns the table's original values (ascending). */
+    const std::vector<double>& values() const { return _z; }
+
+    /** Returns the table's normal scores (ascending). */
+    const std::vector<double>& normalScores() const { return _y; }
+
+    /**
+     * Returns a shared, read-only transform for the given .trn file.  The table is read from disk
+     * only once and re-read only if the file changes, so repeated back transforms (e.g. one per
+     * realization) do not reparse the file.  Returns a null pointer if the file cannot be read.
+     */
+    static std::shared_ptr<const NormalScoreTransform> fromTrnFile( const QString trnFilePath );
+
+    /** Inverse of the standard normal cdf (GSLib's gauinv). */
+    static double gaussianInverse( double p );
+
+    /** The standard normal cdf. */
+    static double gaussianCDF( double y );
+
+private:
+    /** The original values, ascending. */
+    std::vector<double> _z;
+    /** The normal scores, ascending. */
+    std::vector<double> _y;
+    /** Precomputed interpolation slopes dz/dy and dy/dz between consecutive table entries. */
+    std::vector<double> _dzdy;
+    std::vector<double> _dydz;
+
+    double _zmin;
+    double _zmax;
+    NScoreTailModel _lowerTail;
+    NScoreTailModel _upperTail;
+    double _lowerTailParameter;
+    double _upperTailParameter;
+
+    /** Fills the slope tables after the (z,y) table changes. */
+    void updateSlopes();
+};
+
+#endif // NORMALSCORETRANSFORM_H
@@ -0,0 +1,476 @@
+#include "variogramfitter.h"
+
+#include "geostatsutils.h"
+#include "domain/application.h"
+#include "gslib/gslibparameterfiles/gslibparameterfile.h"
+#include "gslib/gslibparameterfiles/gslibparamtypes.h"
+#include "util.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+    /** One multi-start task: a combination of structure types and a starting point seed. */
+    struct FitTask {
+        std::vector<VariogramStructureType> types;
+        unsigned int seed;
+        std::vector<double> params;
+        double misfit;
+    };
+
+    inline double logistic( double p ){
+        return 1.0 / ( 1.0 + std::exp( -p ) );
+    }
+
+    inline double logit( double r ){
+        r = std::min( 0.999, std::max( 0.001, r ) );
+        return std::log( r / ( 1.0 - r ) );
+    }
+
+    /** exp() protected against overflow of wild search parameters. */
+    inline double safeExp( double p ){
+        return std::exp( std::min( 50.0, std::max( -50.0, p ) ) );
+    }
+
+    /**
+     * Minimizes f starting from x with the Nelder-Mead simplex method.  x returns the minimum found.
+     * Returns the function value at x.
+     */
+    template<typename F>
+    double nelderMead( F f, std::vector<double>& x, double initialStep, uint maxEvaluations )
+    {
+        std::size_t d = x.size();
+        std::vector< std::vector<double> > simplex( d + 1, x );
+        for( std::size_t i = 0; i < d; ++i )
+            simplex[i+1][i] += initialStep;
+        std::vector<double> fv( d + 1 );
+        for( std::size_t i = 0; i <= d; ++i )
+            fv[i] = f( simplex[i] );
+        uint nEvaluations = d + 1;
+
+        std::vector<std::size_t> order( d + 1 );
+        std::vector<double> centroid( d ), xr( d ), xe( d ), xc( d );
+        while( nEvaluations < maxEvaluations ){
+            std::iota( order.begin(), order.end(), 0 );
+            std::sort( order.begin(), order.end(), [&fv]( std::size_t a, std::size_t b ){ return fv[a] < fv[b]; } );
+            std::size_t best = order[0];
+            std::size_t worst = order[d];
+            std::size_t secondWorst = order[d-1];
+
+            //converged
+            if( fv[worst] - fv[best] <= 1E-10 * std::fabs( fv[best] ) + 1E-14 )
+                break;
+
+            //centroid of all points but the worst
+            std::fill( centroid.begin(), centroid.end(), 0.0 );
+            for( std::size_t i = 0; i <= d; ++i )
+                if( i != worst )
+                    for( std::size_t j = 0; j < d; ++j )
+                        centroid[j] += simplex[i][j] / d;
+
+            //reflection
+            for( std::size_t j = 0; j < d; ++j )
+                xr[j] = 2.0 * centroid[j] - simplex[worst][j];
+            double fr = f( xr );
+            ++nEvaluations;
+
+            if( fr < fv[best] ){
+                //expansion
+                for( std::size_t j = 0; j < d; ++j )
+                    xe[j] = 3.0 * centroid[j] - 2.0 * simplex[worst][j];
+                double fe = f( xe );
+                ++nEvaluations;
+                if( fe < fr ){
+                    simplex[worst] = xe;
+                    fv[worst] = fe;
+                } else {
+                    simplex[worst] = xr;
+                    fv[worst] = fr;
+                }
+            } else if( fr < fv[secondWorst] ){
+                simplex[worst] = xr;
+                fv[worst] = fr;
+            } else {
+                //contraction (outside if the reflected point is better than the worst, inside otherwise)
+                const std::vector<double>& towards = fr < fv[worst] ? xr : simplex[worst];
+                for( std::size_t j = 0; j < d; ++j )
+                    xc[j] = 0.5 * ( centroid[j] + towards[j] );
+                double fc = f( xc );
+                ++nEvaluations;
+                if( fc < std::min( fr, fv[worst] ) ){
+                    simplex[worst] = xc;
+                    fv[worst] = fc;
+                } else {
+                    //shrink towards the best point
+                    for( std::size_t i = 0; i <= d; ++i ){
+                        if( i == best )
+                            continue;
+                        for( std::size_t j = 0; j < d; ++j )
+                            simplex[i][j] = 0.5 * ( simplex[best][j] + simplex[i][j] );
+                        fv[i] = f( simplex[i] );
+                        ++nEvaluations;
+                    }
+                }
+            }
+        }
+
+        std::size_t best = std::min_element( fv.begin(), fv.end() ) - fv.begin();
+        x = simplex[best];
+        return fv[best];
+    }
+
+    /** Makes all non-decreasing sequences of nst indexes into types (each combination once, ignoring order). */
+    void makeTypeCombinations( const std::vector<VariogramStructureType>& types, uint nst, uint firstType,
+                               std::vector<VariogramStructureType>& current,
+                               std::vector< std::vector<VariogramStructureType> >& result ){
+        if( current.size() == nst ){
+            result.push_back( current );
+            return;
+        }
+        for( uint i = firstType; i < types.size(); ++i ){
+            current.push_back( types[i] );
+            makeTypeCombinations( types, nst, i, current, result );
+            current.pop_back();
+        }
+    }
+}
+
+VariogramFitter::VariogramFitter(QObject *parent) :
+    QObject(parent),
+    _sillScale( 1.0 ),
+    _distanceScale( 1.0 ),
+    _fitHorizontalAnisotropy( false ),
+    _fitVerticalAnisotropy( false ),
+    _nst( 1 ),
+    _types( { VariogramStructureType::SPHERIC,
+              VariogramStructureType::EXPONENTIAL,
+              VariogramStructureType::GAUSSIAN } ),
+    _nStarts( 16 ),
+    _nugget( 0.0 ),
+    _objective( 0.0 )
+{
+}
+
+bool VariogramFitter::readExperimentalVariogram(const QString path,
+                                                std::vector<ExperimentalVariogramDirection> &directions)
+{
+    directions.clear();
+    QFile inputFile( path );
+    if( ! inputFile.open( QFile::ReadOnly | QFile::Text ) ){
+        Application::instance()->logError("VariogramFitter::readExperimentalVariogram(): could not open " + path);
+        return false;
+    }
+    QTextStream in(&inputFile);
+    bool startNewDirection = true;
+    while ( !in.atEnd() ){
+        QString line = in.readLine();
+        QStringList tokens = line.split( QRegularExpression("\\s+"), QString::SkipEmptyParts );
+        if( tokens.empty() )
+            continue;
+        bool isNumber;
+        tokens[0].toDouble( &isNumber );
+        //a title line begins a new direction
+        if( ! isNumber ){
+            startNewDirection = true;
+            continue;
+        }
+        if( tokens.size() < 4 )
+            continue;
+        if( startNewDirection ){
+            directions.push_back( ExperimentalVariogramDirection() );
+            directions.back().azimuth = 0.0;
+            directions.back().dip = 0.0;
+            startNewDirection = false;
+        }
+        double distance = tokens[1].toDouble();
+        double gamma = tokens[2].toDouble();
+        double nPairs = tokens[3].toDouble();
+        if( nPairs <= 0.0 || distance <= 0.0 || std::isnan( gamma ) )
+            continue;
+        directions.back().distances.push_back( distance );
+        directions.back().gammas.push_back( gamma );
+        directions.back().nPairs.push_back( nPairs );
+    }
+    inputFile.close();
+    return ! directions.empty();
+}
+
+void VariogramFitter::setExperimentalVariogram(const std::vector<ExperimentalVariogramDirection> &directions)
+{
+    _lagX.clear();
+    _lagY.clear();
+    _lagZ.clear();
+    _gammas.clear();
+    _weights.clear();
+    _sillScale = 0.0;
+    _distanceScale = 0.0;
+    _fitHorizontalAnisotropy = false;
+    _fitVerticalAnisotropy = false;
+
+    for( std::size_t iDir = 0; iDir < directions.size(); ++iDir ){
+        const ExperimentalVariogramDirection& direction = directions[iDir];
+        //direction unit vector (same convention of vmodel)
+        double azimuth = direction.azimuth * Util::PI_OVER_180;
+        double dip = direction.dip * Util::PI_OVER_180;
+        double ux = std::sin( azimuth ) * std::cos( dip );
+        double uy = std::cos( azimuth ) * std::cos( dip );
+        double uz = std::sin( dip );
+        for( std::size_t iLag = 0; iLag < direction.distances.size(); ++iLag ){
+            double distance = direction.distances[iLag];
+            _lagX.push_back( ux * distance );
+            _lagY.push_back( uy * distance );
+            _lagZ.push_back( uz * distance );
+            _gammas.push_back( direction.gammas[iLag] );
+            _weights.push_back( direction.nPairs[iLag] / distance );
+            _sillScale = std::max( _sillScale, direction.gammas[iLag] );
+            _distanceScale = std::max( _distanceScale, distance );
+        }
+
+        //the vertical anisotropy is observable if there are non-horizontal directions
+        if( std::fabs( direction.dip ) > 0.5 )
+            _fitVerticalAnisotropy = true;
+        //the horizontal anisotropy is observable if there are horizontal directions with different azimuths
+        for( std::size_t jDir = 0; jDir < iDir; ++jDir ){
+            if( std::fabs( direction.dip ) > 89.5 || std::fabs( directions[jDir].dip ) > 89.5 )
+                continue;
+            double delta = std::fmod( std::fabs( direction.azimuth - directions[jDir].azimuth ), 180.0 );
+            if( delta > 1.0 && delta < 179.0 )
+                _fitHorizontalAnisotropy = true;
+        }
+    }
+
+    if( _sillScale <= 0.0 )
+        _sillScale = 1.0;
+    if( _distanceScale <= 0.0 )
+        _distanceScale = 1.0;
+
+    //normalize the weights, so the misfit is a weighted mean
+    double sumOfWeights = std::accumulate( _weights.begin(), _weights.end(), 0.0 );
+    if( sumOfWeights > 0.0 )
+        for( double& weight : _weights )
+            weight /= sumOfWeights;
+}
+
+void VariogramFitter::decode(const std::vector<double> &params, const std::vector<VariogramStructureType> &types,
+                             double &nugget, std::vector<FittedVariogramStructure> &structures) const
+{
+    //the azimuth is shared by all structures
+    double azimuth = _fitHorizontalAnisotropy ? 180.0 * logistic( params.back() ) : 0.0;
+    nugget = _sillScale * safeExp( params[0] );
+    structures.resize( types.size() );
+    uint iParam = 1;
+    for( std::size_t ist = 0; ist < types.size(); ++ist ){
+        FittedVariogramStructure& structure = structures[ist];
+        structure.type = types[ist];
+        structure.contribution = _sillScale * safeExp( params[iParam++] );
+        structure.a_hMax = _distanceScale * safeExp( params[iParam++] );
+        double ratioHMin = _fitHorizontalAnisotropy ? logistic( params[iParam++] ) : 1.0;
+        double ratioVert = _fitVerticalAnisotropy ? logistic( params[iParam++] ) : ratioHMin;
+        structure.a_hMin = structure.a_hMax * ratioHMin;
+        structure.a_vert = structure.a_hMax * ratioVert;
+        structure.azimuth = azimuth;
+    }
+}
+
+double VariogramFitter::getMisfit(double nugget, const std::vector<FittedVariogramStructure> &structures,
+                                  std::vector<double> &modelValues, std::vector<double> &work) const
+{
+    std::size_t n = _gammas.size();
+    modelValues.assign( n, nugget );
+    work.resize( n );
+    const double* x = _lagX.data();
+    const double* y = _lagY.data();
+    const double* z = _lagZ.data();
+    double* m = modelValues.data();
+    double* h = work.data();
+
+    //evaluate the structures for all lags at once
+    for( const FittedVariogramStructure& structure : structures ){
+        Matrix3X3<double> t = GeostatsUtils::getAnisoTransform( structure.a_hMax, structure.a_hMin, structure.a_vert,
+                                                                structure.azimuth, 0.0, 0.0 );
+        double invRange = 1.0 / structure.a_hMax;
+        //the anisotropy-corrected separations normalized by the range
+        for( std::size_t k = 0; k < n; ++k ){
+            double dx = t._a11 * x[k] + t._a12 * y[k] + t._a13 * z[k];
+            double dy = t._a21 * x[k] + t._a22 * y[k] + t._a23 * z[k];
+            double dz = t._a31 * x[k] + t._a32 * y[k] + t._a33 * z[k];
+            h[k] = std::sqrt( dx*dx + dy*dy + dz*dz ) * invRange;
+        }
+        double cc = structure.contribution;
+        switch( structure.type ){
+        case VariogramStructureType::EXPONENTIAL:
+            for( std::size_t k = 0; k < n; ++k )
+                m[k] += cc * ( 1.0 - std::exp( -3.0 * h[k] ) );
+            break;
+        case VariogramStructureType::GAUSSIAN:
+            for( std::size_t k = 0; k < n; ++k )
+                m[k] += cc * ( 1.0 - std::exp( -9.0 * h[k] * h[k] ) );
+            break;
+        default: //spheric
+            for( std::size_t k = 0; k < n; ++k ){
+                double r = std::min( h[k], 1.0 );
+                m[k] += cc * ( 1.5 * r - 0.5 * r * r * r );
+            }
+        }
+    }
+
+    //weighted mean of the squared differences, normalized by the variance scale
+    double sum = 0.0;
+    for( std::size_t k = 0; k < n; ++k ){
+        double difference = m[k] - _gammas[k];
+        sum += _weights[k] * difference * difference;
+    }
+    return sum / ( _sillScale * _sillScale );
+}
+
+double VariogramFitter::search(const std::vector<VariogramStructureType> &types, unsigned int seed,
+                               std::vector<double> &params) const
+{
+    std::mt19937 generator( seed );
+    std::uniform_real_distribution<double> uniform( 0.0, 1.0 );
+
+    //random starting model: nugget up to 30% of the sill, the rest split among the structures
+    double nuggetFraction = 0.3 * uniform( generator );
+    std::vector<double> shares( types.size() );
+    for( double& share : shares )
+        share = 0.1 + uniform( generator );
+    double sumOfShares = std::accumulate( shares.begin(), shares.end(), 0.0 );
+    std::vector<double> ranges( types.size() );
+    for( double& range : ranges )
+        range = 0.05 + 0.95 * uniform( generator );
+    std::sort( ranges.begin(), ranges.end() );
+
+    params.clear();
+    params.push_back( std::log( std::max( 1E-3, nuggetFraction ) ) );
+    for( std::size_t ist = 0; ist < types.size(); ++ist ){
+        params.push_back( std::log( ( 1.0 - nuggetFraction ) * shares[ist] / sumOfShares ) );
+        params.push_back( std::log( ranges[ist] ) );
+        if( _fitHorizontalAnisotropy )
+            params.push_back( logit( 0.3 + 0.7 * uniform( generator ) ) );
+        if( _fitVerticalAnisotropy )
+            params.push_back( logit( 0.1 + 0.9 * uniform( generator ) ) );
+    }
+    if( _fitHorizontalAnisotropy )
+        params.push_back( logit( uniform( generator ) ) );
+
+    //the objective function
+    double nugget;
+    std::vector<FittedVariogramStructure> structures;
+    std::vector<double> modelValues, work;
+    auto objective = [&]( const std::vector<double>& p ) -> double {
+        decode( p, types, nugget, structures );
+        return getMisfit( nugget, structures, modelValues, work );
+    };
+
+    //the search is restarted once from the minimum found, which makes Nelder-Mead more robust
+    uint maxEvaluations = 400 * params.size();
+    nelderMead( objective, params, 0.5, maxEvaluations );
+    return nelderMead( objective, params, 0.1, maxEvaluations );
+}
+
+bool VariogramFitter::fit()
+{
+    _structures.clear();
+    _nugget = 0.0;
+
+    if( _gammas.empty() ){
+        Application::instance()->logError("VariogramFitter::fit(): no experimental variogram lags to fit.");
+        return false;
+    }
+
+    //only spheric, exponential and gaussian structures are searched
+    std::vector<VariogramStructureType> types;
+    for( VariogramStructureType type : _types )
+        if( type == VariogramStructureType::SPHERIC ||
+            type == VariogramStructureType::EXPONENTIAL ||
+            type == VariogramStructureType::GAUSSIAN )
+            types.push_back( type );
+    if( types.empty() || _nst == 0 ){
+        Application::instance()->logError("VariogramFitter::fit(): no supported structure types to search.");
+        return false;
+    }
+
+    //make the multi-start tasks
+    std::vector< std::vector<VariogramStructureType> > combinations;
+    std::vector<VariogramStructureType> current;
+    makeTypeCombinations( types, _nst, 0, current, combinations );
+    std::vector<FitTask> tasks;
+    unsigned int seed = 0;
+    for( const std::vector<VariogramStructureType>& combination : combinations )
+        for( uint iStart = 0; iStart < std::max<uint>( 1, _nStarts ); ++iStart ){
+            FitTask task;
+            task.types = combination;
+            task.seed = ++seed;
+            task.misfit = std::numeric_limits<double>::max();
+            tasks.push_back( task );
+        }
+
+    //run the searches in parallel
+    emit setLabel("Fitting variogram model (" + QString::number( tasks.size() ) + " searches)...");
+    QFuture<void> future = QtConcurrent::map( tasks, [this]( FitTask& task ){
+        task.misfit = search( task.types, task.seed, task.params );
+    });
+    while( ! future.isFinished() ){
+        emit progress( future.progressValue() * 100 / std::max<std::size_t>( 1, tasks.size() ) );
+        QThread::msleep( 100 );
+        QCoreApplication::processEvents();
+    }
+    emit progress( 100 );
+
+    //keep the best model
+    const FitTask& best = *std::min_element( tasks.begin(), tasks.end(), []( const FitTask& a, const FitTask& b ){
+        return a.misfit < b.misfit;
+    });
+    decode( best.params, best.types, _nugget, _structures );
+    _objective = best.misfit;
+
+    //negligible nugget effects are set to zero
+    if( _nugget < 1E-4 * _sillScale )
+        _nugget = 0.0;
+
+    std::sort( _structures.begin(), _structures.end(),
+               []( const FittedVariogramStructure& a, const FittedVariogramStructure& b ){
+        return a.a_hMax < b.a_hMax;
+    });
+
+    return true;
+}
+
+void VariogramFitter::setVModelParameters(GSLibParameterFile *gpf_vmodel) const
+{
+    if( gpf_vmodel->getProgramName() != "vmodel" ){
+        Application::instance()->logError("VariogramFitter::setVModelParameters(): parameter file is not for vmodel.");
+        return;
+    }
+
+    //nst and nugget effect
+    GSLibParMultiValuedFixed *par3 = gpf_vmodel->getParameter<GSLibParMultiValuedFixed*>(3);
+    par3->getParameter<GSLibParUInt*>(0)->_value = _structures.size();
+    par3->getParameter<GSLibParDouble*>(1)->_value = _nugget;
+
+    //the structures
+    GSLibParRepeat *par4 = gpf_vmodel->getParameter<GSLibParRepeat*>(4); //repeat nst-times
+    par4->setCount( _structures.size() );
+    for( uint ist = 0; ist < _structures.size(); ++ist ){
+        const FittedVariogramStructure& structure = _structures[ist];
+        GSLibParMultiValuedFixed *par4_0 = par4->getParameter<GSLibParMultiValuedFixed*>(ist, 0);
+        par4_0->getParameter<GSLibParOption*>(0)->_selected_value = (int)structure.type;
+        par4_0->getParameter<GSLibParDouble*>(1)->_value = structure.contribution;
+        par4_0->getParameter<GSLibParDouble*>(2)->_value = structure.azimuth;
+        par4_0->getParameter<GSLibParDouble*>(3)->_value = 0.0;
+        par4_0->getParameter<GSLibParDouble*>(4)->_value = 0.0;
+        GSLibParMultiValuedFixed *par4_1 = par4->getParameter<GSLibParMultiValuedFixed*>(ist, 1);
+        par4_1->getParameter<GSLibParDouble*>(0)->_value = structure.a_hMax;
+        par4_1->getParameter<GSLibParDouble*>(1)->_value = structure.a_hMin;
+        par4_1->getParameter<GSLibParDouble*>(2)->_value = structure.a_vert;
+    }
+}
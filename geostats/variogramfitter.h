@@ -0,0 +1,117 @@
+#ifndef VARIOGRAMFITTER_H
+#define VARIOGRAMFITTER_H
+
+#include <QObject>
+#include <QString>
+#include <vector>
+#include "domain/variogrammodel.h"
+
+class GSLibParameterFile;
+
+/** One direction of an experimental variogram (a block of a gamv or gam output file). */
+struct ExperimentalVariogramDirection {
+    double azimuth;                //!< Azimuth in degrees, clockwise from North.
+    double dip;                    //!< Dip in degrees.
+    std::vector<double> distances; //!< Average separation of each lag.
+    std::vector<double> gammas;    //!< Experimental variogram value of each lag.
+    std::vector<double> nPairs;    //!< Number of pairs of each lag.
+};
+
+/** A nested structure of a fitted variogram model. */
+struct FittedVariogramStructure {
+    VariogramStructureType type;
+    double contribution;
+    double a_hMax;
+    double a_hMin;
+    double a_vert;
+    double azimuth;
+};
+
+/**
+ * The VariogramFitter class fits a variogram model to an experimental variogram in-process, replacing the
+ * manual loop of editing vmodel parameters and running vmodel and vargplt.  The misfit is the weighted
+ * least squares difference between the model and the experimental values of all lags of all directions
+ * (each lag is weighted by its number of pairs over its distance, so short lags matter more).  The model
+ * is evaluated for all lags at once, one structure at a time, from flat arrays of lag vectors.
+ * The search is a multi-start Nelder-Mead: each combination of structure types is optimized from several
+ * random starting points, all of them in parallel, and the best model found is kept.  Nugget, contributions,
+ * ranges, anisotropy ratios and azimuth are searched.  Anisotropy is only searched if the experimental
+ * directions make it observable (e.g. two or more horizontal directions for the azimuth and ratio).
+ */
+class VariogramFitter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VariogramFitter( QObject *parent = nullptr );
+
+    /**
+     * Reads an experimental variogram file written by gamv or gam.  Each direction begins with a title line
+     * followed by one line per lag (lag number, distance, gamma, number of pairs, ...).  The azimuth and dip
+     * of the directions are not in the file, so they are set to zero.  Lags without pairs are skipped.
+     */
+    static bool readExperimentalVariogram( const QString path,
+                                           std::vector<ExperimentalVariogramDirection>& directions );
+
+    /** Sets the experimental variogram to fit. */
+    void setExperimentalVariogram( const std::vector<ExperimentalVariogramDirection>& directions );
+
+    /** Sets the number of nested structures (not counting the nugget effect).  Default is 1. */
+    void setNumberOfStructures( uint nst ){ _nst = nst; }
+
+    /** Sets the structure types to try.  Default is spheric, exponential and gaussian.
+     * Only these three are supported. */
+    void setStructureTypes( const std::vector<VariogramStructureType>& types ){ _types = types; }
+
+    /** Sets the number of random starting points for each combination of structure types.  Default is 16. */
+    void setNumberOfStarts( uint n ){ _nStarts = n; }
+
+    /** Performs the fitting.  Returns false if there are no valid lags to fit. */
+    bool fit();
+
+    /** Returns the fitted nugget effect. */
+    double getNugget() const { return _nugget; }
+
+    /** Returns the fitted structures, sorted by increasing range. */
+    const std::vector<FittedVariogramStructure>& getStructures() const { return _structures; }
+
+    /** Returns the misfit (weighted mean of squared differences) of the fitted model. */
+    double getObjectiveValue() const { return _objective; }
+
+    /** Sets the variogram model parameters (nst, nugget and structures) of a vmodel parameter file object. */
+    void setVModelParameters( GSLibParameterFile* gpf_vmodel ) const;
+
+signals:
+    void progress(int);
+    void setLabel(QString);
+
+private:
+    /** The experimental lags as flat arrays (lag vectors, values and weights). */
+    std::vector<double> _lagX, _lagY, _lagZ, _gammas, _weights;
+    /** Scales of the variogram values and distances used to normalize the search parameters. */
+    double _sillScale;
+    double _distanceScale;
+    bool _fitHorizontalAnisotropy;
+    bool _fitVerticalAnisotropy;
+    uint _nst;
+    std::vector<VariogramStructureType> _types;
+    uint _nStarts;
+    //the results
+    double _nugget;
+    std::vector<FittedVariogramStructure> _structures;
+    double _objective;
+
+    /** Converts search parameters into a model. */
+    void decode( const std::vector<double>& params, const std::vector<VariogramStructureType>& types,
+                 double& nugget, std::vector<FittedVariogramStructure>& structures ) const;
+
+    /** Returns the misfit of a model.  modelValues and work are work spaces. */
+    double getMisfit( double nugget, const std::vector<FittedVariogramStructure>& structures,
+                      std::vector<double>& modelValues, std::vector<double>& work ) const;
+
+    /** Runs one Nelder-Mead search from a random starting point.  Returns the misfit found. */
+    double search( const std::vector<VariogramStructureType>& types, unsigned int seed,
+                   std::vector<double>& params ) const;
+};
+
+#endif // VARIOGRAMFITTER_H
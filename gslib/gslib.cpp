@@ -10,7 +10,8 @@
 
 GSLib::GSLib() : QObject(),
     m_process( nullptr ),
-    m_stderr_assync_count( 0 )
+    m_stderr_assync_count( 0 ),
+    m_last_run_successful( false )
 {
 }
 
@@ -21,7 +22,7 @@ GSLib *GSLib::instance()
     return s_instance;
 }
 
-void GSLib::runProgram(const QString program_name, const QString par_file_path, bool parFromStdIn )
+bool GSLib::runProgram(const QString program_name, const QString par_file_path, bool parFromStdIn )
 {
     QProcess process;
     QDir gslib_home = QDir(Application::instance()->getGSLibPathSetting());
@@ -68,8 +69,11 @@ void GSLib::runProgram(const QString program_name, const QString par_file_path,
     QString stdErrMessages( process.readAllStandardError() );
     Application::instance()->logError( stdErrMessages );
     Application::instance()->logInfo( QString( m_last_output ) );
-    if( ! stdErrMessages.trimmed().isEmpty() )
+    if( ! stdErrMessages.trimmed().isEmpty() && ! Application::instance()->isHeadless() )
         QMessageBox::critical( nullptr, "Errors to stderr", program_name + " program output error messages. Please, check the Output Message panel for recent messages in red.");
+
+    m_last_run_successful = process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    return m_last_run_successful;
 }
 
 void GSLib::runProgramAsync(const QString program_name,
@@ -80,26 +84,8 @@ void GSLib::runProgramAsync(const QString program_name,
     m_stderr_assync_count = 0;
     m_process = new QProcess();
 
-    //get the GSLib home dir
-    QDir gslib_home = QDir(Application::instance()->getGSLibPathSetting());
-
-    //build the entire path to the program executable
-    QString gslib_program = gslib_home.filePath( program_name );
-
-    //surround the complete path with double quotes (path may contain whitespaces)
-    gslib_program = QString("\"").append(gslib_program).append("\"");
-
-    //tell whether the program name already has a path
-    bool programNameHasPath = program_name.contains('/') || program_name.contains('\\') ;
-
     //construct the final command to start the external process
-    QString command;
-    if( ! programNameHasPath )
-        command = gslib_program;
-    else
-        command = program_name;
-    if( !parFromStdIn )
-        command.append(" \"").append( par_file_path ).append("\"");
+    QString command = getProgramCommand( program_name, par_file_path, parFromStdIn );
 
     m_last_output = "";
 
@@ -138,6 +124,32 @@ QString GSLib::getLastOutput()
     return m_last_output;
 }
 
+QString GSLib::getProgramCommand(const QString program_name, const QString par_file_path, bool parFromStdIn)
+{
+    //get the GSLib home dir
+    QDir gslib_home = QDir(Application::instance()->getGSLibPathSetting());
+
+    //build the entire path to the program executable
+    QString gslib_program = gslib_home.filePath( program_name );
+
+    //surround the complete path with double quotes (path may contain whitespaces)
+    gslib_program = QString("\"").append(gslib_program).append("\"");
+
+    //tell whether the program name already has a path
+    bool programNameHasPath = program_name.contains('/') || program_name.contains('\\') ;
+
+    //construct the final command to start the external process
+    QString command;
+    if( ! programNameHasPath )
+        command = gslib_program;
+    else
+        command = program_name;
+    if( !parFromStdIn )
+        command.append(" \"").append( par_file_path ).append("\"");
+
+    return command;
+}
+
 void GSLib::onProgramOutput()
 {
     QString std_out_text( m_process->readAllStandardOutput() );
@@ -152,10 +164,11 @@ void GSLib::onProgramOutput()
         Application::instance()->logInfo( stdout_text );
 }
 
-void GSLib::onProgramFinished(int exit_code, QProcess::ExitStatus /*exit_status*/)
+void GSLib::onProgramFinished(int exit_code, QProcess::ExitStatus exit_status)
 {
+    m_last_run_successful = exit_status == QProcess::NormalExit && exit_code == 0;
     Application::instance()->logInfo( QString("GSLib::onProgramFinished(): Program terminated with exit code = ").append( QString::number(exit_code) ) );
-    if( m_stderr_assync_count > 0 )
+    if( m_stderr_assync_count > 0 && ! Application::instance()->isHeadless() )
         QMessageBox::critical( nullptr, "Errors to stderr", "GSLib program output error messages. Please, check the Output Message panel for recent messages in red.");
     emit programFinished();
 }
@@ -24,8 +24,9 @@ public:
      * @param parFromStdIn If true, the paramater file path is passed via standard input. Some GSLib programs ignore
      *                     the command line argument and still wait for the user to input the path to the parameter file.
      *                     gammabar and newcokb3d are known to have this unexpected behavior.
+     * @return True if the program exited normally with exit code zero.
      */
-    void runProgram( const QString program_name, const QString par_file_path, bool parFromStdIn = false );
+    bool runProgram( const QString program_name, const QString par_file_path, bool parFromStdIn = false );
 
     /**
      * Does the same as runProgram(), but does not block the client code.
@@ -50,7 +51,8 @@ public:
      * the client thread does not block, meaning that the user can get feedback on program execution like
      * runProgramAsync() while the client code can have control on program termination like runProgram().
      * THIS IS CURRENTLY NOT WORKING PROPERLY.
-     * Use runProgramAsync() with the programFinished() signal for asynchronous run with controlled termination.
+     * Use runProgramAsync() with the programFinished() signal for asynchronous run with controlled termination
+     * or GSLibJobScheduler to run several programs concurrently.
      */
     void runProgramThread( const QString program_name, const QString par_file_path );
 
@@ -59,6 +61,17 @@ public:
      */
     QString getLastOutput();
 
+    /** Returns whether the last run (synchronous or asynchronous) exited normally with exit code zero. */
+    bool isLastRunSuccessful(){ return m_last_run_successful; }
+
+    /**
+     * Returns the command line to start the given GSLib program.
+     * @param program_name The name of an executable (without extension even under Windows) or a complete path to an executable.
+     *                     In the first case, the GSLib directory as configured in GammaRay is assumed.
+     * @param parFromStdIn If true, the parameter file path is not in the command line (it must be passed via standard input).
+     */
+    QString getProgramCommand( const QString program_name, const QString par_file_path, bool parFromStdIn = false );
+
 private:
      GSLib();
      QProcess* m_process;
@@ -66,6 +79,7 @@ private:
      bool m_thread_running;
      QString m_last_output;
      uint m_stderr_assync_count;
+     bool m_last_run_successful;
 
 signals:
      void programFinished();
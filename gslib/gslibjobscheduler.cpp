@@ -0,0 +1,252 @@
+#include "gslibjobscheduler.h"
+
+#include "gslib.h"
+#include "domain/application.h"
+
+#include <QEventLoop>
+#include <QRegularExpression>
+#include <QThread>
+#include <algorithm>
+
+/*static*/ GSLibJobScheduler* GSLibJobScheduler::s_instance = nullptr;
+
+GSLibJob::GSLibJob(const QString program_name,
+                   const QString par_file_path,
+                   bool parFromStdIn,
+                   const QString working_directory,
+                   const QString description) : QObject(),
+    m_program_name( program_name ),
+    m_par_file_path( par_file_path ),
+    m_parFromStdIn( parFromStdIn ),
+    m_working_directory( working_directory ),
+    m_description( description ),
+    m_state( GSLibJobState::QUEUED ),
+    m_progress( -1 ),
+    m_exit_code( -1 ),
+    m_process( nullptr ),
+    m_started( false ),
+    m_cancel_requested( false )
+{
+    if( m_description.isEmpty() )
+        m_description = program_name;
+}
+
+GSLibJob::~GSLibJob()
+{
+    if( m_process ){
+        m_process->disconnect( this );
+        m_process->kill();
+        m_process->waitForFinished( 1000 );
+        delete m_process;
+    }
+}
+
+bool GSLibJob::isFinished() const
+{
+    return m_state == GSLibJobState::FINISHED ||
+           m_state == GSLibJobState::FAILED ||
+           m_state == GSLibJobState::CANCELED;
+}
+
+void GSLibJob::waitForFinished()
+{
+    if( isFinished() )
+        return;
+    //a local event loop delivers the process signals (and the GUI events) until the job signals its end
+    QEventLoop loop;
+    connect( this, SIGNAL(finished()), &loop, SLOT(quit()) );
+    loop.exec();
+}
+
+void GSLibJob::cancel()
+{
+    switch( m_state ){
+    case GSLibJobState::QUEUED:
+        //the scheduler skips canceled jobs in the queue
+        finish( GSLibJobState::CANCELED );
+        break;
+    case GSLibJobState::RUNNING:
+        //the final state is set when the process terminates
+        m_cancel_requested = true;
+        m_process->kill();
+        break;
+    default:
+        break;
+    }
+}
+
+void GSLibJob::start()
+{
+    m_process = new QProcess();
+
+    connect( m_process, SIGNAL(readyReadStandardOutput()), this, SLOT(onProgramOutput()) );
+    connect( m_process, SIGNAL(readyReadStandardError()), this, SLOT(onProgramOutput()) );
+    connect( m_process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(onProgramFinished(int,QProcess::ExitStatus)) );
+    connect( m_process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onProgramError(QProcess::ProcessError)) );
+
+    //the GSLib directory is the default working directory (some programs require it)
+    if( m_working_directory.isEmpty() )
+        m_process->setWorkingDirectory( Application::instance()->getGSLibPathSetting() );
+    else
+        m_process->setWorkingDirectory( m_working_directory );
+
+    m_started = true;
+    m_state = GSLibJobState::RUNNING;
+    emit stateChanged();
+
+    m_process->start( GSLib::instance()->getProgramCommand( m_program_name, m_par_file_path, m_parFromStdIn ) );
+    if( m_parFromStdIn ){
+        //some programs ask a "are you sure" question after the parameter file path.
+        m_process->write( QString(m_par_file_path).append('\n').append('y').append('\n').toStdString().c_str() );
+    }
+}
+
+void GSLibJob::finish(GSLibJobState state)
+{
+    if( isFinished() )
+        return;
+    m_state = state;
+    if( m_process ){
+        m_process->disconnect( this );
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+    if( state == GSLibJobState::FINISHED ){
+        m_progress = 100;
+        emit progressChanged( m_progress );
+    }
+    emit stateChanged();
+    emit finished();
+}
+
+void GSLibJob::onProgramOutput()
+{
+    QString stdout_text( m_process->readAllStandardOutput() );
+    QString stderr_text( m_process->readAllStandardError() );
+    m_output += stdout_text;
+    m_errors += stderr_text;
+
+    //the progress is the last percentage printed, if any (e.g. "50%" or "50.0 %")
+    static const QRegularExpression percentRegex("(\\d+(?:\\.\\d+)?)\\s*%");
+    QRegularExpressionMatchIterator it = percentRegex.globalMatch( stdout_text );
+    int progress = -1;
+    while( it.hasNext() )
+        progress = (int)it.next().captured(1).toDouble();
+    if( progress >= 0 && progress != m_progress ){
+        m_progress = std::min( 100, progress );
+        emit progressChanged( m_progress );
+    }
+}
+
+void GSLibJob::onProgramFinished(int exit_code, QProcess::ExitStatus exit_status)
+{
+    m_exit_code = exit_code;
+    //collect any output not yet read
+    onProgramOutput();
+    if( ! m_errors.trimmed().isEmpty() )
+        Application::instance()->logError( m_description + ": " + m_errors );
+    if( m_cancel_requested ){
+        Application::instance()->logWarn( m_description + ": canceled." );
+        finish( GSLibJobState::CANCELED );
+    } else if( exit_status == QProcess::CrashExit ){
+        Application::instance()->logError( m_description + ": program crashed." );
+        finish( GSLibJobState::FAILED );
+    } else {
+        Application::instance()->logInfo( m_description + ": program terminated with exit code = " +
+                                          QString::number( exit_code ) );
+        finish( GSLibJobState::FINISHED );
+    }
+}
+
+void GSLibJob::onProgramError(QProcess::ProcessError error)
+{
+    //crashes and kills are handled in onProgramFinished(), which is also called in these cases
+    if( error == QProcess::FailedToStart ){
+        Application::instance()->logError( m_description + ": program file is missing or you lack execution permission on it." );
+        finish( m_cancel_requested ? GSLibJobState::CANCELED : GSLibJobState::FAILED );
+    }
+}
+
+GSLibJobScheduler::GSLibJobScheduler() : QObject(),
+    m_running_count( 0 ),
+    m_max_concurrent_jobs( std::max( 1, QThread::idealThreadCount() ) )
+{
+}
+
+GSLibJobScheduler *GSLibJobScheduler::instance()
+{
+    if( ! GSLibJobScheduler::s_instance )
+        s_instance = new GSLibJobScheduler();
+    return s_instance;
+}
+
+GSLibJobPtr GSLibJobScheduler::submit(const QString program_name,
+                                      const QString par_file_path,
+                                      const QString description,
+                                      bool parFromStdIn,
+                                      const QString working_directory)
+{
+    GSLibJobPtr job( new GSLibJob( program_name, par_file_path, parFromStdIn, working_directory, description ) );
+    connect( job.get(), SIGNAL(finished()), this, SLOT(onJobFinished()) );
+    m_jobs.push_back( job );
+    m_queue.push_back( job );
+    emit jobsChanged();
+    startQueuedJobs();
+    return job;
+}
+
+bool GSLibJobScheduler::waitForAll(const std::vector<GSLibJobPtr> &jobs)
+{
+    bool allOK = true;
+    for( const GSLibJobPtr& job : jobs ){
+        job->waitForFinished();
+        if( job->getState() != GSLibJobState::FINISHED || job->getExitCode() != 0 )
+            allOK = false;
+    }
+    return allOK;
+}
+
+void GSLibJobScheduler::setMaxConcurrentJobs(uint value)
+{
+    m_max_concurrent_jobs = std::max<uint>( 1, value );
+    startQueuedJobs();
+}
+
+void GSLibJobScheduler::removeFinishedJobs()
+{
+    m_jobs.erase( std::remove_if( m_jobs.begin(), m_jobs.end(), []( const GSLibJobPtr& job ){
+        return job->isFinished();
+    }), m_jobs.end() );
+    emit jobsChanged();
+}
+
+void GSLibJobScheduler::cancelAll()
+{
+    //copy the list, since canceling may change it
+    std::vector<GSLibJobPtr> jobs = m_jobs;
+    for( const GSLibJobPtr& job : jobs )
+        job->cancel();
+}
+
+void GSLibJobScheduler::startQueuedJobs()
+{
+    while( m_running_count < m_max_concurrent_jobs && ! m_queue.empty() ){
+        GSLibJobPtr job = m_queue.front();
+        m_queue.pop_front();
+        //skip jobs canceled while queued
+        if( job->getState() != GSLibJobState::QUEUED )
+            continue;
+        ++m_running_count;
+        Application::instance()->logInfo( "Starting " + job->getDescription() + "..." );
+        job->start();
+    }
+}
+
+void GSLibJobScheduler::onJobFinished()
+{
+    //a job canceled while queued never occupied a slot
+    GSLibJob* job = qobject_cast<GSLibJob*>( sender() );
+    if( job && job->m_started && m_running_count > 0 )
+        --m_running_count;
+    startQueuedJobs();
+}
@@ -0,0 +1,161 @@
+#ifndef GSLIBJOBSCHEDULER_H
+#define GSLIBJOBSCHEDULER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <deque>
+#include <memory>
+#include <vector>
+
+/*! The states of a GSLib job. */
+enum class GSLibJobState : int {
+    QUEUED = 0, /*!< Waiting for a free slot in the process pool. */
+    RUNNING,    /*!< The program is running. */
+    FINISHED,   /*!< The program terminated normally. */
+    FAILED,     /*!< The program failed to start or crashed. */
+    CANCELED    /*!< The job was canceled by the user or by client code. */
+};
+
+/**
+ * The GSLibJob class represents one execution of a GSLib program submitted to the GSLibJobScheduler.
+ * It works as a future: client code can query its state, wait for it to finish and then get the exit code
+ * and the program output.  The progress is parsed from the program's standard output (the last percentage
+ * value printed), if the program reports it.
+ */
+class GSLibJob : public QObject
+{
+    Q_OBJECT
+
+    friend class GSLibJobScheduler;
+
+public:
+    GSLibJob( const QString program_name,
+              const QString par_file_path,
+              bool parFromStdIn,
+              const QString working_directory,
+              const QString description );
+    ~GSLibJob();
+
+    QString getProgramName() const { return m_program_name; }
+    QString getParFilePath() const { return m_par_file_path; }
+    QString getDescription() const { return m_description; }
+    GSLibJobState getState() const { return m_state; }
+
+    /** Returns whether the job is over (finished, failed or canceled). */
+    bool isFinished() const;
+
+    /** Returns the progress (0-100) or -1 if the program does not report progress. */
+    int getProgress() const { return m_progress; }
+
+    /** Returns the exit code of the program.  Only meaningful if the state is FINISHED. */
+    int getExitCode() const { return m_exit_code; }
+
+    /** Returns the text the program printed to standard output. */
+    QString getOutput() const { return m_output; }
+
+    /** Returns the text the program printed to standard error. */
+    QString getErrors() const { return m_errors; }
+
+    /** Waits for the job to finish.  The event loop is kept running so the GUI stays responsive. */
+    void waitForFinished();
+
+    /** Cancels the job.  A running program is killed. */
+    void cancel();
+
+signals:
+    void stateChanged();
+    void progressChanged(int);
+    void finished();
+
+private:
+    QString m_program_name;
+    QString m_par_file_path;
+    bool m_parFromStdIn;
+    QString m_working_directory;
+    QString m_description;
+    GSLibJobState m_state;
+    int m_progress;
+    int m_exit_code;
+    QString m_output;
+    QString m_errors;
+    QProcess* m_process;
+    /** Whether the job was given a slot in the process pool. */
+    bool m_started;
+    bool m_cancel_requested;
+
+    /** Starts the program.  Called by the scheduler. */
+    void start();
+
+    /** Sets the final state, frees the process and notifies the scheduler and clients. */
+    void finish( GSLibJobState state );
+
+private slots:
+    void onProgramOutput();
+    void onProgramFinished(int exit_code, QProcess::ExitStatus exit_status);
+    void onProgramError(QProcess::ProcessError error);
+};
+
+typedef std::shared_ptr<GSLibJob> GSLibJobPtr;
+
+/**
+ * The GSLibJobScheduler class runs GSLib programs concurrently on a bounded pool of processes.
+ * Unlike GSLib::runProgram(), submitting a job does not block and many jobs can be in flight, so loops
+ * over realizations, variables, etc. can submit all runs at once and then wait for all of them
+ * with waitForAll(), making use of all processors.  Jobs exceeding the pool size wait in a queue.
+ * The processes are managed via signals, so the scheduler does not need extra threads.
+ */
+class GSLibJobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static GSLibJobScheduler* instance();
+
+    /**
+     * Submits a GSLib program execution.  The parameters are the same as those of GSLib::runProgramAsync().
+     * If working_directory is empty, the program is started in the GSLib directory (same as GSLib::runProgram()).
+     * @param description A text to identify the job in the jobs panel (e.g. "gam for realization 3").
+     */
+    GSLibJobPtr submit( const QString program_name,
+                        const QString par_file_path,
+                        const QString description = QString(),
+                        bool parFromStdIn = false,
+                        const QString working_directory = QString() );
+
+    /** Waits for the jobs to finish.  Returns true if all of them terminated normally with exit code zero. */
+    bool waitForAll( const std::vector<GSLibJobPtr>& jobs );
+
+    /** Sets the maximum number of programs running at the same time.  Default is the number of processors. */
+    void setMaxConcurrentJobs( uint value );
+    uint getMaxConcurrentJobs() const { return m_max_concurrent_jobs; }
+
+    /** Returns the submitted jobs (those not yet removed with removeFinishedJobs()). */
+    const std::vector<GSLibJobPtr>& getJobs() const { return m_jobs; }
+
+    /** Forgets the jobs that are over. */
+    void removeFinishedJobs();
+
+    /** Cancels all queued and running jobs. */
+    void cancelAll();
+
+signals:
+    /** Emitted when jobs are submitted or removed. */
+    void jobsChanged();
+
+private:
+    GSLibJobScheduler();
+    static GSLibJobScheduler* s_instance;
+    std::vector<GSLibJobPtr> m_jobs;
+    std::deque<GSLibJobPtr> m_queue;
+    uint m_running_count;
+    uint m_max_concurrent_jobs;
+
+    /** Starts queued jobs while there are free slots in the pool. */
+    void startQueuedJobs();
+
+private slots:
+    void onJobFinished();
+};
+
+#endif // GSLIBJOBSCHEDULER_H
@@ -0,0 +1,199 @@
+#include "gslibresultcache.h"
+
+#include "gslib.h"
+#include "domain/application.h"
+#include "domain/project.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <algorithm>
+#include <vector>
+
+//input files up to this size are hashed by content
+#define MAX_SIZE_HASHED_BY_CONTENT (4 * 1024 * 1024)
+
+//name of the file whose modification time marks the last use of a cached result
+#define LAST_USE_FILE_NAME "lastuse"
+
+/*static*/ GSLibResultCache* GSLibResultCache::s_instance = nullptr;
+
+GSLibResultCache::GSLibResultCache() :
+    m_max_size( 256 * 1024 * 1024 )
+{
+}
+
+GSLibResultCache *GSLibResultCache::instance()
+{
+    if( ! GSLibResultCache::s_instance )
+        s_instance = new GSLibResultCache();
+    return s_instance;
+}
+
+bool GSLibResultCache::runProgram(const QString program_name, const QString par_file_path, const QStringList &outputPaths)
+{
+    QString key = makeKey( program_name, par_file_path, outputPaths );
+    if( fetch( key, outputPaths ) ){
+        Application::instance()->logInfo("Using cached results of a previous " + program_name + " run.");
+        return true;
+    }
+    //the files left by a previous run must not be taken for the outputs of this one
+    for( const QString& outputPath : outputPaths )
+        QFile::remove( outputPath );
+    QDateTime startTime = QDateTime::currentDateTime();
+    Application::instance()->logInfo("Starting " + program_name + " program...");
+    if( GSLib::instance()->runProgram( program_name, par_file_path ) )
+        store( key, outputPaths, startTime );
+    return false;
+}
+
+QString GSLibResultCache::makeKey(const QString program_name, const QString par_file_path, const QStringList &outputPaths)
+{
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    hash.addData( program_name.toUtf8() );
+
+    QFile parFile( par_file_path );
+    if( ! parFile.open( QFile::ReadOnly | QFile::Text ) ){
+        Application::instance()->logError("GSLibResultCache::makeKey(): could not open " + par_file_path);
+        return QString();
+    }
+    QTextStream in(&parFile);
+    while ( !in.atEnd() ){
+        QString line = in.readLine();
+        QString value = line.trimmed();
+        int outputIndex = outputPaths.indexOf( value );
+        if( outputIndex >= 0 ){
+            //output paths change for every run, so they are replaced by a placeholder
+            hash.addData( QString("<output %1>\n").arg( outputIndex ).toUtf8() );
+            continue;
+        }
+        hash.addData( line.toUtf8() );
+        hash.addData( "\n", 1 );
+        //file paths are alone in their lines, so if a line is an existing file, it is an input
+        QFileInfo fileInfo( value );
+        if( ! value.isEmpty() && fileInfo.isFile() ){
+            if( fileInfo.size() <= MAX_SIZE_HASHED_BY_CONTENT ){
+                QFile inputFile( value );
+                if( inputFile.open( QFile::ReadOnly ) ){
+                    hash.addData( &inputFile );
+                    inputFile.close();
+                }
+            } else {
+                hash.addData( QString::number( fileInfo.size() ).toUtf8() );
+                hash.addData( QString::number( fileInfo.lastModified().toMSecsSinceEpoch() ).toUtf8() );
+            }
+        }
+    }
+    parFile.close();
+
+    return QString( hash.result().toHex() );
+}
+
+bool GSLibResultCache::fetch(const QString key, const QStringList &outputPaths)
+{
+    if( key.isEmpty() )
+        return false;
+    QDir entryDir( QDir( getCacheDirectory() ).filePath( key ) );
+    if( ! entryDir.exists() )
+        return false;
+    for( int i = 0; i < outputPaths.size(); ++i )
+        if( ! QFileInfo( entryDir.filePath( QString::number( i ) ) ).isFile() )
+            return false;
+
+    //copy the cached outputs to where the client code expects them
+    for( int i = 0; i < outputPaths.size(); ++i ){
+        QFile::remove( outputPaths[i] );
+        if( ! QFile::copy( entryDir.filePath( QString::number( i ) ), outputPaths[i] ) ){
+            Application::instance()->logWarn("GSLibResultCache::fetch(): could not copy a cached result to " + outputPaths[i]);
+            return false;
+        }
+    }
+
+    //mark the result as recently used
+    QFile lastUseFile( entryDir.filePath( LAST_USE_FILE_NAME ) );
+    if( lastUseFile.open( QFile::WriteOnly | QFile::Truncate ) )
+        lastUseFile.close();
+
+    return true;
+}
+
+void GSLibResultCache::store(const QString key, const QStringList &outputPaths, const QDateTime &startTime)
+{
+    if( key.isEmpty() )
+        return;
+    //the modification times are compared in whole seconds, the resolution of some file systems
+    qint64 startSecond = startTime.toMSecsSinceEpoch() / 1000;
+    for( const QString& outputPath : outputPaths ){
+        QFileInfo outputInfo( outputPath );
+        if( ! outputInfo.isFile() || outputInfo.lastModified().toMSecsSinceEpoch() / 1000 < startSecond )
+            return;
+    }
+
+    QDir cacheDir( getCacheDirectory() );
+    cacheDir.mkpath( key );
+    QDir entryDir( cacheDir.filePath( key ) );
+    for( int i = 0; i < outputPaths.size(); ++i ){
+        QString cachedPath = entryDir.filePath( QString::number( i ) );
+        QFile::remove( cachedPath );
+        if( ! QFile::copy( outputPaths[i], cachedPath ) ){
+            Application::instance()->logWarn("GSLibResultCache::store(): could not cache " + outputPaths[i]);
+            entryDir.removeRecursively();
+            return;
+        }
+    }
+    QFile lastUseFile( entryDir.filePath( LAST_USE_FILE_NAME ) );
+    if( lastUseFile.open( QFile::WriteOnly | QFile::Truncate ) )
+        lastUseFile.close();
+
+    evict();
+}
+
+void GSLibResultCache::clear()
+{
+    QDir( getCacheDirectory() ).removeRecursively();
+}
+
+QString GSLibResultCache::getCacheDirectory()
+{
+    return QDir( Application::instance()->getProject()->getTmpPath() ).filePath( "gslibcache" );
+}
+
+void GSLibResultCache::evict()
+{
+    //get the size and last use of each cached result
+    struct Entry {
+        QString path;
+        qint64 size;
+        QDateTime lastUse;
+    };
+    std::vector<Entry> entries;
+    qint64 totalSize = 0;
+    QDir cacheDir( getCacheDirectory() );
+    for( const QFileInfo& entryInfo : cacheDir.entryInfoList( QDir::Dirs | QDir::NoDotAndDotDot ) ){
+        QDir entryDir( entryInfo.absoluteFilePath() );
+        Entry entry;
+        entry.path = entryInfo.absoluteFilePath();
+        entry.size = 0;
+        for( const QFileInfo& fileInfo : entryDir.entryInfoList( QDir::Files ) )
+            entry.size += fileInfo.size();
+        entry.lastUse = QFileInfo( entryDir.filePath( LAST_USE_FILE_NAME ) ).lastModified();
+        totalSize += entry.size;
+        entries.push_back( entry );
+    }
+    if( totalSize <= m_max_size )
+        return;
+
+    //remove the least recently used results first
+    std::sort( entries.begin(), entries.end(), []( const Entry& a, const Entry& b ){
+        return a.lastUse < b.lastUse;
+    });
+    for( const Entry& entry : entries ){
+        if( totalSize <= m_max_size )
+            break;
+        QDir( entry.path ).removeRecursively();
+        totalSize -= entry.size;
+    }
+}
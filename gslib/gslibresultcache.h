@@ -0,0 +1,62 @@
+#ifndef GSLIBRESULTCACHE_H
+#define GSLIBRESULTCACHE_H
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+
+/**
+ * The GSLibResultCache class keeps the output files of GSLib program runs, so repeating a run with the
+ * same parameters and inputs (e.g. reopening a dialog and plotting the same variogram) copies the previous
+ * outputs instead of running the program again.  The cache key is a hash of the program name, of the
+ * parameter file text (with the output file paths replaced by placeholders, since they are normally fresh
+ * unique paths) and of the input files referenced in the parameter file.  Small input files are hashed by
+ * content, large ones by size and modification time.  The cached outputs are kept in a directory under
+ * the project's tmp directory, whose size is bounded by evicting the least recently used results.
+ */
+class GSLibResultCache
+{
+public:
+    static GSLibResultCache* instance();
+
+    /**
+     * Runs a GSLib program (with GSLib::runProgram()) unless there are cached outputs for the same run,
+     * in which case they are copied to the output paths.  The outputs of a run are cached only if the
+     * program succeeded.
+     * @param outputPaths The paths of the output files as in the parameter file.
+     * @return True if the outputs came from the cache.
+     */
+    bool runProgram( const QString program_name, const QString par_file_path, const QStringList& outputPaths );
+
+    /** Returns the cache key for a run.  Use it with fetch() and store() for asynchronous runs. */
+    QString makeKey( const QString program_name, const QString par_file_path, const QStringList& outputPaths );
+
+    /** Copies the cached outputs of a run to the given output paths.  Returns false if there is no such result. */
+    bool fetch( const QString key, const QStringList& outputPaths );
+
+    /**
+     * Saves the outputs of a successful run to the cache.  Nothing is saved if some output file is missing or
+     * older than the start of the run (the program did not write it), so the client code should remove the
+     * output files before starting the program.
+     */
+    void store( const QString key, const QStringList& outputPaths, const QDateTime& startTime );
+
+    /** Sets the maximum total size of the cached files in bytes.  Default is 256MB. */
+    void setMaxSize( qint64 bytes ){ m_max_size = bytes; }
+
+    /** Removes all cached results. */
+    void clear();
+
+private:
+    GSLibResultCache();
+    static GSLibResultCache* s_instance;
+    qint64 m_max_size;
+
+    /** Returns the directory where the results are cached. */
+    QString getCacheDirectory();
+
+    /** Removes the least recently used results until the cache size is within the limit. */
+    void evict();
+};
+
+#endif // GSLIBRESULTCACHE_H
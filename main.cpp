@@ -1,8 +1,61 @@
 #include "mainwindow.h"
+#include "domain/application.h"
+#include "workflow/workflow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <cstring>
+
+/** Runs a workflow without the GUI.  Usage: GammaRay --batch <workflow file> --project <project directory> */
+int runBatch(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setOrganizationName(APP_NAME);
+    QCoreApplication::setOrganizationDomain("geostats.gammaray.com");
+    QCoreApplication::setApplicationName(APP_NAME_VER);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a workflow on a project without the graphical user interface.");
+    parser.addHelpOption();
+    QCommandLineOption batchOption( "batch", "The workflow file to run.", "workflow file" );
+    QCommandLineOption projectOption( "project", "The project directory.", "project directory" );
+    QCommandLineOption gslibOption( "gslib", "Sets the GSLib programs directory (the setting is saved).", "GSLib directory" );
+    QCommandLineOption allOption( "all", "Recomputes all steps, including those that are up to date." );
+    parser.addOption( batchOption );
+    parser.addOption( projectOption );
+    parser.addOption( gslibOption );
+    parser.addOption( allOption );
+    parser.process( a );
+
+    Application::instance()->setHeadless( true );
+
+    if( ! parser.isSet( projectOption ) ){
+        Application::instance()->logError("The --project option is required in batch mode.");
+        return 1;
+    }
+    if( parser.isSet( gslibOption ) )
+        Application::instance()->setGSLibPathSetting( parser.value( gslibOption ) );
+
+    Workflow workflow;
+    workflow.setForceRecompute( parser.isSet( allOption ) );
+    if( ! workflow.load( parser.value( batchOption ) ) )
+        return 1;
+
+    Application::instance()->openProject( parser.value( projectOption ) );
+    bool ok = workflow.run();
+    Application::instance()->getProject()->save();
+    Application::instance()->closeProject();
+
+    return ok ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
+    //the batch mode creates no widgets, so it can run on machines without a display
+    for( int i = 1; i < argc; ++i )
+        if( std::strncmp( argv[i], "--batch", 7 ) == 0 )
+            return runBatch( argc, argv );
+
     QApplication a(argc, argv);
     QApplication::setOrganizationName(APP_NAME);
     QApplication::setOrganizationDomain("geostats.gammaray.com");
@@ -37,6 +37,7 @@
 #include "gslib/gslibparameterfiles/gslibparamtypes.h"
 #include "gslib/gslib.h"
 #include "gslib/gslibparametersdialog.h"
+#include "widgets/gslibjobspanel.h"
 #include "dialogs/variogramanalysisdialog.h"
 #include "dialogs/declusteringdialog.h"
 #include <QDesktopServices>
@@ -57,6 +58,7 @@
 #include "dialogs/indicatorkrigingdialog.h"
 #include "dialogs/gridresampledialog.h"
 #include "spatialindex/spatialindexpoints.h"
+#include "spatialindex/searchellipsoid.h"
 #include "softindiccalib/softindicatorcalibrationdialog.h"
 #include "dialogs/cokrigingdialog.h"
 #include "dialogs/multivariogramdialog.h"
@@ -151,6 +153,9 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->txtedMessages->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->txtedMessages,SIGNAL(customContextMenuRequested(const QPoint&)),this,SLOT(showMessagesConsoleCustomContextMenu(const QPoint &)));
 
+    //the panel with the GSLib programs running concurrently (it is only visible while there are jobs)
+    ui->frmMessages->layout()->addWidget( new GSLibJobsPanel( this ) );
+
     //enable drop from drag-n-drop gestures
     setAcceptDrops( true );
 
@@ -1216,17 +1221,18 @@ void MainWindow::onLookForDuplicates()
                                              0.001, 0.0, 1000.0, 3, &ok);
     if( ok ){
         PointSet* ps = (PointSet*)_right_clicked_file;
-        SpatialIndexPoints::fill( ps, tolerance );
-        uint totFileDataLines = ps->getDataLineCount();
+        std::shared_ptr<const SpatialIndexPoints> spatialIndex = ps->getSpatialIndex( tolerance );
+        uint totFileDataLines = spatialIndex->getPointCount();
         uint headerLineCount = Util::getHeaderLineCount( ps->getPath() );
         Application::instance()->logInfo( "=======BEGIN OF REPORT============" );
         QStringList messages;
+        //the (up to four) nearest samples within the distance of all samples at once
+        SpatialIndexNeighborhoods nearSamples;
+        spatialIndex->getNeighborsOfPoints( SearchEllipsoid( distance, distance, distance, 0.0, 0.0, 0.0, 4 ), nearSamples );
         for( uint iFileDataLine = 0; iFileDataLine < totFileDataLines; ++iFileDataLine){
-            QList<uint> nearSamples = SpatialIndexPoints::getNearestWithin( iFileDataLine, 5, distance);
-            QList<uint>::iterator it = nearSamples.begin();
-            for(; it != nearSamples.end(); ++it){
+            for( std::size_t i = nearSamples.offsets[iFileDataLine]; i < nearSamples.offsets[iFileDataLine+1]; ++i ){
                 uint lineNumber1 = iFileDataLine + 1 + headerLineCount;
-                uint lineNumber2 = *it + 1 + headerLineCount;
+                uint lineNumber2 = nearSamples.indexes[i] + 1 + headerLineCount;
                 //do not report symmetrical occurences.
                 if( lineNumber1 < lineNumber2 )
                     messages.append( "Sample at line " + QString::number( lineNumber1 ) +
@@ -0,0 +1,26 @@
+#include "searchellipsoid.h"
+
+#include "geostats/geostatsutils.h"
+
+#include <cmath>
+
+SearchEllipsoid::SearchEllipsoid(double semiMajor, double semiMinor, double semiVert,
+                                 double azimuth, double dip, double roll,
+                                 uint maxSamples, uint maxPerOctant) :
+    _radius( semiMajor ),
+    _radius2( semiMajor * semiMajor ),
+    _maxSamples( maxSamples ),
+    _maxPerOctant( maxPerOctant )
+{
+    Matrix3X3<double> t = GeostatsUtils::getAnisoTransform( semiMajor, semiMinor, semiVert, azimuth, dip, roll );
+    _t[0] = t._a11; _t[1] = t._a12; _t[2] = t._a13;
+    _t[3] = t._a21; _t[4] = t._a22; _t[5] = t._a23;
+    _t[6] = t._a31; _t[7] = t._a32; _t[8] = t._a33;
+
+    //the rows of the rotation are the ellipsoid axes in world coordinates, so the extent of the
+    //ellipsoid along a world axis is the norm of that axis' components scaled by the semi-axes
+    Matrix3X3<double> r = GeostatsUtils::getAnisoTransform( 1.0, 1.0, 1.0, azimuth, dip, roll );
+    _halfSizes[0] = std::sqrt( std::pow( r._a11 * semiMajor, 2 ) + std::pow( r._a21 * semiMinor, 2 ) + std::pow( r._a31 * semiVert, 2 ) );
+    _halfSizes[1] = std::sqrt( std::pow( r._a12 * semiMajor, 2 ) + std::pow( r._a22 * semiMinor, 2 ) + std::pow( r._a32 * semiVert, 2 ) );
+    _halfSizes[2] = std::sqrt( std::pow( r._a13 * semiMajor, 2 ) + std::pow( r._a23 * semiMinor, 2 ) + std::pow( r._a33 * semiVert, 2 ) );
+}
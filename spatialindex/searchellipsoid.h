@@ -0,0 +1,64 @@
+#ifndef SEARCHELLIPSOID_H
+#define SEARCHELLIPSOID_H
+
+#include <QtGlobal>
+
+/**
+ * The SearchEllipsoid class describes an anisotropic neighborhood search as in GSLib's kt3d and sgsim: an
+ * ellipsoid given by its three semi-axes and the GSLib angles (see GeostatsUtils::getAnisoTransform()),
+ * a maximum number of samples and, optionally, a maximum number of samples per octant.
+ * Anisotropic distances are measured in units of the semi-major axis, so a point is inside the ellipsoid
+ * if its squared anisotropic distance to the center is at most getRadius() squared.
+ */
+class SearchEllipsoid
+{
+public:
+    /**
+     * @param maxPerOctant Maximum number of samples in each octant around the center.  Zero means no limit.
+     */
+    SearchEllipsoid( double semiMajor, double semiMinor, double semiVert,
+                     double azimuth, double dip, double roll,
+                     uint maxSamples, uint maxPerOctant = 0 );
+
+    /** Returns the semi-major axis. */
+    double getRadius() const { return _radius; }
+
+    /** Returns the semi-major axis squared. */
+    double getRadius2() const { return _radius2; }
+
+    uint getMaxSamples() const { return _maxSamples; }
+
+    uint getMaxPerOctant() const { return _maxPerOctant; }
+
+    /** Returns the squared anisotropic distance of a separation vector. */
+    inline double getDistance2( double dx, double dy, double dz ) const {
+        double x = _t[0] * dx + _t[1] * dy + _t[2] * dz;
+        double y = _t[3] * dx + _t[4] * dy + _t[5] * dz;
+        double z = _t[6] * dx + _t[7] * dy + _t[8] * dz;
+        return x*x + y*y + z*z;
+    }
+
+    /**
+     * Returns the octant (0 to 7) of a separation vector, from the signs of its components in world
+     * coordinates, as in GSLib's super block search.
+     */
+    static inline uint getOctant( double dx, double dy, double dz ){
+        return ( dx > 0.0 ? 1 : 0 ) + ( dy > 0.0 ? 2 : 0 ) + ( dz > 0.0 ? 4 : 0 );
+    }
+
+    /** Returns the half sizes of the axis-aligned box enclosing the ellipsoid. */
+    void getBoundingBoxHalfSizes( double& hx, double& hy, double& hz ) const {
+        hx = _halfSizes[0]; hy = _halfSizes[1]; hz = _halfSizes[2];
+    }
+
+private:
+    /** The anisotropy transform, row-major. */
+    double _t[9];
+    double _radius;
+    double _radius2;
+    double _halfSizes[3];
+    uint _maxSamples;
+    uint _maxPerOctant;
+};
+
+#endif // SEARCHELLIPSOID_H
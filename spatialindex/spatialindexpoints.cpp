@@ -1,11 +1,15 @@
 #include "spatialindexpoints.h"
+#include "searchellipsoid.h"
 
-#include <vector>
+#include <QDataStream>
+#include <QFile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
 #include <boost/geometry.hpp>
 #include <boost/geometry/index/rtree.hpp>
+#include <boost/iterator/function_output_iterator.hpp>
 
-#include "domain/pointset.h"
-#include "domain/application.h"
 
 namespace bg = boost::geometry;
 namespace bgi = boost::geometry::index;
@@ -14,71 +18,195 @@ typedef bg::model::point<double, 3, bg::cs::cartesian> Point3D;
 typedef bg::model::box<Point3D> Box;
 typedef std::pair<Box, size_t> Value;
 
-// create the R* variant of the rtree
+//number of query locations handled by each parallel task of the batch queries
+#define SPATIAL_INDEX_BATCH_SIZE 1024
+
+namespace {
+
+    /** Orders neighbors by increasing distance (and index, so ties are resolved as in a full sort). */
+    inline bool isCloser( const SpatialIndexNeighbor& a, const SpatialIndexNeighbor& b ){
+        return a.distance2 < b.distance2 || ( a.distance2 == b.distance2 && a.index < b.index );
+    }
+
+    /**
+     * Runs a query for many locations in parallel and gathers the results in CSR layout.
+     * @param query Finds the neighbors of the i-th location.
+     */
+    void runBatch( uint nQueries, SpatialIndexNeighborhoods& result,
+                   const std::function<void( uint, std::vector<SpatialIndexNeighbor>& )>& query ){
+        //each block of locations fills its own arrays, which are then concatenated
+        uint nBlocks = ( nQueries + SPATIAL_INDEX_BATCH_SIZE - 1 ) / SPATIAL_INDEX_BATCH_SIZE;
+        std::vector<SpatialIndexNeighborhoods> partials( nBlocks );
+        std::vector<uint> blocks( nBlocks );
+        for( uint iBlock = 0; iBlock < nBlocks; ++iBlock )
+            blocks[iBlock] = iBlock;
+        QtConcurrent::blockingMap( blocks, [&]( const uint& iBlock ){
+            SpatialIndexNeighborhoods& partial = partials[iBlock];
+            std::vector<SpatialIndexNeighbor> found;
+            uint last = std::min( nQueries, ( iBlock + 1 ) * SPATIAL_INDEX_BATCH_SIZE );
+            for( uint i = iBlock * SPATIAL_INDEX_BATCH_SIZE; i < last; ++i ){
+                query( i, found );
+                for( const SpatialIndexNeighbor& neighbor : found ){
+                    partial.indexes.push_back( neighbor.index );
+                    partial.distances2.push_back( neighbor.distance2 );
+                }
+                partial.offsets.push_back( partial.indexes.size() );
+            }
+        });
+
+        std::size_t total = 0;
+        for( const SpatialIndexNeighborhoods& partial : partials )
+            total += partial.indexes.size();
+        result.offsets.resize( nQueries + 1 );
+        result.indexes.resize( total );
+        result.distances2.resize( total );
+        result.offsets[0] = 0;
+        std::size_t position = 0;
+        uint i = 0;
+        for( const SpatialIndexNeighborhoods& partial : partials ){
+            for( std::size_t offset : partial.offsets )
+                result.offsets[ ++i ] = position + offset;
+            std::copy( partial.indexes.begin(), partial.indexes.end(), result.indexes.begin() + position );
+            std::copy( partial.distances2.begin(), partial.distances2.end(), result.distances2.begin() + position );
+            position += partial.indexes.size();
+        }
+    }
+}
+
+// the R* variant of the rtree
 // WARNING: incorrect R-Tree parameter may lead to crashes with element insertions
-bgi::rtree< Value, bgi::rstar<16,5,5,32> > rtree;
-
-//the query pointset
-PointSet* pointset = nullptr;
-
-//the GEO-EAS columns of the X, Y, Z variables of the point set file
-int iX;
-int iY;
-int iZ;
-
-void setPointSet( PointSet* ps ){
-    pointset = ps;
-    //loads the PointSet data.
-    ps->loadData();
-    //get the GEO-EAS indexes -1 for the X, Y and Z coordinates
-    iX = ps->getXindex() - 1;
-    iY = ps->getYindex() - 1;
-    iZ = ps->getZindex() - 1;
+struct SpatialIndexPoints::RTree {
+    typedef bgi::rtree< Value, bgi::rstar<16,5,5,32> > Tree;
+    Tree tree;
+};
+
+//identifies the spatial index files and their format version
+#define SPATIAL_INDEX_FILE_MAGIC 0x47525349
+#define SPATIAL_INDEX_FILE_VERSION 1
+
+//the coordinate arrays are written and read in chunks of this many bytes (QDataStream takes int sizes)
+#define SPATIAL_INDEX_FILE_CHUNK_SIZE (64 * 1024 * 1024)
+
+namespace {
+
+    /** Writes a coordinate array as raw data.  Returns false on errors. */
+    bool writeCoordinates( QDataStream& out, const std::vector<double>& coordinates ){
+        const char* data = (const char*)coordinates.data();
+        qint64 nBytes = (qint64)coordinates.size() * sizeof(double);
+        for( qint64 position = 0; position < nBytes; position += SPATIAL_INDEX_FILE_CHUNK_SIZE ){
+            int chunkSize = (int)std::min<qint64>( SPATIAL_INDEX_FILE_CHUNK_SIZE, nBytes - position );
+            if( out.writeRawData( data + position, chunkSize ) != chunkSize )
+                return false;
+        }
+        return true;
+    }
+
+    /** Reads a coordinate array written by writeCoordinates().  The array must have the saved size. */
+    bool readCoordinates( QDataStream& in, std::vector<double>& coordinates ){
+        char* data = (char*)coordinates.data();
+        qint64 nBytes = (qint64)coordinates.size() * sizeof(double);
+        for( qint64 position = 0; position < nBytes; position += SPATIAL_INDEX_FILE_CHUNK_SIZE ){
+            int chunkSize = (int)std::min<qint64>( SPATIAL_INDEX_FILE_CHUNK_SIZE, nBytes - position );
+            if( in.readRawData( data + position, chunkSize ) != chunkSize )
+                return false;
+        }
+        return true;
+    }
+}
+
+SpatialIndexPoints::SpatialIndexPoints() :
+    _rtree( new RTree() ),
+    _tolerance( 0.0 )
+{
 }
 
-SpatialIndexPoints::SpatialIndexPoints()
+SpatialIndexPoints::SpatialIndexPoints(std::vector<double> x, std::vector<double> y, std::vector<double> z,
+                                       double tolerance) :
+    _rtree( new RTree() ),
+    _tolerance( tolerance )
 {
+    _x.swap( x );
+    _y.swap( y );
+    _z.swap( z );
+    build();
+}
 
+void SpatialIndexPoints::build()
+{
+    //make a bounding box around each point.
+    std::size_t n = _x.size();
+    std::vector<Value> values;
+    values.reserve( n );
+    for( std::size_t i = 0; i < n; ++i )
+        values.push_back( std::make_pair( Box( Point3D(_x[i]-_tolerance, _y[i]-_tolerance, _z[i]-_tolerance),
+                                               Point3D(_x[i]+_tolerance, _y[i]+_tolerance, _z[i]+_tolerance) ),
+                                          i ) );
+    //the range constructor packs the tree (bulk load)
+    RTree::Tree packed( values.begin(), values.end() );
+    _rtree->tree.swap( packed );
 }
 
-void SpatialIndexPoints::fill(PointSet *ps, double tolerance)
+bool SpatialIndexPoints::save(const QString path, const QString key) const
 {
-    //first clear the index.
-    clear();
-
-    setPointSet( ps );
-
-    //for each data line...
-    uint totlines = ps->getDataLineCount();
-    for( uint iLine = 0; iLine < totlines; ++iLine){
-        //...make a Point3D for the index
-        double x = ps->data( iLine, iX );
-        double y = ps->data( iLine, iY );
-        double z = 0.0; //put 2D data in the z==0.0 plane
-        if( iZ >= 0 )
-            z = ps->data( iLine, iZ );
-        //make a bounding box around the point.
-        Box box( Point3D(x-tolerance, y-tolerance, z-tolerance),
-                 Point3D(x+tolerance, y+tolerance, z+tolerance));
-        //insert the box representing the point into the spatial index.
-        rtree.insert( std::make_pair(box, iLine) );
+    QFile file( path );
+    if( ! file.open( QFile::WriteOnly ) )
+        return false;
+    QDataStream out( &file );
+    out << (quint32)SPATIAL_INDEX_FILE_MAGIC << (quint32)SPATIAL_INDEX_FILE_VERSION;
+    out << key << _tolerance << (quint64)_x.size();
+    //the coordinates are written as raw arrays, which is only meant for reuse in the same machine
+    if( ! writeCoordinates( out, _x ) || ! writeCoordinates( out, _y ) || ! writeCoordinates( out, _z ) ||
+        out.status() != QDataStream::Ok ){
+        file.close();
+        file.remove();
+        return false;
     }
+    return true;
 }
 
-QList<uint> SpatialIndexPoints::getNearest(uint index, uint n)
+std::shared_ptr<SpatialIndexPoints> SpatialIndexPoints::load(const QString path, const QString key)
 {
-    QList<uint> result;
+    std::shared_ptr<SpatialIndexPoints> result;
+    QFile file( path );
+    if( ! file.open( QFile::ReadOnly ) )
+        return result;
+    QDataStream in( &file );
+    quint32 magic, version;
+    QString savedKey;
+    double tolerance;
+    quint64 n;
+    in >> magic >> version;
+    if( magic != SPATIAL_INDEX_FILE_MAGIC || version != SPATIAL_INDEX_FILE_VERSION )
+        return result;
+    in >> savedKey >> tolerance >> n;
+    if( in.status() != QDataStream::Ok || savedKey != key ||
+        (quint64)( file.size() - file.pos() ) != 3 * n * sizeof(double) )
+        return result;
+    result.reset( new SpatialIndexPoints() );
+    result->_tolerance = tolerance;
+    result->_x.resize( n );
+    result->_y.resize( n );
+    result->_z.resize( n );
+    if( ! readCoordinates( in, result->_x ) || ! readCoordinates( in, result->_y ) ||
+        ! readCoordinates( in, result->_z ) ){
+        result.reset();
+        return result;
+    }
+    result->build();
+    return result;
+}
+
+SpatialIndexPoints::~SpatialIndexPoints()
+{
+}
 
-    //get the location of the point.
-    double x = pointset->data( index, iX );
-    double y = pointset->data( index, iY );
-    double z = 0.0; //put 2D data in the z==0.0 plane
-    if( iZ >= 0 )
-        z = pointset->data( index, iZ );
+QList<uint> SpatialIndexPoints::getNearest(uint index, uint n) const
+{
+    QList<uint> result;
 
     // find n nearest values to a point
     std::vector<Value> result_n;
-    rtree.query(bgi::nearest(Point3D(x, y, z), n), std::back_inserter(result_n));
+    _rtree->tree.query(bgi::nearest(Point3D(_x[index], _y[index], _z[index]), n), std::back_inserter(result_n));
 
     // collect the point indexes
     std::vector<Value>::iterator it = result_n.begin();
@@ -92,42 +220,126 @@ QList<uint> SpatialIndexPoints::getNearest(uint index, uint n)
     return result;
 }
 
-QList<uint> SpatialIndexPoints::getNearestWithin(uint index, uint n, double distance )
+QList<uint> SpatialIndexPoints::getNearestWithin(uint index, uint n, double distance ) const
 {
     QList<uint> result;
+    double qx = _x[index];
+    double qy = _y[index];
+    double qz = _z[index];
 
-    //get the location of the query point.
-    double qx = pointset->data( index, iX );
-    double qy = pointset->data( index, iY );
-    double qz = 0.0; //put 2D data in the z==0.0 plane
-    if( iZ >= 0 )
-        qz = pointset->data( index, iZ );
-    Point3D qPoint(qx, qy, qz);
-
-    //get the n-nearest points
-    QList<uint> nearestSamples = SpatialIndexPoints::getNearest( index, n );
-
-    //test the distance to each of the n-nearest points
-    QList<uint>::iterator it = nearestSamples.begin();
-    for(; it != nearestSamples.end(); ++it){
-        //get the location of a near point.
-        uint nIndex = *it;
-        double nx = pointset->data( nIndex, iX );
-        double ny = pointset->data( nIndex, iY );
-        double nz = 0.0; //put 2D data in the z==0.0 plane
-        if( iZ >= 0 )
-            nz = pointset->data( nIndex, iZ );
-        //compute the distance between the query point and a nearest point
-        double dist = boost::geometry::distance( qPoint, Point3D(nx, ny, nz) );
-        if( dist < distance ){
-            result.push_back( nIndex );
-        }
+    //get the points whose boxes intersect the box around the query point with the given distance
+    std::vector<Value> candidates;
+    Box queryBox( Point3D(qx-distance, qy-distance, qz-distance),
+                  Point3D(qx+distance, qy+distance, qz+distance) );
+    _rtree->tree.query(bgi::intersects(queryBox), std::back_inserter(candidates));
+
+    //keep the points within the distance (but itself), nearest first
+    std::vector<SpatialIndexNeighbor> within;
+    double distance2 = distance * distance;
+    for( const Value& candidate : candidates ){
+        uint nIndex = candidate.second;
+        double dx = _x[nIndex] - qx;
+        double dy = _y[nIndex] - qy;
+        double dz = _z[nIndex] - qz;
+        double dist2 = dx*dx + dy*dy + dz*dz;
+        if( nIndex != index && dist2 < distance2 )
+            within.push_back( { nIndex, dist2 } );
     }
+    std::sort( within.begin(), within.end(), []( const SpatialIndexNeighbor& a, const SpatialIndexNeighbor& b ){
+        return a.distance2 < b.distance2 || ( a.distance2 == b.distance2 && a.index < b.index );
+    });
+    for( uint i = 0; i < within.size() && i < n; ++i )
+        result.push_back( within[i].index );
     return result;
 }
 
-void SpatialIndexPoints::clear()
+void SpatialIndexPoints::getNeighbors(double x, double y, double z, const SearchEllipsoid &search,
+                                      std::vector<SpatialIndexNeighbor> &result, int excludedIndex,
+                                      const std::vector<bool> *mask) const
+{
+    result.clear();
+
+    //visit the points whose boxes intersect the bounding box of the ellipsoid and keep those inside the
+    //ellipsoid (they go straight to the result, which the batch queries reuse, so no list of candidates
+    //is allocated per query)
+    double hx, hy, hz;
+    search.getBoundingBoxHalfSizes( hx, hy, hz );
+    Box queryBox( Point3D(x-hx, y-hy, z-hz), Point3D(x+hx, y+hy, z+hz) );
+    double radius2 = search.getRadius2();
+    _rtree->tree.query( bgi::intersects(queryBox), boost::make_function_output_iterator( [&]( const Value& candidate ){
+        uint index = candidate.second;
+        if( (int)index == excludedIndex || ( mask && ! (*mask)[index] ) )
+            return;
+        double distance2 = search.getDistance2( _x[index] - x, _y[index] - y, _z[index] - z );
+        if( distance2 <= radius2 )
+            result.push_back( { index, distance2 } );
+    }));
+
+    //take the nearest points up to the maximum number of samples and of samples per octant
+    uint maxSamples = search.getMaxSamples();
+    uint maxPerOctant = search.getMaxPerOctant();
+    if( maxPerOctant == 0 ){
+        //only the nearest maxSamples points need to be sorted
+        if( result.size() > maxSamples ){
+            std::nth_element( result.begin(), result.begin() + maxSamples, result.end(), isCloser );
+            result.resize( maxSamples );
+        }
+        std::sort( result.begin(), result.end(), isCloser );
+        return;
+    }
+    std::sort( result.begin(), result.end(), isCloser );
+    uint perOctant[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    std::size_t nKept = 0;
+    for( std::size_t i = 0; i < result.size() && nKept < maxSamples; ++i ){
+        uint index = result[i].index;
+        uint octant = SearchEllipsoid::getOctant( _x[index] - x, _y[index] - y, _z[index] - z );
+        if( perOctant[octant] == maxPerOctant )
+            continue;
+        ++perOctant[octant];
+        result[nKept++] = result[i];
+    }
+    result.resize( nKept );
+}
+
+void SpatialIndexPoints::getNearest(const double *x, const double *y, const double *z, uint nQueries, uint n,
+                                    SpatialIndexNeighborhoods &result,
+                                    const int *excludedIndexes, const std::vector<bool> *mask) const
+{
+    runBatch( nQueries, result, [&]( uint i, std::vector<SpatialIndexNeighbor>& found ){
+        found.clear();
+        int excludedIndex = excludedIndexes ? excludedIndexes[i] : -1;
+        std::vector<Value> result_n;
+        _rtree->tree.query( bgi::nearest( Point3D( x[i], y[i], z[i] ), n ) &&
+                            bgi::satisfies( [&]( const Value& v ){
+                                return (int)v.second != excludedIndex && ( ! mask || (*mask)[v.second] );
+                            }),
+                            std::back_inserter( result_n ) );
+        for( const Value& v : result_n ){
+            double dx = _x[v.second] - x[i];
+            double dy = _y[v.second] - y[i];
+            double dz = _z[v.second] - z[i];
+            found.push_back( { (uint)v.second, dx*dx + dy*dy + dz*dz } );
+        }
+        //the nearest query does not return the points in order of distance
+        std::sort( found.begin(), found.end(), []( const SpatialIndexNeighbor& a, const SpatialIndexNeighbor& b ){
+            return a.distance2 < b.distance2 || ( a.distance2 == b.distance2 && a.index < b.index );
+        });
+    });
+}
+
+void SpatialIndexPoints::getNeighbors(const double *x, const double *y, const double *z, uint nQueries,
+                                      const SearchEllipsoid &search, SpatialIndexNeighborhoods &result,
+                                      const int *excludedIndexes, const std::vector<bool> *mask) const
+{
+    runBatch( nQueries, result, [&]( uint i, std::vector<SpatialIndexNeighbor>& found ){
+        getNeighbors( x[i], y[i], z[i], search, found, excludedIndexes ? excludedIndexes[i] : -1, mask );
+    });
+}
+
+void SpatialIndexPoints::getNeighborsOfPoints(const SearchEllipsoid &search, SpatialIndexNeighborhoods &result,
+                                              const std::vector<bool> *mask) const
 {
-    rtree.clear();
-    pointset = nullptr;
+    runBatch( _x.size(), result, [&]( uint i, std::vector<SpatialIndexNeighbor>& found ){
+        getNeighbors( _x[i], _y[i], _z[i], search, found, i, mask );
+    });
 }
@@ -2,29 +2,83 @@
 #define SPATIALINDEX_H
 
 #include <QList>
+#include <QString>
+#include <memory>
+#include <vector>
 
-class PointSet;
+class SearchEllipsoid;
+
+/** A point found by a search: its index (file data line) and its squared distance to the search center. */
+struct SpatialIndexNeighbor {
+    uint index;
+    double distance2;
+};
+
+/**
+ * The neighbors found by a batch query, in compressed sparse row (CSR) layout: the neighbors of the i-th
+ * query location are at the positions offsets[i] to offsets[i+1]-1 of indexes and distances2.
+ */
+struct SpatialIndexNeighborhoods {
+    /** One more than the number of query locations. */
+    std::vector<std::size_t> offsets;
+    /** The point indexes (file data lines), nearest first for each query location. */
+    std::vector<uint> indexes;
+    /** The squared (anisotropic) distances between the points and their query locations. */
+    std::vector<double> distances2;
+
+    /** Returns the number of neighbors of a query location. */
+    uint getCount( uint query ) const { return offsets[query+1] - offsets[query]; }
+};
 
 /**
  * This class exposes functionalities related to spatial indexes and queries with GammaRay objects.
+ * An index is built for one PointSet and keeps its own copy of the point coordinates, so queries neither
+ * read the PointSet nor change the index: many threads can query the same index at once.
+ * Normally an index is not made directly, but obtained with PointSet::getSpatialIndex(), which builds
+ * it once and shares it until the point coordinates change.  The index does not depend on PointSet, so it
+ * can also index coordinates from other sources.
+ * The R-tree is built at once from all points with the packing algorithm of Boost.Geometry (STR-like
+ * bulk loading), which is much faster than inserting the points one by one and yields fuller nodes,
+ * hence faster queries.
  */
 class SpatialIndexPoints
 {
 public:
-    SpatialIndexPoints();
-
-    /** Fills the index with the PointSet points (bulk load).
-     * It erases any previously indexed points.
+    /** Fills the index with points given by contiguous coordinate arrays (bulk load).  The index keeps the
+     * arrays, so pass them with std::move() to avoid copies.  2D data go in the z==0.0 plane.
      * @param tolerance Sets the size of the bouding boxes around each point.
      */
-    static void fill( PointSet* ps, double tolerance );
+    SpatialIndexPoints( std::vector<double> x, std::vector<double> y, std::vector<double> z, double tolerance );
+    ~SpatialIndexPoints();
+
+    /**
+     * Writes the index to a binary file, so it can be reused by load() without reading the point set.
+     * Returns false if the file could not be written.
+     * @param key Identifies the state of the data the index was built from (see load()).
+     */
+    bool save( const QString path, const QString key ) const;
+
+    /**
+     * Reads an index written by save().  Returns a null pointer if the file does not exist, is not
+     * readable or was saved with a different key, in which case the index must be rebuilt.
+     */
+    static std::shared_ptr<SpatialIndexPoints> load( const QString path, const QString key );
+
+    SpatialIndexPoints( const SpatialIndexPoints& ) = delete;
+    SpatialIndexPoints& operator=( const SpatialIndexPoints& ) = delete;
+
+    /** Returns the tolerance used to build the index. */
+    double getTolerance() const { return _tolerance; }
+
+    /** Returns the number of indexed points (e.g. the data line count of the PointSet). */
+    uint getPointCount() const { return _x.size(); }
 
     /**
      * Returns the indexes of the n-nearest points to the point given by its index.
      * The indexes are the point indexes (file data lines) of the PointSet used fill
      * the index.
      */
-    static QList<uint> getNearest( uint index, uint n );
+    QList<uint> getNearest( uint index, uint n ) const;
 
     /**
      * Returns the indexes of the n-nearest points within the diven distance
@@ -33,11 +87,61 @@ public:
      * an empty list.
      * @param distance The distance the returned points must be within.
      */
-    static QList<uint> getNearestWithin(uint index, uint n, double distance);
+    QList<uint> getNearestWithin(uint index, uint n, double distance) const;
+
+    /**
+     * Finds the points inside a search ellipsoid centered at a location, in order of increasing anisotropic
+     * distance, honoring the maximum number of samples and of samples per octant of the search.
+     * Only the points whose boxes intersect the bounding box of the ellipsoid are visited, so the
+     * search costs in proportion to the number of points near the location.
+     * @param result Receives the points found and their squared anisotropic distances.  It is cleared first.
+     * @param excludedIndex The index of a point not to be returned (e.g. the sample itself in cross-validation)
+     *                      or -1.
+     * @param mask If given, only the points with a true entry are returned (e.g. those with a valid value).
+     */
+    void getNeighbors( double x, double y, double z, const SearchEllipsoid& search,
+                       std::vector<SpatialIndexNeighbor>& result, int excludedIndex = -1,
+                       const std::vector<bool>* mask = nullptr ) const;
+
+    /**
+     * Finds the n-nearest points to many locations at once.  The locations are split among threads.
+     * @param x, y, z The coordinates of the query locations.
+     * @param excludedIndexes If given, the index of a point not to be returned for each location (or -1).
+     * @param mask If given, only the points with a true entry are returned.
+     */
+    void getNearest( const double* x, const double* y, const double* z, uint nQueries, uint n,
+                     SpatialIndexNeighborhoods& result,
+                     const int* excludedIndexes = nullptr, const std::vector<bool>* mask = nullptr ) const;
+
+    /**
+     * Runs getNeighbors() for many locations at once (e.g. grid cell centers).  The locations are split
+     * among threads.  See getNearest() for the optional parameters.
+     */
+    void getNeighbors( const double* x, const double* y, const double* z, uint nQueries,
+                       const SearchEllipsoid& search, SpatialIndexNeighborhoods& result,
+                       const int* excludedIndexes = nullptr, const std::vector<bool>* mask = nullptr ) const;
+
+    /**
+     * Runs getNeighbors() at every indexed point, excluding the point itself from its own neighbors,
+     * as needed by cross-validation and duplicate detection.
+     */
+    void getNeighborsOfPoints( const SearchEllipsoid& search, SpatialIndexNeighborhoods& result,
+                               const std::vector<bool>* mask = nullptr ) const;
+
+private:
+    SpatialIndexPoints();
+
+    /** Packs the R-tree from the coordinates. */
+    void build();
+
+    /** The R-tree, defined in the .cpp so the Boost headers are not included by the users of this class. */
+    struct RTree;
+    std::unique_ptr<RTree> _rtree;
 
-    /** Clears the spatial index. */
-    static void clear();
+    /** The point coordinates (2D data are in the z==0.0 plane). */
+    std::vector<double> _x, _y, _z;
 
+    double _tolerance;
 };
 
 #endif // SPATIALINDEX_H
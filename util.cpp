@@ -25,6 +25,8 @@
 #include "gslib/gslibparams/gslibparinputdata.h"
 #include "gslib/gslib.h"
 #include "dialogs/displayplotdialog.h"
+#include "dialogs/histogramdialog.h"
+#include "geostats/histogram.h"
 #include "dialogs/distributioncolumnrolesdialog.h"
 #include <QDir>
 #include <QFileInfo>
@@ -993,6 +995,9 @@ void Util::importSettingsFromPreviousVersion()
 
 DisplayResolution Util::getDisplayResolutionClass()
 {
+    //there are no screens when running headless (see Application::isHeadless())
+    if( QGuiApplication::screens().isEmpty() )
+        return DisplayResolution::NORMAL_DPI;
     QScreen *screen0 = QApplication::screens().at(0);
     qreal rDPI = (qreal)screen0->logicalDotsPerInch();
     if( rDPI < 160 ) //96dpi is about SVGA in a 15-inch screen.
@@ -1716,21 +1721,20 @@ bool Util::viewHistogram(Attribute *at, QWidget *parent, bool modal)
     gpf.getParameter<GSLibParDouble*>(11)->_value = input_data_file->mean( var_index-1 );
     //----------------------------------------------------------------------------------
 
-    //Generate the parameter file
-    QString par_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("par");
-    gpf.save( par_file_path );
-
-    //run histplt program
-    Application::instance()->logInfo("Starting histplt program...");
-    GSLib::instance()->runProgram( "histplt", par_file_path );
+    //compute the histogram in-process (histplt is run only if the user asks for the PostScript plot)
+    Histogram histogram;
+    histogram.compute( input_data_file, var_index-1, -1,
+                       par0->_trimming_limits._min, par0->_trimming_limits._max );
 
-    //display the plot output
-    DisplayPlotDialog *dpd = new DisplayPlotDialog(gpf.getParameter<GSLibParFile*>(1)->_path, title, gpf, parent);
+    //display the histogram
+    HistogramDialog *hd = new HistogramDialog( title, parent );
+    hd->setHistogram( histogram, at->getName() );
+    hd->setGSLibPlot( gpf, gpf.getParameter<GSLibParFile*>(1)->_path );
     if( modal ){
-        int response = dpd->exec();
+        int response = hd->exec();
         return response == QDialog::Accepted;
     }
-    dpd->show();
+    hd->show();
     return false;
 }
 
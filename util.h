@@ -503,11 +503,11 @@ public:
                                      double minWindowPercent = 0.01); //0.01 == 1%
 
     /**
-     * Runs the GSLib program histplt and opens the plot dialog to view the histogram of
-     * variable.
-     * @param parent Parent QWidget for the plot dialog.
-     * @param modal If true, the method returns only when the user closes the Plot Dialog.
-     * @return True if modal == true and if the user did not cancel the Plot Dialog; false otherwise.
+     * Computes the histogram of a variable in-process and opens the histogram dialog to view it.
+     * The histplt parameters are passed to the dialog, so the user can still make the GSLib PostScript plot.
+     * @param parent Parent QWidget for the histogram dialog.
+     * @param modal If true, the method returns only when the user closes the histogram dialog.
+     * @return True if modal == true and if the histogram dialog was accepted; false otherwise.
      */
     static bool viewHistogram( Attribute *at, QWidget *parent = nullptr, bool modal = false );
 
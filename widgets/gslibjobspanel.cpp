@@ -0,0 +1,78 @@
+#include "gslibjobspanel.h"
+#include "ui_gslibjobspanel.h"
+#include "gslib/gslibjobscheduler.h"
+#include <QProgressBar>
+#include <algorithm>
+
+GSLibJobsPanel::GSLibJobsPanel(QWidget *parent) :
+    QWidget(parent),
+    ui(new Ui::GSLibJobsPanel)
+{
+    ui->setupUi(this);
+
+    connect( GSLibJobScheduler::instance(), SIGNAL(jobsChanged()), this, SLOT(onJobsChanged()) );
+
+    onJobsChanged();
+}
+
+GSLibJobsPanel::~GSLibJobsPanel()
+{
+    delete ui;
+}
+
+void GSLibJobsPanel::onJobsChanged()
+{
+    const std::vector<GSLibJobPtr>& jobs = GSLibJobScheduler::instance()->getJobs();
+
+    //the panel is only shown while there are jobs to show
+    setVisible( ! jobs.empty() );
+
+    ui->tblJobs->setRowCount( jobs.size() );
+    for( uint row = 0; row < jobs.size(); ++row ){
+        GSLibJob* job = jobs[row].get();
+        //the connections are made only once per job
+        connect( job, SIGNAL(stateChanged()), this, SLOT(onJobUpdated()), Qt::UniqueConnection );
+        connect( job, SIGNAL(progressChanged(int)), this, SLOT(onJobUpdated()), Qt::UniqueConnection );
+        ui->tblJobs->setItem( row, 0, new QTableWidgetItem( job->getDescription() ) );
+        ui->tblJobs->setItem( row, 1, new QTableWidgetItem() );
+        if( ! ui->tblJobs->cellWidget( row, 2 ) )
+            ui->tblJobs->setCellWidget( row, 2, new QProgressBar() );
+    }
+
+    onJobUpdated();
+}
+
+void GSLibJobsPanel::onJobUpdated()
+{
+    const std::vector<GSLibJobPtr>& jobs = GSLibJobScheduler::instance()->getJobs();
+    for( uint row = 0; row < jobs.size() && row < (uint)ui->tblJobs->rowCount(); ++row ){
+        GSLibJob* job = jobs[row].get();
+        QString state;
+        switch( job->getState() ){
+        case GSLibJobState::QUEUED: state = "queued"; break;
+        case GSLibJobState::RUNNING: state = "running"; break;
+        case GSLibJobState::FINISHED: state = "finished (exit code " + QString::number( job->getExitCode() ) + ")"; break;
+        case GSLibJobState::FAILED: state = "failed"; break;
+        case GSLibJobState::CANCELED: state = "canceled"; break;
+        }
+        ui->tblJobs->item( row, 1 )->setText( state );
+        QProgressBar* progressBar = (QProgressBar*)ui->tblJobs->cellWidget( row, 2 );
+        if( job->getState() == GSLibJobState::RUNNING && job->getProgress() < 0 ){
+            //busy indicator for programs that do not report progress
+            progressBar->setRange( 0, 0 );
+        } else {
+            progressBar->setRange( 0, 100 );
+            progressBar->setValue( job->isFinished() ? 100 : std::max( 0, job->getProgress() ) );
+        }
+    }
+}
+
+void GSLibJobsPanel::onCancelAll()
+{
+    GSLibJobScheduler::instance()->cancelAll();
+}
+
+void GSLibJobsPanel::onClearFinished()
+{
+    GSLibJobScheduler::instance()->removeFinishedJobs();
+}
@@ -0,0 +1,34 @@
+#ifndef GSLIBJOBSPANEL_H
+#define GSLIBJOBSPANEL_H
+
+#include <QWidget>
+
+namespace Ui {
+class GSLibJobsPanel;
+}
+
+/**
+ * The GSLibJobsPanel class is a widget that lists the jobs of the GSLibJobScheduler with their states and
+ * progresses.  The user can cancel all jobs or clear the finished ones.  It is only visible while there are jobs.
+ */
+class GSLibJobsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit GSLibJobsPanel(QWidget *parent = 0);
+    ~GSLibJobsPanel();
+
+private:
+    Ui::GSLibJobsPanel *ui;
+
+private slots:
+    /** Rebuilds the jobs table. */
+    void onJobsChanged();
+    /** Updates the state and progress columns. */
+    void onJobUpdated();
+    void onCancelAll();
+    void onClearFinished();
+};
+
+#endif // GSLIBJOBSPANEL_H
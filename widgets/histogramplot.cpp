@@ -0,0 +1,125 @@
+#include "histogramplot.h"
+
+#include <qwt_plot_histogram.h>
+#include <qwt_plot_curve.h>
+#include <qwt_plot_grid.h>
+#include <qwt_plot_layout.h>
+#include <qwt_series_data.h>
+
+#include "geostats/histogram.h"
+
+HistogramPlot::HistogramPlot(QWidget *parent) :
+    QwtPlot( parent ),
+    m_histogram( nullptr ),
+    m_bars( new QwtPlotHistogram() ),
+    m_cdf( new QwtPlotCurve() ),
+    m_nClasses( 50 ),
+    m_cumulative( false )
+{
+    setCanvasBackground( Qt::white );
+
+    QwtPlotGrid *grid = new QwtPlotGrid;
+    grid->setMajorPen( Qt::gray, 0, Qt::DotLine );
+    grid->attach( this );
+
+    m_bars->setStyle( QwtPlotHistogram::Columns );
+    m_bars->setPen( QPen( Qt::black, 0 ) );
+    m_bars->setBrush( QBrush( QColor( 0, 128, 192 ) ) );
+    m_bars->attach( this );
+
+    m_cdf->setStyle( QwtPlotCurve::Steps );
+    m_cdf->setPen( QPen( Qt::black, 2 ) );
+    m_cdf->attach( this );
+
+    plotLayout()->setAlignCanvasToScales( true );
+}
+
+HistogramPlot::~HistogramPlot()
+{
+    clearCDFCurves();
+    m_bars->detach();
+    m_cdf->detach();
+    delete m_bars;
+    delete m_cdf;
+}
+
+void HistogramPlot::setHistogram(const Histogram *histogram)
+{
+    m_histogram = histogram;
+    updatePlot();
+}
+
+void HistogramPlot::setXAxisLabel(const QString text)
+{
+    setAxisTitle( QwtPlot::xBottom, text );
+}
+
+void HistogramPlot::addCDFCurve(const std::vector<double> &values, const std::vector<double> &probabilities,
+                                const QColor color, int width)
+{
+    QwtPlotCurve* curve = new QwtPlotCurve();
+    curve->setStyle( QwtPlotCurve::Steps );
+    curve->setPen( QPen( color, width ) );
+    curve->setSamples( values.data(), probabilities.data(), std::min( values.size(), probabilities.size() ) );
+    curve->setVisible( m_cumulative );
+    curve->attach( this );
+    m_cdfCurves.push_back( curve );
+    replot();
+}
+
+void HistogramPlot::clearCDFCurves()
+{
+    for( QwtPlotCurve* curve : m_cdfCurves ){
+        curve->detach();
+        delete curve;
+    }
+    m_cdfCurves.clear();
+}
+
+void HistogramPlot::setNumberOfClasses(int number)
+{
+    m_nClasses = std::max( 1, number );
+    updatePlot();
+}
+
+void HistogramPlot::setCumulative(bool value)
+{
+    m_cumulative = value;
+    updatePlot();
+}
+
+void HistogramPlot::updatePlot()
+{
+    if( ! m_histogram || m_histogram->isEmpty() ){
+        m_bars->setSamples( QVector<QwtIntervalSample>() );
+        m_cdf->setSamples( QVector<QPointF>() );
+        replot();
+        return;
+    }
+
+    if( m_cumulative ){
+        std::vector<double> values, probabilities;
+        m_histogram->getCDF( values, probabilities );
+        m_cdf->setSamples( values.data(), probabilities.data(), values.size() );
+        m_bars->setSamples( QVector<QwtIntervalSample>() );
+        setAxisTitle( QwtPlot::yLeft, "Cumulative frequency" );
+        setAxisScale( QwtPlot::yLeft, 0.0, 1.0 );
+    } else {
+        std::vector<double> classStarts, frequencies;
+        double classWidth;
+        m_histogram->getClasses( m_nClasses, classStarts, classWidth, frequencies );
+        QVector<QwtIntervalSample> samples;
+        samples.reserve( frequencies.size() );
+        for( std::size_t i = 0; i < frequencies.size(); ++i )
+            samples.push_back( QwtIntervalSample( frequencies[i], classStarts[i], classStarts[i] + classWidth ) );
+        m_bars->setSamples( samples );
+        m_cdf->setSamples( QVector<QPointF>() );
+        setAxisTitle( QwtPlot::yLeft, "Frequency" );
+        setAxisAutoScale( QwtPlot::yLeft );
+    }
+
+    for( QwtPlotCurve* curve : m_cdfCurves )
+        curve->setVisible( m_cumulative );
+
+    replot();
+}
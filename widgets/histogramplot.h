@@ -0,0 +1,56 @@
+#ifndef HISTOGRAMPLOT_H
+#define HISTOGRAMPLOT_H
+
+#include <qwt_plot.h>
+#include <vector>
+
+class Histogram;
+class QwtPlotHistogram;
+class QwtPlotCurve;
+
+/**
+ * The HistogramPlot class is a widget that renders a Histogram object (see geostats/histogram.h) as
+ * bars or as a cumulative distribution.  Additional cdf curves can be overlaid, which is used to compare
+ * the distributions of simulated realizations against a reference distribution (like histpltsim does).
+ */
+class HistogramPlot : public QwtPlot
+{
+    Q_OBJECT
+
+public:
+    explicit HistogramPlot( QWidget *parent = nullptr );
+    ~HistogramPlot();
+
+    /** Sets the histogram to display.  The object must exist while it is displayed. */
+    void setHistogram( const Histogram* histogram );
+
+    /** Sets the label of the horizontal axis, normally the variable name. */
+    void setXAxisLabel( const QString text );
+
+    /** Adds a cdf curve, normally of a realization.  The curves are only shown in cumulative mode. */
+    void addCDFCurve( const std::vector<double>& values, const std::vector<double>& probabilities,
+                      const QColor color, int width = 1 );
+
+    /** Removes all curves added with addCDFCurve(). */
+    void clearCDFCurves();
+
+public Q_SLOTS:
+    /** Sets the number of classes of the histogram bars. */
+    void setNumberOfClasses( int number );
+
+    /** Toggles between the frequency histogram and the cumulative distribution. */
+    void setCumulative( bool value );
+
+private:
+    const Histogram* m_histogram;
+    QwtPlotHistogram* m_bars;
+    QwtPlotCurve* m_cdf;
+    std::vector<QwtPlotCurve*> m_cdfCurves;
+    int m_nClasses;
+    bool m_cumulative;
+
+    /** Updates the plot items from the current histogram and settings. */
+    void updatePlot();
+};
+
+#endif // HISTOGRAMPLOT_H
@@ -0,0 +1,812 @@
+#include "workflow.h"
+
+#include "domain/application.h"
+#include "domain/attribute.h"
+#include "domain/cartesiangrid.h"
+#include "domain/objectgroup.h"
+#include "domain/project.h"
+#include "domain/variogrammodel.h"
+#include "geostats/ensemblepostprocessor.h"
+#include "geostats/ndvestimation.h"
+#include "geostats/normalscoretransform.h"
+#include "util.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <deque>
+
+//input files up to this size are fingerprinted by content, larger ones by size and modification time
+#define MAX_SIZE_HASHED_BY_CONTENT (4 * 1024 * 1024)
+
+Workflow::Workflow(QObject *parent) : QObject(parent),
+    m_force_recompute( false )
+{
+}
+
+bool Workflow::load(const QString path)
+{
+    m_steps.clear();
+    m_order.clear();
+    m_directory = QFileInfo( path ).absolutePath();
+    m_state_file_path = QFileInfo( path ).absoluteFilePath() + ".state";
+
+    QFile file( path );
+    if( ! file.open( QFile::ReadOnly | QFile::Text ) ){
+        Application::instance()->logError("Workflow::load(): could not open " + path );
+        return false;
+    }
+
+    bool ok = true;
+    //the parallel block of each step (-1 outside blocks)
+    std::vector<int> parallelBlocks;
+    int parallelBlock = -1;
+    int parallelBlockCount = 0;
+    QTextStream in(&file);
+    for( int lineNumber = 1; !in.atEnd(); ++lineNumber ){
+        QString line = in.readLine().trimmed();
+        if( line.isEmpty() || line.startsWith('#') )
+            continue;
+        QStringList tokens = tokenize( line );
+        QString operation = tokens.takeFirst();
+        //parallel blocks
+        if( operation == "parallel" || operation == "end" ){
+            if( ( operation == "parallel" ) == ( parallelBlock >= 0 ) ){
+                Application::instance()->logError( QString("Workflow::load(): line %1: unexpected %2.").arg( lineNumber ).arg( operation ) );
+                ok = false;
+            }
+            parallelBlock = ( operation == "parallel" ) ? parallelBlockCount++ : -1;
+            continue;
+        }
+        //operations
+        QStringList requiredParameters;
+        if( ! getRequiredParameters( operation, requiredParameters ) ){
+            Application::instance()->logError( QString("Workflow::load(): line %1: unknown operation %2.").arg( lineNumber ).arg( operation ) );
+            ok = false;
+            continue;
+        }
+        WorkflowStep step;
+        step.operation = operation;
+        step.lineNumber = lineNumber;
+        step.state = WorkflowStepState::PENDING;
+        for( const QString& token : tokens ){
+            int equalSignPosition = token.indexOf('=');
+            if( equalSignPosition <= 0 ){
+                logStepError( step, "parameter " + token + " is not in the name=value form." );
+                ok = false;
+                continue;
+            }
+            step.parameters.insert( token.left( equalSignPosition ), token.mid( equalSignPosition + 1 ) );
+        }
+        for( const QString& name : requiredParameters )
+            if( ! step.parameters.contains( name ) ){
+                logStepError( step, "missing " + name + " parameter." );
+                ok = false;
+            }
+        m_steps.push_back( step );
+        parallelBlocks.push_back( parallelBlock );
+    }
+    file.close();
+
+    if( parallelBlock >= 0 ){
+        Application::instance()->logError("Workflow::load(): missing end of parallel block.");
+        ok = false;
+    }
+
+    //a file with parallel blocks runs its steps in the declaration order: a step depends on the previous step
+    //or on all steps of the previous block, and the steps of a block depend on what precedes the block
+    if( parallelBlockCount > 0 ){
+        std::vector<uint> previousSteps;
+        std::vector<uint> blockDependencies;
+        for( uint iStep = 0; iStep < m_steps.size(); ++iStep ){
+            if( parallelBlocks[iStep] < 0 ){
+                m_steps[iStep].dependencies = previousSteps;
+                previousSteps.assign( 1, iStep );
+                continue;
+            }
+            if( iStep == 0 || parallelBlocks[iStep - 1] != parallelBlocks[iStep] ){
+                blockDependencies = previousSteps;
+                previousSteps.clear();
+            }
+            m_steps[iStep].dependencies = blockDependencies;
+            previousSteps.push_back( iStep );
+        }
+    }
+
+    return ok && buildGraph() && sortSteps();
+}
+
+bool Workflow::buildGraph()
+{
+    bool ok = true;
+    QDir gslibDir( Application::instance()->getGSLibPathSetting() );
+
+    //the outputs of the steps
+    for( WorkflowStep& step : m_steps ){
+        const QMap<QString, QString>& parameters = step.parameters;
+        if( step.operation == "gslib" ){
+            for( const QString& output : parameters.value("outputs").split( ',', QString::SkipEmptyParts ) )
+                step.outputs << "file:" + resolvePath( output.trimmed() );
+        } else if( step.operation != "load" ){
+            step.outputs << "object:" + parameters["name"];
+        }
+    }
+    QMap<QString, uint> producers;
+    for( uint iStep = 0; iStep < m_steps.size(); ++iStep )
+        for( const QString& output : m_steps[iStep].outputs ){
+            if( producers.contains( output ) ){
+                logStepError( m_steps[iStep], output + " is also written by the step in line " +
+                              QString::number( m_steps[producers[output]].lineNumber ) + "." );
+                ok = false;
+            }
+            producers.insert( output, iStep );
+        }
+
+    //the inputs of the steps
+    for( WorkflowStep& step : m_steps ){
+        const QMap<QString, QString>& parameters = step.parameters;
+        if( step.operation == "load" ){
+            step.inputs << "object:" + parameters["file"];
+        } else if( step.operation == "gslib" ){
+            QString par_file_path = resolvePath( parameters["par"] );
+            step.inputs << "file:" + par_file_path;
+            //the files named in the parameter file (GSLib parameter files have file paths alone in their lines,
+            //relative to the GSLib directory, where the programs run)
+            QFile parFile( par_file_path );
+            if( ! parFile.open( QFile::ReadOnly | QFile::Text ) ){
+                logStepError( step, "could not open the parameter file " + par_file_path + "." );
+                ok = false;
+                continue;
+            }
+            QTextStream in(&parFile);
+            while( ! in.atEnd() ){
+                QString value = in.readLine().trimmed();
+                if( value.isEmpty() )
+                    continue;
+                QString resource = "file:" + QFileInfo( gslibDir.absoluteFilePath( value ) ).absoluteFilePath();
+                if( step.outputs.contains( resource ) || step.inputs.contains( resource ) )
+                    continue;
+                if( producers.contains( resource ) || QFileInfo( resource.mid( 5 ) ).isFile() )
+                    step.inputs << resource;
+            }
+            parFile.close();
+        } else if( step.operation == "import_grid" ){
+            step.inputs << "file:" + resolvePath( parameters["path"] ) << "object:" + parameters["like"];
+        } else if( step.operation == "ndv" ){
+            step.inputs << "object:" + parameters["grid"] << "object:" + parameters["variogram"];
+        } else if( step.operation == "postsim" ){
+            step.inputs << "object:" + parameters["grid"];
+            if( parameters.contains("trn") )
+                step.inputs << "file:" + resolvePath( parameters["trn"] );
+        }
+    }
+
+    //the step ids
+    QMap<QString, uint> ids;
+    for( uint iStep = 0; iStep < m_steps.size(); ++iStep ){
+        WorkflowStep& step = m_steps[iStep];
+        if( step.parameters.contains("id") )
+            step.id = step.parameters["id"];
+        else if( ! step.outputs.isEmpty() )
+            step.id = step.operation + ":" + step.outputs.first().section( ':', 1 );
+        else
+            step.id = step.operation + ":" + step.inputs.first().section( ':', 1 );
+        if( ids.contains( step.id ) ){
+            logStepError( step, "duplicate step id " + step.id + " (use the id parameter)." );
+            ok = false;
+        }
+        ids.insert( step.id, iStep );
+    }
+
+    //the dependencies
+    for( uint iStep = 0; iStep < m_steps.size(); ++iStep ){
+        WorkflowStep& step = m_steps[iStep];
+        for( const QString& input : step.inputs )
+            if( producers.contains( input ) )
+                step.dependencies.push_back( producers[input] );
+        for( const QString& id : step.parameters.value("after").split( ',', QString::SkipEmptyParts ) ){
+            if( ! ids.contains( id.trimmed() ) ){
+                logStepError( step, "unknown step id " + id + "." );
+                ok = false;
+                continue;
+            }
+            step.dependencies.push_back( ids[id.trimmed()] );
+        }
+        std::sort( step.dependencies.begin(), step.dependencies.end() );
+        step.dependencies.erase( std::unique( step.dependencies.begin(), step.dependencies.end() ),
+                                 step.dependencies.end() );
+    }
+
+    return ok;
+}
+
+bool Workflow::sortSteps()
+{
+    //Kahn's algorithm, keeping the declaration order among independent steps
+    std::vector<uint> nPendingDependencies( m_steps.size() );
+    std::vector< std::vector<uint> > dependents( m_steps.size() );
+    std::deque<uint> ready;
+    for( uint iStep = 0; iStep < m_steps.size(); ++iStep ){
+        nPendingDependencies[iStep] = m_steps[iStep].dependencies.size();
+        for( uint dependency : m_steps[iStep].dependencies )
+            dependents[dependency].push_back( iStep );
+        if( nPendingDependencies[iStep] == 0 )
+            ready.push_back( iStep );
+    }
+    m_order.clear();
+    while( ! ready.empty() ){
+        uint iStep = ready.front();
+        ready.pop_front();
+        m_order.push_back( iStep );
+        for( uint dependent : dependents[iStep] )
+            if( --nPendingDependencies[dependent] == 0 )
+                ready.push_back( dependent );
+    }
+    if( m_order.size() != m_steps.size() ){
+        for( uint iStep = 0; iStep < m_steps.size(); ++iStep )
+            if( nPendingDependencies[iStep] > 0 )
+                logStepError( m_steps[iStep], "the step is part of a dependency cycle." );
+        return false;
+    }
+    return true;
+}
+
+void Workflow::computeSignatures()
+{
+    QMap<QString, uint> producers;
+    for( uint iStep = 0; iStep < m_steps.size(); ++iStep )
+        for( const QString& output : m_steps[iStep].outputs )
+            producers.insert( output, iStep );
+
+    //the signatures of the dependencies are computed first
+    for( uint iStep : m_order ){
+        WorkflowStep& step = m_steps[iStep];
+        QCryptographicHash hash( QCryptographicHash::Sha1 );
+        hash.addData( step.operation.toUtf8() );
+        //QMap iterates in key order, so the order of the parameters in the file does not matter
+        for( QMap<QString, QString>::const_iterator it = step.parameters.constBegin(); it != step.parameters.constEnd(); ++it )
+            hash.addData( QString( "\n" + it.key() + "=" + it.value() ).toUtf8() );
+        for( const QString& input : step.inputs ){
+            hash.addData( QString( "\n" + input + ":" ).toUtf8() );
+            if( producers.contains( input ) )
+                hash.addData( m_steps[producers[input]].signature.toUtf8() );
+            else
+                hash.addData( getFingerprint( input ).toUtf8() );
+        }
+        step.signature = QString( hash.result().toHex() );
+    }
+}
+
+QString Workflow::getFingerprint(const QString resource)
+{
+    QStringList paths;
+    if( resource.startsWith("file:") ){
+        paths << resource.mid( 5 );
+    } else {
+        File* file = findProjectFile( resource.mid( 7 ) );
+        if( ! file )
+            return "missing";
+        paths << file->getPath() << file->getMetaDataFilePath();
+    }
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    for( const QString& path : paths ){
+        QFileInfo fileInfo( path );
+        if( ! fileInfo.isFile() ){
+            hash.addData( QByteArray("missing") );
+        } else if( fileInfo.size() <= MAX_SIZE_HASHED_BY_CONTENT ){
+            QFile file( path );
+            if( file.open( QFile::ReadOnly ) ){
+                hash.addData( &file );
+                file.close();
+            }
+        } else {
+            hash.addData( QString::number( fileInfo.size() ).toUtf8() );
+            hash.addData( QString::number( fileInfo.lastModified().toMSecsSinceEpoch() ).toUtf8() );
+        }
+    }
+    return QString( hash.result().toHex() );
+}
+
+bool Workflow::outputExists(const QString resource)
+{
+    if( resource.startsWith("file:") )
+        return QFileInfo( resource.mid( 5 ) ).isFile();
+    return findProjectFile( resource.mid( 7 ) ) != nullptr;
+}
+
+QMap<QString, QString> Workflow::readState()
+{
+    QMap<QString, QString> state;
+    QFile file( m_state_file_path );
+    if( ! file.open( QFile::ReadOnly | QFile::Text ) )
+        return state;
+    QTextStream in(&file);
+    while( ! in.atEnd() ){
+        //each line is the signature followed by the step id (which may contain whitespaces)
+        QString line = in.readLine();
+        int separatorPosition = line.indexOf(' ');
+        if( separatorPosition > 0 )
+            state.insert( line.mid( separatorPosition + 1 ), line.left( separatorPosition ) );
+    }
+    file.close();
+    return state;
+}
+
+void Workflow::writeState(const QMap<QString, QString> &state)
+{
+    QFile file( m_state_file_path );
+    if( ! file.open( QFile::WriteOnly | QFile::Text ) ){
+        Application::instance()->logWarn("Workflow::writeState(): could not write " + m_state_file_path +
+                                         ".  The next run will recompute all steps.");
+        return;
+    }
+    QTextStream out(&file);
+    for( QMap<QString, QString>::const_iterator it = state.constBegin(); it != state.constEnd(); ++it )
+        out << it.value() << ' ' << it.key() << '\n';
+    file.close();
+}
+
+bool Workflow::run()
+{
+    if( ! Application::instance()->hasOpenProject() ){
+        Application::instance()->logError("Workflow::run(): no open project.");
+        return false;
+    }
+
+    //find out which steps must run
+    computeSignatures();
+    QMap<QString, QString> state = readState();
+    uint nToRun = 0;
+    for( uint iStep : m_order ){
+        WorkflowStep& step = m_steps[iStep];
+        bool mustRun = m_force_recompute || state.value( step.id ) != step.signature;
+        for( const QString& output : step.outputs )
+            mustRun = mustRun || ! outputExists( output );
+        for( uint dependency : step.dependencies )
+            mustRun = mustRun || m_steps[dependency].state == WorkflowStepState::PENDING;
+        step.state = mustRun ? WorkflowStepState::PENDING : WorkflowStepState::UP_TO_DATE;
+        if( mustRun )
+            ++nToRun;
+        else
+            Application::instance()->logInfo("Workflow: " + step.id + " is up to date.");
+    }
+    Application::instance()->logInfo( QString("Workflow: %1 of %2 steps to run.").arg( nToRun ).arg( m_steps.size() ) );
+
+    //run the steps as their dependencies complete
+    std::vector<GSLibJobPtr> jobs( m_steps.size() );
+    std::vector<bool> recorded( m_steps.size(), false );
+    uint nCompleted = 0;
+    bool failed = false;
+    while( true ){
+        bool didSomething = false;
+
+        //collect the results of the GSLib programs
+        for( uint iStep : m_order ){
+            WorkflowStep& step = m_steps[iStep];
+            if( step.state != WorkflowStepState::RUNNING || ! jobs[iStep]->isFinished() )
+                continue;
+            if( jobs[iStep]->getState() == GSLibJobState::FINISHED && jobs[iStep]->getExitCode() == 0 ){
+                step.state = WorkflowStepState::DONE;
+            } else {
+                logStepError( step, "the program failed." );
+                step.state = WorkflowStepState::FAILED;
+            }
+            jobs[iStep].reset();
+            didSomething = true;
+        }
+
+        //the steps that depend on a failed step will not be executed (the order propagates the failures downstream)
+        for( uint iStep : m_order ){
+            WorkflowStep& step = m_steps[iStep];
+            if( step.state != WorkflowStepState::PENDING )
+                continue;
+            for( uint dependency : step.dependencies )
+                if( m_steps[dependency].state == WorkflowStepState::FAILED ){
+                    logStepError( step, "not executed because " + m_steps[dependency].id + " failed." );
+                    step.state = WorkflowStepState::FAILED;
+                    didSomething = true;
+                    break;
+                }
+        }
+
+        //start the steps whose dependencies are complete (none after a failure)
+        for( uint iStep : m_order ){
+            if( failed )
+                break;
+            WorkflowStep& step = m_steps[iStep];
+            if( step.state != WorkflowStepState::PENDING )
+                continue;
+            bool isReady = true;
+            for( uint dependency : step.dependencies )
+                isReady = isReady && ( m_steps[dependency].state == WorkflowStepState::DONE ||
+                                       m_steps[dependency].state == WorkflowStepState::UP_TO_DATE );
+            if( ! isReady )
+                continue;
+            emit setLabel( "Running " + step.id + "..." );
+            if( ! runStep( step, jobs[iStep] ) )
+                step.state = WorkflowStepState::FAILED;
+            else if( jobs[iStep] )
+                step.state = WorkflowStepState::RUNNING;
+            else
+                step.state = WorkflowStepState::DONE;
+            didSomething = true;
+            //in-process steps block, so check the programs again before starting other steps
+            if( ! jobs[iStep] )
+                break;
+        }
+
+        //record the completed steps, so an interrupted workflow resumes where it stopped
+        bool stateChanged = false;
+        uint nRunning = 0;
+        for( uint iStep : m_order ){
+            WorkflowStep& step = m_steps[iStep];
+            if( step.state == WorkflowStepState::RUNNING )
+                ++nRunning;
+            if( step.state == WorkflowStepState::DONE && ! recorded[iStep] ){
+                recorded[iStep] = true;
+                state.insert( step.id, step.signature );
+                stateChanged = true;
+                ++nCompleted;
+            }
+            if( step.state == WorkflowStepState::FAILED && ! recorded[iStep] ){
+                recorded[iStep] = true;
+                state.remove( step.id );
+                stateChanged = true;
+                failed = true;
+            }
+        }
+        if( stateChanged ){
+            writeState( state );
+            emit progress( nToRun > 0 ? (int)( 100 * nCompleted / nToRun ) : 100 );
+        }
+
+        //the workflow ends when nothing runs and nothing more can start
+        if( nRunning == 0 && ! didSomething )
+            break;
+        if( ! didSomething ){
+            QThread::msleep( 50 );
+            QCoreApplication::processEvents();
+        }
+    }
+    GSLibJobScheduler::instance()->removeFinishedJobs();
+
+    if( failed || nCompleted < nToRun ){
+        uint nFailed = 0;
+        for( const WorkflowStep& step : m_steps )
+            if( step.state == WorkflowStepState::FAILED )
+                ++nFailed;
+        Application::instance()->logError( QString("Workflow failed: %1 of %2 steps completed, %3 failed or not executed because of a failure.")
+                                           .arg( nCompleted ).arg( nToRun ).arg( nFailed ) );
+        return false;
+    }
+    Application::instance()->logInfo("Workflow completed.");
+    return true;
+}
+
+bool Workflow::runStep(const WorkflowStep &step, GSLibJobPtr &job)
+{
+    Application::instance()->logInfo( QString("Workflow: line %1: %2...").arg( step.lineNumber ).arg( step.id ) );
+    if( step.operation == "load" )
+        return runLoad( step );
+    else if( step.operation == "gslib" )
+        return runGSLib( step, job );
+    else if( step.operation == "import_grid" )
+        return runImportGrid( step );
+    else if( step.operation == "ndv" )
+        return runNDVEstimation( step );
+    else if( step.operation == "postsim" )
+        return runPostsim( step );
+    logStepError( step, "unknown operation." );
+    return false;
+}
+
+bool Workflow::runLoad(const WorkflowStep &step)
+{
+    DataFile* dataFile = findDataFile( step, step.parameters["file"] );
+    if( ! dataFile )
+        return false;
+    dataFile->loadData();
+    return true;
+}
+
+bool Workflow::runGSLib(const WorkflowStep &step, GSLibJobPtr &job)
+{
+    QString par_file_path = resolvePath( step.parameters["par"] );
+    if( ! QFileInfo( par_file_path ).isFile() ){
+        logStepError( step, "parameter file " + par_file_path + " not found." );
+        return false;
+    }
+    QString program_name = step.parameters["program"];
+    job = GSLibJobScheduler::instance()->submit( program_name,
+                                                 par_file_path,
+                                                 program_name + " (" + step.id + ")",
+                                                 step.parameters.value("stdin") == "yes" );
+    return true;
+}
+
+bool Workflow::runImportGrid(const WorkflowStep &step)
+{
+    QString path = resolvePath( step.parameters["path"] );
+    if( ! QFileInfo( path ).isFile() ){
+        logStepError( step, "grid file " + path + " not found." );
+        return false;
+    }
+    CartesianGrid* like_cg = findCartesianGrid( step, step.parameters["like"] );
+    if( ! like_cg )
+        return false;
+
+    CartesianGrid* new_cg = new CartesianGrid( path );
+    new_cg->setInfoFromOtherCG( like_cg, false );
+    if( step.parameters.contains("realizations") ){
+        bool ok;
+        uint nreal = step.parameters["realizations"].toUInt( &ok );
+        if( ! ok || nreal == 0 ){
+            logStepError( step, "invalid number of realizations." );
+            delete new_cg;
+            return false;
+        }
+        new_cg->setNReal( nreal );
+    }
+    if( step.parameters.contains("ndv") )
+        new_cg->setNoDataValue( step.parameters["ndv"] );
+
+    importCartesianGrid( new_cg, step.parameters["name"] );
+    delete new_cg;
+    return true;
+}
+
+bool Workflow::runNDVEstimation(const WorkflowStep &step)
+{
+    CartesianGrid* cg = findCartesianGrid( step, step.parameters["grid"] );
+    if( ! cg )
+        return false;
+    //several comma-separated variables are estimated in the same run
+    std::vector<Attribute*> ats;
+    for( const QString& name : step.parameters["variable"].split( ',', QString::SkipEmptyParts ) ){
+        Attribute* at = findAttribute( step, cg, name.trimmed() );
+        if( ! at )
+            return false;
+        ats.push_back( at );
+    }
+    if( ats.empty() ){
+        logStepError( step, "no variable given." );
+        return false;
+    }
+    VariogramModel* vm = findVariogramModel( step, step.parameters["variogram"] );
+    if( ! vm )
+        return false;
+
+    NDVEstimation estimation( ats[0] );
+    for( uint i = 1; i < ats.size(); ++i )
+        estimation.addAttribute( ats[i] );
+    estimation.setSearchParameters( step.parameters.value( "samples", "16" ).toInt(),
+                                    step.parameters.value( "cols", "10" ).toInt(),
+                                    step.parameters.value( "rows", "10" ).toInt(),
+                                    step.parameters.value( "slices", "1" ).toInt() );
+    estimation.setVariogramModel( vm );
+    estimation.setMeanForSK( step.parameters.value( "mean", "0.0" ).toDouble() );
+    if( step.parameters.contains("default") ){
+        estimation.setUseDefaultValue( true );
+        estimation.setDefaultValue( step.parameters["default"].toDouble() );
+    }
+    QString ktype = step.parameters.value( "type", "SK" );
+    if( ktype == "SK" )
+        estimation.setKtype( KrigingType::SK );
+    else if( ktype == "OK" )
+        estimation.setKtype( KrigingType::OK );
+    else {
+        logStepError( step, "kriging type must be SK or OK." );
+        return false;
+    }
+    if( estimation.run().empty() ){
+        logStepError( step, "estimation failed." );
+        return false;
+    }
+
+    //save the results in the project's tmp directory and import them as a new grid
+    QString tmp_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("dat");
+    if( ! estimation.writeToFile( tmp_file_path ) ){
+        logStepError( step, "could not write the estimates." );
+        return false;
+    }
+    CartesianGrid new_cg( tmp_file_path );
+    new_cg.setInfoFromOtherCG( cg, false );
+    importCartesianGrid( &new_cg, step.parameters["name"] );
+    return true;
+}
+
+bool Workflow::runPostsim(const WorkflowStep &step)
+{
+    CartesianGrid* cg = findCartesianGrid( step, step.parameters["grid"] );
+    if( ! cg )
+        return false;
+    Attribute* at = findAttribute( step, cg, step.parameters["variable"] );
+    if( ! at )
+        return false;
+
+    EnsemblePostProcessor postprocessor( cg, at->getAttributeGEOEASgivenIndex() - 1 );
+    if( step.parameters.contains("tmin") || step.parameters.contains("tmax") )
+        postprocessor.setTrimmingLimits( step.parameters.value( "tmin", "-1.0e21" ).toDouble(),
+                                         step.parameters.value( "tmax", "1.0e21" ).toDouble() );
+    postprocessor.setComputeMoments( step.parameters.value("moments") == "yes" );
+    std::vector<double> thresholds, quantiles;
+    if( ! parseNumbers( step.parameters.value("thresholds"), thresholds ) ||
+        ! parseNumbers( step.parameters.value("quantiles"), quantiles ) ){
+        logStepError( step, "thresholds and quantiles must be comma-separated numbers." );
+        return false;
+    }
+    for( double threshold : thresholds )
+        postprocessor.addThreshold( threshold );
+    for( double quantile : quantiles )
+        postprocessor.addQuantile( quantile );
+    if( step.parameters.contains("trn") ){
+        //the table is shared with other steps back transforming with the same file
+        std::shared_ptr<const NormalScoreTransform> transform = NormalScoreTransform::fromTrnFile( resolvePath( step.parameters["trn"] ) );
+        if( ! transform ){
+            logStepError( step, "could not read the transform table." );
+            return false;
+        }
+        //tails other than the table extremes need a copy of the shared table
+        if( step.parameters.contains("zmin") || step.parameters.contains("zmax") ){
+            double zmin = transform->values().front();
+            double zmax = transform->values().back();
+            if( step.parameters.contains("zmin") )
+                zmin = step.parameters["zmin"].toDouble();
+            if( step.parameters.contains("zmax") )
+                zmax = step.parameters["zmax"].toDouble();
+            std::shared_ptr<NormalScoreTransform> transformWithTails( new NormalScoreTransform( *transform ) );
+            transformWithTails->setTails( zmin, NScoreTailModel::LINEAR, 1.0, zmax, NScoreTailModel::LINEAR, 1.0 );
+            transform = transformWithTails;
+        }
+        postprocessor.setBackTransform( transform );
+    }
+
+    QString tmp_file_path = Application::instance()->getProject()->generateUniqueTmpFilePath("dat");
+    if( ! postprocessor.run() || ! postprocessor.writeToFile( tmp_file_path ) ){
+        logStepError( step, "post-processing failed." );
+        return false;
+    }
+
+    //import the post-processed maps as a new grid
+    CartesianGrid new_cg( tmp_file_path );
+    new_cg.setInfoFromOtherCG( cg, false );
+    new_cg.setNReal( 1 );
+    new_cg.setNoDataValue( QString::number( EnsemblePostProcessor::getNoDataValue() ) );
+    importCartesianGrid( &new_cg, step.parameters["name"] );
+    return true;
+}
+
+void Workflow::importCartesianGrid(CartesianGrid *cg, const QString new_file_name)
+{
+    //the workflow owns its outputs, so a previous result is replaced
+    File* previous = findProjectFile( new_file_name );
+    if( previous ){
+        Application::instance()->logInfo("Workflow: replacing " + new_file_name + ".");
+        Application::instance()->getProject()->removeFile( previous, true );
+    }
+    Application::instance()->getProject()->importCartesianGrid( cg, new_file_name );
+}
+
+bool Workflow::getRequiredParameters(const QString operation, QStringList &names)
+{
+    if( operation == "load" )
+        names = QStringList() << "file";
+    else if( operation == "gslib" )
+        names = QStringList() << "program" << "par";
+    else if( operation == "import_grid" )
+        names = QStringList() << "path" << "like" << "name";
+    else if( operation == "ndv" )
+        names = QStringList() << "grid" << "variable" << "variogram" << "name";
+    else if( operation == "postsim" )
+        names = QStringList() << "grid" << "variable" << "name";
+    else
+        return false;
+    return true;
+}
+
+void Workflow::logStepError(const WorkflowStep &step, const QString message)
+{
+    Application::instance()->logError( QString("Workflow: line %1 (%2): ").arg( step.lineNumber ).arg( step.operation ) + message );
+}
+
+QString Workflow::resolvePath(const QString path)
+{
+    return QDir( m_directory ).absoluteFilePath( path );
+}
+
+DataFile *Workflow::findDataFile(const WorkflowStep &step, const QString name)
+{
+    ProjectComponent* pc = Application::instance()->getProject()->getDataFilesGroup()->getChildByName( name );
+    if( ! pc || ! pc->isFile() || ! ((File*)pc)->isDataFile() ){
+        logStepError( step, "data file " + name + " not found in the project." );
+        return nullptr;
+    }
+    return (DataFile*)pc;
+}
+
+CartesianGrid *Workflow::findCartesianGrid(const WorkflowStep &step, const QString name)
+{
+    DataFile* dataFile = findDataFile( step, name );
+    if( ! dataFile )
+        return nullptr;
+    if( dataFile->getFileType() != "CARTESIANGRID" ){
+        logStepError( step, name + " is not a Cartesian grid." );
+        return nullptr;
+    }
+    return (CartesianGrid*)dataFile;
+}
+
+Attribute *Workflow::findAttribute(const WorkflowStep &step, DataFile *dataFile, const QString name)
+{
+    ProjectComponent* pc = dataFile->getChildByName( name, true );
+    if( ! pc || ! pc->isAttribute() ){
+        logStepError( step, "variable " + name + " not found in " + dataFile->getName() + "." );
+        return nullptr;
+    }
+    return (Attribute*)pc;
+}
+
+File *Workflow::findProjectFile(const QString name)
+{
+    Project* project = Application::instance()->getProject();
+    ObjectGroup* groups[] = { project->getDataFilesGroup(), project->getVariogramsGroup(),
+                              project->getDistributionsGroup(), project->getResourcesGroup() };
+    for( ObjectGroup* group : groups ){
+        ProjectComponent* pc = group->getChildByName( name );
+        if( pc && pc->isFile() )
+            return (File*)pc;
+    }
+    return nullptr;
+}
+
+VariogramModel *Workflow::findVariogramModel(const WorkflowStep &step, const QString name)
+{
+    ProjectComponent* pc = Application::instance()->getProject()->getVariogramsGroup()->getChildByName( name );
+    if( ! pc || ! pc->isFile() || ((File*)pc)->getFileType() != "VMODEL" ){
+        logStepError( step, "variogram model " + name + " not found in the project." );
+        return nullptr;
+    }
+    return (VariogramModel*)pc;
+}
+
+bool Workflow::parseNumbers(const QString text, std::vector<double> &values)
+{
+    for( const QString& item : text.split( ',', QString::SkipEmptyParts ) ){
+        bool ok;
+        values.push_back( item.trimmed().toDouble( &ok ) );
+        if( ! ok )
+            return false;
+    }
+    return true;
+}
+
+QStringList Workflow::tokenize(const QString line)
+{
+    QStringList tokens;
+    QString token;
+    bool inQuotes = false;
+    bool hasToken = false;
+    for( const QChar& c : line ){
+        if( c == '"' ){
+            inQuotes = ! inQuotes;
+            hasToken = true;
+        } else if( c.isSpace() && ! inQuotes ){
+            if( hasToken )
+                tokens << token;
+            token.clear();
+            hasToken = false;
+        } else {
+            token += c;
+            hasToken = true;
+        }
+    }
+    if( hasToken )
+        tokens << token;
+    return tokens;
+}
@@ -0,0 +1,168 @@
+#ifndef WORKFLOW_H
+#define WORKFLOW_H
+
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <vector>
+#include "gslib/gslibjobscheduler.h"
+
+class Attribute;
+class CartesianGrid;
+class DataFile;
+class File;
+class VariogramModel;
+
+/*! The execution states of a workflow step. */
+enum class WorkflowStepState : int {
+    PENDING = 0, /*!< The step is waiting for its dependencies (or was not started because an independent step failed). */
+    RUNNING,     /*!< The step is running (only GSLib programs run in the background). */
+    DONE,        /*!< The step was executed successfully. */
+    UP_TO_DATE,  /*!< The step was not executed because its results are up to date. */
+    FAILED       /*!< The step failed or was not executed because a dependency failed. */
+};
+
+/** One operation declared in a workflow file, a node of the workflow graph. */
+struct WorkflowStep {
+    QString id;                        //!< The step identifier (the id parameter or one made from the operation and outputs).
+    QString operation;                 //!< The operation name (e.g. gslib or ndv).
+    QMap<QString, QString> parameters; //!< The name=value pairs following the operation name.
+    int lineNumber;                    //!< The line of the workflow file where the step is declared.
+    QStringList inputs;                //!< The files (file:<path>) and project objects (object:<name>) the step reads.
+    QStringList outputs;               //!< The files and project objects the step writes.
+    std::vector<uint> dependencies;    //!< The indexes of the steps this step depends on.
+    QString signature;                 //!< Hash of the operation, parameters and inputs (see Workflow::computeSignatures()).
+    WorkflowStepState state;
+};
+
+/**
+ * The Workflow class runs a graph of operations declared in a text file against the open project, without
+ * user interaction, so it can be used from the command line (see the --batch option in main.cpp).
+ * Each non-empty line that does not start with # declares a step: the operation name followed by
+ * name=value pairs (values with whitespaces must be enclosed in double quotes).  Relative paths are
+ * relative to the directory of the workflow file.  The operations are:
+ * - load file=<data file>: loads the data of a data file of the project.
+ * - gslib program=<program> par=<parameter file> [outputs=<path1,path2,...>] [stdin=yes]: runs a GSLib
+ *   program (e.g. declus, nscore, kt3d or sgsim).  The files named in the parameter file are its inputs.
+ *   The output files must be declared so other steps can depend on them.
+ * - import_grid path=<grid file> like=<grid> name=<new file name> [realizations=<n>] [ndv=<value>]: adds
+ *   a grid file written by a program to the project, with the geometry of an existing grid.
+ * - ndv grid=<grid> variable=<variable1,variable2,...> variogram=<variogram model> name=<new file name>
+ *   [type=SK|OK] [mean=<SK mean>] [default=<value>] [samples=<n>] [cols=<n>] [rows=<n>] [slices=<n>]:
+ *   estimates the unvalued cells of grid variables in one run (see NDVEstimation).
+ * - postsim grid=<grid> variable=<variable> name=<new file name> [moments=yes] [thresholds=<t1,t2,...>]
+ *   [quantiles=<p1,p2,...>] [tmin=<value>] [tmax=<value>] [trn=<transform table> [zmin=<value>] [zmax=<value>]]:
+ *   post-processes realizations (see EnsemblePostProcessor).  With trn, the realizations are back transformed
+ *   with a GSLib transform table first, with linear tails to zmin and zmax (default: the table extremes).
+ * All steps accept id=<identifier> and after=<id1,id2,...> (explicit dependencies).
+ * Files written for sequential runs may group steps between a parallel line and an end line.  In such a file
+ * the steps keep their declaration order: each step depends on the step before it (or on all steps of the
+ * block before it), while the steps of a block depend only on what precedes the block, so they run together.
+ * Files without parallel blocks need no ordering, since independent steps run concurrently anyway.
+ *
+ * The steps form a graph: a step depends on the steps that write its inputs.  A step is recomputed only if
+ * its signature (a hash of its operation, parameters, parameter file contents and inputs) differs from the
+ * one recorded in the last run, if one of its outputs is missing or if one of its dependencies is recomputed.
+ * The signature of an input written by another step is that step's signature, so a change propagates
+ * downstream without hashing large intermediate files.  The signatures are recorded in a state file next
+ * to the workflow file.  Independent GSLib programs run concurrently (see GSLibJobScheduler), while the
+ * in-process operations, which change the project, run one at a time in the meantime.  After a failure, the
+ * steps that depend on the failed step are marked as failed and no other step starts.
+ */
+class Workflow : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Workflow( QObject *parent = nullptr );
+
+    /** Reads and checks a workflow file.  Returns false if the file has errors (which are logged). */
+    bool load( const QString path );
+
+    /** Runs the steps that are not up to date.  Requires an open project.  Returns false if a step failed. */
+    bool run();
+
+    /** If set, all steps are recomputed regardless of the recorded signatures.  Default is false. */
+    void setForceRecompute( bool value ){ m_force_recompute = value; }
+
+    const std::vector<WorkflowStep>& getSteps() const { return m_steps; }
+
+signals:
+    void progress(int);
+    void setLabel(QString);
+
+private:
+    std::vector<WorkflowStep> m_steps;
+    /** The directory of the workflow file. */
+    QString m_directory;
+    /** The step indexes in an order that respects the dependencies. */
+    std::vector<uint> m_order;
+    /** The path to the file with the signatures of the last run. */
+    QString m_state_file_path;
+    bool m_force_recompute;
+
+    /** Finds the inputs and outputs of the steps and the dependencies between them.  Returns false on errors. */
+    bool buildGraph();
+
+    /** Sorts the steps by dependency (sets m_order).  Returns false if the graph has cycles. */
+    bool sortSteps();
+
+    /** Computes the step signatures in dependency order. */
+    void computeSignatures();
+
+    /** Returns a fingerprint of the current contents of an input that is not written by a step. */
+    QString getFingerprint( const QString resource );
+
+    /** Returns whether an output exists. */
+    bool outputExists( const QString resource );
+
+    //@{
+    /** Read and write the signatures of the last successful runs of the steps (id -> signature). */
+    QMap<QString, QString> readState();
+    void writeState( const QMap<QString, QString>& state );
+    //@}
+
+    /** Runs an in-process step or submits a GSLib step to the job scheduler. */
+    bool runStep( const WorkflowStep& step, GSLibJobPtr& job );
+
+    //@{
+    /** The operations. */
+    bool runLoad( const WorkflowStep& step );
+    bool runGSLib( const WorkflowStep& step, GSLibJobPtr& job );
+    bool runImportGrid( const WorkflowStep& step );
+    bool runNDVEstimation( const WorkflowStep& step );
+    bool runPostsim( const WorkflowStep& step );
+    //@}
+
+    /** Imports a grid file to the project replacing a previous result with the same name. */
+    void importCartesianGrid( CartesianGrid* cg, const QString new_file_name );
+
+    /** Returns the names of the required parameters of an operation.  Returns false if the operation does not exist. */
+    static bool getRequiredParameters( const QString operation, QStringList& names );
+
+    /** Logs an error message about a step. */
+    void logStepError( const WorkflowStep& step, const QString message );
+
+    /** Makes a path in the workflow file absolute. */
+    QString resolvePath( const QString path );
+
+    //@{
+    /** Find project objects by name.  They return nullptr (and log an error) if the object is not found. */
+    DataFile* findDataFile( const WorkflowStep& step, const QString name );
+    CartesianGrid* findCartesianGrid( const WorkflowStep& step, const QString name );
+    Attribute* findAttribute( const WorkflowStep& step, DataFile* dataFile, const QString name );
+    VariogramModel* findVariogramModel( const WorkflowStep& step, const QString name );
+    //@}
+
+    /** Returns the project file object (data file, variogram, etc.) with the given name or nullptr. */
+    static File* findProjectFile( const QString name );
+
+    /** Parses a comma-separated list of numbers. Returns false if some value is not a number. */
+    static bool parseNumbers( const QString text, std::vector<double>& values );
+
+    /** Splits a line into tokens separated by whitespaces.  Text between double quotes is a single token. */
+    static QStringList tokenize( const QString line );
+};
+
+#endif // WORKFLOW_H